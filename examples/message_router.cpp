@@ -0,0 +1,434 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+// An end-to-end message router, intended as a macrobenchmark of kmillet::sized_any under a realistic workload shape.
+//
+// Producer threads parse text records of several kinds into typed messages, wrap them in kmillet::sized_any<N>
+// and route them to worker queues. Workers dispatch each message by type through a kmillet::sized_any_event_bus
+// and aggregate the results. Throughput and the latency between routing and handling are reported at the end.
+//
+// Usage: message_router [--capacity=16|32|64|128] [--dispatch=virtual|table] [--producers=P] [--workers=W] [--messages=M]
+//
+// message_router_pool is the same program built with MESSAGE_ROUTER_POOL_ALLOCATOR, which replaces the global allocator by a pool.
+
+#include <kmillet/sized_any/sized_any.hpp>
+#include <kmillet/sized_any/sized_any_event_bus.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(MESSAGE_ROUTER_POOL_ALLOCATOR)
+// message_router_pool replaces the global allocator by a thread-caching, size-class pool for blocks up to 256 bytes,
+// which is where the heap-allocated contents of a kmillet::sized_any<N> usually land. message_router keeps the system
+// allocator untouched, as the baseline.
+namespace pool
+{
+    constexpr std::size_t granularity = 32;
+    constexpr std::size_t classes = 8;
+
+    // The free blocks of a thread. Blocks are returned to the thread that allocated them: a block freed by another thread
+    // is pushed onto the lock-free `remote` list of its owner, which takes the whole list when its own list runs dry.
+    // Only the owner takes from `remote`, so pushes never race with a pop of the same block.
+    struct cache
+    {
+        std::array<void*, classes> local{};
+        std::array<std::atomic<void*>, classes> remote{};
+    };
+
+    // Keeps the returned blocks aligned to alignof(std::max_align_t).
+    struct alignas(alignof(std::max_align_t)) header
+    {
+        cache* owner;  // nullptr for blocks too large to be pooled
+        std::size_t sizeClass;
+    };
+
+    thread_local cache* current = nullptr;
+
+    void* next(void* block) noexcept
+    {
+        void* link;
+        std::memcpy(&link, block, sizeof(link));
+        return link;
+    }
+    void link(void* block, void* next) noexcept { std::memcpy(block, &next, sizeof(next)); }
+
+    cache& local()
+    {
+        // Caches are never freed, since their blocks may be freed by other threads after their owner exits.
+        // They are made with malloc, as operator new would recurse into this allocator.
+        if (!current)
+        {
+            void* memory = std::malloc(sizeof(cache));
+            if (!memory) throw std::bad_alloc{};
+            current = new (memory) cache;
+        }
+        return *current;
+    }
+
+    void* allocate(std::size_t size)
+    {
+        if (size > granularity * classes)
+        {
+            auto* block = static_cast<header*>(std::malloc(sizeof(header) + size));
+            if (!block) throw std::bad_alloc{};
+            block->owner = nullptr;
+            return block + 1;
+        }
+        const std::size_t sizeClass = size ? (size - 1) / granularity : 0;
+        cache& c = local();
+        void* ptr = c.local[sizeClass];
+        if (!ptr) ptr = c.remote[sizeClass].exchange(nullptr, std::memory_order_acquire);
+        if (ptr)
+        {
+            c.local[sizeClass] = next(ptr);
+            return ptr;
+        }
+        auto* block = static_cast<header*>(std::malloc(sizeof(header) + (sizeClass + 1) * granularity));
+        if (!block) throw std::bad_alloc{};
+        *block = {&c, sizeClass};
+        return block + 1;
+    }
+
+    void deallocate(void* ptr) noexcept
+    {
+        if (!ptr) return;
+        const header* block = static_cast<header*>(ptr) - 1;
+        if (!block->owner) return std::free(const_cast<header*>(block));
+        cache& owner = *block->owner;
+        if (&owner == current)
+        {
+            link(ptr, owner.local[block->sizeClass]);
+            owner.local[block->sizeClass] = ptr;
+            return;
+        }
+        std::atomic<void*>& remote = owner.remote[block->sizeClass];
+        void* head = remote.load(std::memory_order_relaxed);
+        do link(ptr, head);
+        while (!remote.compare_exchange_weak(head, ptr, std::memory_order_release, std::memory_order_relaxed));
+    }
+}
+
+void* operator new(std::size_t size) { return pool::allocate(size); }
+void operator delete(void* ptr) noexcept { pool::deallocate(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { pool::deallocate(ptr); }
+
+constexpr const char* allocatorName = "pool";
+#else
+constexpr const char* allocatorName = "system";
+#endif
+
+namespace
+{
+    using symbol = std::array<char, 8>;
+
+    struct trade { symbol name; std::uint32_t quantity; double price; };
+    struct quote { symbol name; double bid; double ask; };
+    struct heartbeat { std::uint64_t sequence; };
+    struct news { std::string headline; };
+    struct book { symbol name; std::array<double, 8> levels; };
+
+    struct options
+    {
+        std::size_t capacity = 32;
+        bool tableDispatch = false;
+        unsigned producers = 2;
+        unsigned workers = 2;
+        std::size_t messages = 1'000'000;
+    };
+
+    struct totals
+    {
+        std::uint64_t trades = 0;
+        std::uint64_t volume = 0;
+        double notional = 0;
+        std::uint64_t quotes = 0;
+        double spread = 0;
+        std::uint64_t heartbeats = 0;
+        std::uint64_t news = 0;
+        std::uint64_t newsBytes = 0;
+        std::uint64_t books = 0;
+
+        std::uint64_t handled() const { return trades + quotes + heartbeats + news + books; }
+
+        totals& operator+=(const totals& other)
+        {
+            trades += other.trades;
+            volume += other.volume;
+            notional += other.notional;
+            quotes += other.quotes;
+            spread += other.spread;
+            heartbeats += other.heartbeats;
+            news += other.news;
+            newsBytes += other.newsBytes;
+            books += other.books;
+            return *this;
+        }
+    };
+
+    template <class T>
+    class blocking_queue
+    {
+    public:
+        void push(T value)
+        {
+            {
+                std::lock_guard lock(mutex);
+                items.push_back(std::move(value));
+            }
+            ready.notify_one();
+        }
+        // Moves every queued item into `out`; returns false once the queue is closed and drained.
+        bool pop_all(std::deque<T>& out)
+        {
+            std::unique_lock lock(mutex);
+            ready.wait(lock, [this] { return !items.empty() || closed; });
+            if (items.empty()) return false;
+            out.swap(items);
+            return true;
+        }
+        void close()
+        {
+            {
+                std::lock_guard lock(mutex);
+                closed = true;
+            }
+            ready.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<T> items;
+        bool closed = false;
+    };
+
+    symbol to_symbol(std::string_view text)
+    {
+        symbol name{};
+        std::copy_n(text.begin(), std::min(text.size(), name.size()), name.begin());
+        return name;
+    }
+
+    std::vector<std::string> generate_records(std::size_t count)
+    {
+        constexpr std::array<std::string_view, 6> symbols{"AAPL", "MSFT", "NVDA", "AMZN", "GOOG", "META"};
+        std::vector<std::string> records;
+        records.reserve(count);
+        std::uint64_t state = 42;
+        auto next = [&state](std::uint64_t bound) {
+            state = state * 6364136223846793005u + 1442695040888963407u;
+            return (state >> 33) % bound;
+        };
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto name = symbols[next(symbols.size())];
+            const auto roll = next(100);
+            std::ostringstream line;
+            if (roll < 45) line << "T " << name << ' ' << 1 + next(500) << ' ' << 100 + next(10000) / 100.0;
+            else if (roll < 85) line << "Q " << name << ' ' << 100 + next(10000) / 100.0 << ' ' << 101 + next(10000) / 100.0;
+            else if (roll < 90) line << "H " << i;
+            else if (roll < 95) line << "N " << name << " announces results for quarter " << 1 + next(4) << " ahead of expectations";
+            else
+            {
+                line << "B " << name;
+                for (int level = 0; level < 8; ++level) line << ' ' << 100 + next(10000) / 100.0;
+            }
+            records.push_back(line.str());
+        }
+        return records;
+    }
+
+    template <std::size_t N, class Dispatch>
+    struct message
+    {
+        std::chrono::steady_clock::time_point routed;
+        kmillet::sized_any<N, Dispatch> payload;
+    };
+
+    // Parses `record`, returning an empty payload if it is malformed, and sets `key` to the routing key of the message.
+    template <std::size_t N, class Dispatch>
+    kmillet::sized_any<N, Dispatch> parse(const std::string& record, std::size_t& key)
+    {
+        std::istringstream in(record);
+        char kind = 0;
+        std::string name;
+        in >> kind;
+        switch (kind)
+        {
+        case 'T': {
+            trade t{};
+            in >> name >> t.quantity >> t.price;
+            t.name = to_symbol(name);
+            key = std::hash<std::string>{}(name);
+            return t;
+        }
+        case 'Q': {
+            quote q{};
+            in >> name >> q.bid >> q.ask;
+            q.name = to_symbol(name);
+            key = std::hash<std::string>{}(name);
+            return q;
+        }
+        case 'H': {
+            heartbeat h{};
+            in >> h.sequence;
+            key = h.sequence;
+            return h;
+        }
+        case 'N': {
+            news n;
+            std::getline(in >> std::ws, n.headline);
+            key = n.headline.size();
+            return n;
+        }
+        case 'B': {
+            book b{};
+            in >> name;
+            for (double& level : b.levels) in >> level;
+            b.name = to_symbol(name);
+            key = std::hash<std::string>{}(name);
+            return b;
+        }
+        default:
+            return {};
+        }
+    }
+
+    template <std::size_t N, class Dispatch>
+    int run(const options& opts)
+    {
+        using message_type = message<N, Dispatch>;
+        const std::vector<std::string> records = generate_records(opts.messages);
+        std::vector<blocking_queue<message_type>> queues(opts.workers);
+        std::vector<totals> results(opts.workers);
+        std::vector<std::vector<std::uint64_t>> latencies(opts.workers);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned w = 0; w < opts.workers; ++w)
+        {
+            workers.emplace_back([&, w] {
+                totals& sums = results[w];
+                auto& samples = latencies[w];
+                samples.reserve(opts.messages / opts.workers + 1);
+                kmillet::sized_any_event_bus<N, Dispatch> bus;
+                bus.template subscribe<trade>([&sums](const trade& t) { ++sums.trades; sums.volume += t.quantity; sums.notional += t.quantity * t.price; });
+                bus.template subscribe<quote>([&sums](const quote& q) { ++sums.quotes; sums.spread += q.ask - q.bid; });
+                bus.template subscribe<heartbeat>([&sums](const heartbeat&) { ++sums.heartbeats; });
+                bus.template subscribe<news>([&sums](const news& n) { ++sums.news; sums.newsBytes += n.headline.size(); });
+                bus.template subscribe<book>([&sums](const book&) { ++sums.books; });
+                std::deque<message_type> batch;
+                while (queues[w].pop_all(batch))
+                {
+                    for (auto& msg : batch)
+                    {
+                        bus.publish(msg.payload);
+                        samples.push_back(static_cast<std::uint64_t>((std::chrono::steady_clock::now() - msg.routed).count()));
+                    }
+                    batch.clear();
+                }
+            });
+        }
+        std::vector<std::thread> producers;
+        for (unsigned p = 0; p < opts.producers; ++p)
+        {
+            producers.emplace_back([&, p] {
+                for (std::size_t i = p; i < records.size(); i += opts.producers)
+                {
+                    std::size_t key = 0;
+                    auto payload = parse<N, Dispatch>(records[i], key);
+                    if (!payload.has_value()) continue;
+                    queues[key % opts.workers].push(message_type{std::chrono::steady_clock::now(), std::move(payload)});
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        for (auto& queue : queues) queue.close();
+        for (auto& worker : workers) worker.join();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        totals sum;
+        for (const auto& result : results) sum += result;
+        std::vector<std::uint64_t> samples;
+        for (const auto& worker : latencies) samples.insert(samples.end(), worker.begin(), worker.end());
+        auto percentile = [&samples](double p) -> std::uint64_t {
+            if (samples.empty()) return 0;
+            auto nth = samples.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(samples.size() - 1));
+            std::nth_element(samples.begin(), nth, samples.end());
+            return *nth;
+        };
+
+        std::cout << "capacity=" << N << " dispatch=" << (opts.tableDispatch ? "table" : "virtual")
+                  << " allocator=" << allocatorName
+                  << " producers=" << opts.producers << " workers=" << opts.workers << '\n'
+                  << "handled " << samples.size() << " messages in " << elapsed.count() << " s ("
+                  << static_cast<std::uint64_t>(static_cast<double>(samples.size()) / elapsed.count()) << " msg/s)\n"
+                  << "latency ns: p50=" << percentile(0.5) << " p99=" << percentile(0.99) << " p99.9=" << percentile(0.999)
+                  << " max=" << percentile(1.0) << '\n'
+                  << "trades=" << sum.trades << " volume=" << sum.volume << " quotes=" << sum.quotes << " heartbeats=" << sum.heartbeats
+                  << " news=" << sum.news << " books=" << sum.books << '\n';
+        // Every routed message must have reached exactly one handler.
+        return sum.handled() == samples.size() ? 0 : 1;
+    }
+
+    template <std::size_t N>
+    int run_with_capacity(const options& opts)
+    {
+        if (opts.tableDispatch) return run<N, kmillet::table_dispatch>(opts);
+        return run<N, kmillet::virtual_dispatch>(opts);
+    }
+
+    bool parse_options(int argc, char** argv, options& opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const auto eq = arg.find('=');
+            if (eq == std::string_view::npos) return false;
+            const auto name = arg.substr(0, eq);
+            const std::string value(arg.substr(eq + 1));
+            if (name == "--capacity") opts.capacity = std::strtoull(value.c_str(), nullptr, 10);
+            else if (name == "--dispatch" && (value == "virtual" || value == "table")) opts.tableDispatch = value == "table";
+            else if (name == "--producers") opts.producers = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+            else if (name == "--workers") opts.workers = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+            else if (name == "--messages") opts.messages = std::strtoull(value.c_str(), nullptr, 10);
+            else return false;
+        }
+        return opts.producers > 0 && opts.workers > 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    options opts;
+    if (!parse_options(argc, argv, opts))
+    {
+        std::cerr << "usage: " << argv[0] << " [--capacity=16|32|64|128] [--dispatch=virtual|table]"
+                     " [--producers=P] [--workers=W] [--messages=M]\n";
+        return 2;
+    }
+    switch (opts.capacity)
+    {
+    case 16: return run_with_capacity<16>(opts);
+    case 32: return run_with_capacity<32>(opts);
+    case 64: return run_with_capacity<64>(opts);
+    case 128: return run_with_capacity<128>(opts);
+    default:
+        std::cerr << "unsupported capacity " << opts.capacity << ", expected one of 16, 32, 64 or 128\n";
+        return 2;
+    }
+}
@@ -0,0 +1,412 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file basic_sized_any.hpp
+ * @author Kenan Millet
+ * @brief A type-erased container like `kmillet::sized_any<N>`, whose buffer is caller-provided storage rather than a member.
+ *
+ * This header provides the `kmillet::basic_sized_any<Storage>` class template and the `kmillet::external_storage` storage adaptor.
+ * - `kmillet::basic_sized_any` holds its contents in the byte range designated by a storage adaptor, such as a slot of a preallocated
+ *   message frame or a region of shared memory, so values can be constructed directly where they are needed instead of being copied there.
+ * - Contents are constructed, copied, moved and destroyed by the same type information as `kmillet::sized_any<N>`, with the size of the
+ *   storage as the capacity: contents that fit, are noexcept-movable and whose alignment the storage satisfies are stored in-place,
+ *   others are heap-allocated and the storage holds a pointer.
+ * - Contents can be moved in from and out to `kmillet::sized_any<N>` objects of any size and dispatch policy.
+ * - The type information is held by the `kmillet::basic_sized_any` object itself; the storage only holds the contents.
+ *
+ * A storage adaptor is any type with a `data()` member function that returns a pointer to the first byte of the storage and a `size()`
+ * member function that returns its size, which must be at least the size of a pointer. The storage must outlive the contents,
+ * must stay at the same address, and must be aligned for a pointer.
+ *
+ * @section Usage
+ * @code
+ * alignas(std::max_align_t) std::byte frame[256];
+ * kmillet::basic_sized_any<kmillet::external_storage> slot(kmillet::external_storage(frame + 64, 32));
+ * slot.emplace<order>(id, price, quantity); // constructed directly in the frame
+ * slot = std::move(pending);                // moved in from a kmillet::sized_any<N>
+ * kmillet::any copy = slot.take<kmillet::any::capacity()>();
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <cassert>
+#include <concepts>    // for convertible_to, copy_constructible, constructible_from
+#include <cstdint>     // for uintptr_t
+#include <span>
+#include <type_traits> // for decay_t, remove_cvref_t
+#include <typeinfo>
+#include <utility>     // for forward, move
+#include <cstddef>     // for size_t, byte
+
+namespace kmillet
+{
+    /**
+     * @brief The concept `kmillet::sized_any_storage<S>` is satisfied by the storage adaptors of `kmillet::basic_sized_any`.
+     * @tparam S The type to check.
+     */
+    template<class S>
+    concept sized_any_storage = requires(S& storage, const S& view) {
+        { storage.data() } -> std::convertible_to<void*>;
+        { view.size() } -> std::convertible_to<std::size_t>;
+    };
+
+    /**
+     * @brief A storage adaptor that designates a byte range owned by the caller.
+     */
+    class external_storage
+    {
+    public:
+        /**
+         * @brief Designates the `size` bytes starting at `data`.
+         * @param data The first byte of the storage.
+         * @param size The size of the storage, which must be at least the size of a pointer.
+         */
+        external_storage(void* data, std::size_t size) noexcept
+            : bytes(static_cast<char*>(data)), length(size)
+        {
+            assert(size >= sizeof(void*));
+            assert(reinterpret_cast<std::uintptr_t>(data) % alignof(void*) == 0);
+        }
+        /**
+         * @brief Designates the bytes of `range`.
+         * @param range The storage, which must be at least the size of a pointer.
+         */
+        explicit external_storage(std::span<std::byte> range) noexcept : external_storage(range.data(), range.size()) {}
+
+        /**
+         * @brief Gets the first byte of the storage.
+         * @return A pointer to the first byte of the storage.
+         */
+        [[nodiscard]] char* data() const noexcept { return bytes; }
+        /**
+         * @brief Gets the size of the storage.
+         * @return The number of bytes of the storage.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return length; }
+
+    private:
+    // Member variables
+        char* bytes;
+        std::size_t length;
+    };
+
+    /**
+     * @brief A type-erased container like `kmillet::sized_any`, which holds its contents in storage designated by a storage adaptor.
+     * @tparam Storage The type of the storage adaptor.
+     * @tparam Dispatch The dispatch policy, either `kmillet::virtual_dispatch` or `kmillet::table_dispatch`. Defaults to `kmillet::default_dispatch`.
+     */
+    template<sized_any_storage Storage, class Dispatch = default_dispatch>
+    class basic_sized_any
+    {
+    public:
+        /**
+         * @brief Constructs an object without contents over `storage`.
+         * @param storage The storage adaptor.
+         */
+        explicit basic_sized_any(Storage storage) noexcept(std::is_nothrow_move_constructible_v<Storage>);
+        /**
+         * @brief Constructs an object over `storage`, with initial content of type `std::decay_t<ValueType>` direct-non-list-initialized from `std::forward<Args>(args)...`.
+         * @tparam ValueType The type of the value to be stored.
+         * @tparam Args The types of the arguments to be forwarded to the constructor of `std::decay_t<ValueType>`.
+         * @param storage The storage adaptor.
+         * @param args The arguments to be forwarded to the constructor of `std::decay_t<ValueType>`.
+         */
+        template<class ValueType, class... Args>
+        requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
+        basic_sized_any(Storage storage, std::in_place_type_t<ValueType>, Args&&... args);
+        /**
+         * @brief Not copyable, since a copy would need storage of its own. Use copy assignment to copy contents between storages.
+         */
+        basic_sized_any(const basic_sized_any&) = delete;
+        /**
+         * @brief Destroys the contained object, if any, as if by a call to `reset()`. The storage is left to its owner.
+         */
+        ~basic_sized_any();
+
+        /**
+         * @brief Replaces the contents by a copy of the contents of `rhs`.
+         * @param rhs The object to copy.
+         * @return A reference to `*this`.
+         * @details If the copy throws, `*this` is left without contents.
+         */
+        basic_sized_any& operator=(const basic_sized_any& rhs);
+        /**
+         * @brief Replaces the contents by a copy of the contents of `rhs`.
+         * @tparam N The size of the buffer used by `rhs`.
+         * @tparam OtherDispatch The dispatch policy used by `rhs`.
+         * @param rhs The `kmillet::sized_any<N, OtherDispatch>` to copy.
+         * @return A reference to `*this`.
+         * @details If the copy throws, `*this` is left without contents.
+         */
+        template<std::size_t N, class OtherDispatch>
+        basic_sized_any& operator=(const sized_any<N, OtherDispatch>& rhs);
+        /**
+         * @brief Replaces the contents by the contents of `rhs`, which is left empty.
+         * @tparam N The size of the buffer used by `rhs`.
+         * @tparam OtherDispatch The dispatch policy used by `rhs`.
+         * @param rhs The `kmillet::sized_any<N, OtherDispatch>` to move.
+         * @return A reference to `*this`.
+         * @details Dynamic allocation only occurs if the contents of `rhs` are stored in-place but do not fit in the storage of `*this`.
+         */
+        template<std::size_t N, class OtherDispatch>
+        basic_sized_any& operator=(sized_any<N, OtherDispatch>&& rhs);
+
+        /**
+         * @brief Replaces the contents by an object of type `std::decay_t<ValueType>` constructed from the arguments.
+         * @tparam ValueType The type of the value to be stored.
+         * @tparam Args The types of the arguments to be forwarded to the constructor of `std::decay_t<ValueType>`.
+         * @param args The arguments to be forwarded to the constructor of `std::decay_t<ValueType>`.
+         * @return A reference to the new contained object.
+         * @details The previous contents are destroyed first, so if the construction throws, `*this` is left without contents.
+         */
+        template<class ValueType, class... Args>
+        requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
+        std::decay_t<ValueType>& emplace(Args&&... args);
+        /**
+         * @brief Moves the contents out into a new `kmillet::sized_any<N, OtherDispatch>`, leaving `*this` without contents.
+         * @tparam N The size of the buffer of the result.
+         * @tparam OtherDispatch The dispatch policy of the result.
+         * @return The `kmillet::sized_any<N, OtherDispatch>` that holds the contents.
+         */
+        template<std::size_t N, class OtherDispatch = Dispatch>
+        sized_any<N, OtherDispatch> take();
+
+        /**
+         * @brief Destroys the contained object, if any.
+         */
+        void reset() noexcept;
+        /**
+         * @brief Checks whether the object holds contents.
+         * @return `true` if the object holds contents, otherwise `false`.
+         */
+        [[nodiscard]] bool has_value() const noexcept;
+        /**
+         * @brief Gets the type of the contained object.
+         * @return The `typeid` of the contained object, or `typeid(void)` if there is none.
+         */
+        [[nodiscard]] const std::type_info& type() const noexcept;
+        /**
+         * @brief Gets the storage adaptor.
+         * @return A reference to the storage adaptor.
+         */
+        [[nodiscard]] const Storage& storage() const noexcept { return store; }
+
+    private:
+    // Friend Declarations
+        template<class T, sized_any_storage S, class D>
+        friend const T* any_cast(const basic_sized_any<S, D>* operand) noexcept;
+        template<class T, sized_any_storage S, class D>
+        friend T* any_cast(basic_sized_any<S, D>* operand) noexcept;
+
+        char* Buffer() noexcept { return static_cast<char*>(static_cast<void*>(store.data())); }
+        const char* Buffer() const noexcept { return static_cast<const char*>(static_cast<const void*>(const_cast<Storage&>(store).data())); }
+        std::size_t Capacity() const noexcept { return store.size(); }
+        std::size_t CapacityFor(const details::sized_any::ITypeInfo<Dispatch>* contents) const noexcept;
+
+    // Member variables
+        const details::sized_any::ITypeInfo<Dispatch>* info;
+        Storage store;
+    };
+
+    /**
+     * @brief Performs type-safe access to the contained object.
+     * @tparam T The type to which the contained object should be cast.
+     * @tparam Storage The type of the storage adaptor of `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The pointer to the `kmillet::basic_sized_any` to access.
+     * @return A pointer to the contained object if `operand` is not a null pointer and the `typeid` of `T` matches that of its contents,
+     * otherwise a null pointer.
+     */
+    template<class T, sized_any_storage Storage, class Dispatch>
+    const T* any_cast(const basic_sized_any<Storage, Dispatch>* operand) noexcept;
+    /**
+     * @copydoc any_cast(const basic_sized_any<Storage, Dispatch>*)
+     */
+    template<class T, sized_any_storage Storage, class Dispatch>
+    T* any_cast(basic_sized_any<Storage, Dispatch>* operand) noexcept;
+    /**
+     * @brief Performs type-safe access to the contained object.
+     * @tparam T The type to which the contained object should be cast.
+     * @tparam Storage The type of the storage adaptor of `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The `kmillet::basic_sized_any` to access.
+     * @exception `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the contents of `operand`.
+     * @return `static_cast<T>(*any_cast<std::remove_cvref_t<T>>(&operand))`.
+     */
+    template<class T, sized_any_storage Storage, class Dispatch>
+    T any_cast(const basic_sized_any<Storage, Dispatch>& operand);
+    /**
+     * @copydoc any_cast(const basic_sized_any<Storage, Dispatch>&)
+     */
+    template<class T, sized_any_storage Storage, class Dispatch>
+    T any_cast(basic_sized_any<Storage, Dispatch>& operand);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <kmillet::sized_any_storage Storage, class Dispatch>
+inline kmillet::basic_sized_any<Storage, Dispatch>::basic_sized_any(Storage storage) noexcept(std::is_nothrow_move_constructible_v<Storage>)
+    : info(&(kmillet::details::sized_any::info<void, Dispatch>))
+    , store(std::move(storage))
+{
+    assert(Capacity() >= sizeof(void*));
+    assert(reinterpret_cast<std::uintptr_t>(Buffer()) % alignof(void*) == 0);
+}
+template <kmillet::sized_any_storage Storage, class Dispatch>
+template <class ValueType, class... Args>
+requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
+inline kmillet::basic_sized_any<Storage, Dispatch>::basic_sized_any(Storage storage, std::in_place_type_t<ValueType>, Args&&... args)
+    : basic_sized_any(std::move(storage))
+{
+    emplace<ValueType>(std::forward<Args>(args)...);
+}
+template <kmillet::sized_any_storage Storage, class Dispatch>
+inline kmillet::basic_sized_any<Storage, Dispatch>::~basic_sized_any()
+{
+    reset();
+}
+
+template <kmillet::sized_any_storage Storage, class Dispatch>
+inline kmillet::basic_sized_any<Storage, Dispatch>& kmillet::basic_sized_any<Storage, Dispatch>::operator=(const kmillet::basic_sized_any<Storage, Dispatch>& rhs)
+{
+    if (&rhs == this) return *this;
+    reset();
+    rhs.info->copy(rhs.Buffer(), Buffer(), rhs.CapacityFor(rhs.info), CapacityFor(rhs.info));
+    info = rhs.info;
+    KMILLET_SIZED_ANY_TRACE_EVENT(copy, this, &rhs, info);
+    return *this;
+}
+template <kmillet::sized_any_storage Storage, class Dispatch>
+template <std::size_t N, class OtherDispatch>
+inline kmillet::basic_sized_any<Storage, Dispatch>& kmillet::basic_sized_any<Storage, Dispatch>::operator=(const kmillet::sized_any<N, OtherDispatch>& rhs)
+{
+    using access = kmillet::details::sized_any::access;
+    reset();
+    const auto* rhsInfo = kmillet::details::sized_any::rebind<Dispatch>(access::info(rhs));
+    rhsInfo->copy(access::buffer(rhs), Buffer(), N, CapacityFor(rhsInfo));
+    info = rhsInfo;
+    KMILLET_SIZED_ANY_TRACE_EVENT(copy, this, &rhs, info);
+    return *this;
+}
+template <kmillet::sized_any_storage Storage, class Dispatch>
+template <std::size_t N, class OtherDispatch>
+inline kmillet::basic_sized_any<Storage, Dispatch>& kmillet::basic_sized_any<Storage, Dispatch>::operator=(kmillet::sized_any<N, OtherDispatch>&& rhs)
+{
+    using access = kmillet::details::sized_any::access;
+    reset();
+    const auto* rhsInfo = kmillet::details::sized_any::rebind<Dispatch>(access::info(rhs));
+    rhsInfo->move(access::buffer(rhs), Buffer(), N, CapacityFor(rhsInfo));
+    access::adopt(rhs, &(kmillet::details::sized_any::info<void, OtherDispatch>));
+    info = rhsInfo;
+    KMILLET_SIZED_ANY_TRACE_EVENT(move, this, &rhs, info);
+    return *this;
+}
+
+template <kmillet::sized_any_storage Storage, class Dispatch>
+template <class ValueType, class... Args>
+requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
+inline std::decay_t<ValueType>& kmillet::basic_sized_any<Storage, Dispatch>::emplace(Args&&... args)
+{
+    using T = std::decay_t<ValueType>;
+    using type_info = kmillet::details::sized_any::TypeInfo<T>;
+    const auto* valueInfo = &(kmillet::details::sized_any::info<T, Dispatch>);
+    reset();
+    if (type_info::NeedsAlloc(CapacityFor(valueInfo)))
+    {
+        *reinterpret_cast<void**>(Buffer()) = new T(std::forward<Args>(args)...);
+        info = valueInfo;
+        KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, valueInfo);
+        return **reinterpret_cast<T**>(Buffer());
+    }
+    new (Buffer()) T(std::forward<Args>(args)...);
+    info = valueInfo;
+    KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, valueInfo);
+    return *std::launder(reinterpret_cast<T*>(Buffer()));
+}
+template <kmillet::sized_any_storage Storage, class Dispatch>
+template <std::size_t N, class OtherDispatch>
+inline kmillet::sized_any<N, OtherDispatch> kmillet::basic_sized_any<Storage, Dispatch>::take()
+{
+    using access = kmillet::details::sized_any::access;
+    kmillet::sized_any<N, OtherDispatch> result;
+    if (!has_value()) return result;
+    const auto* resultInfo = kmillet::details::sized_any::rebind<OtherDispatch>(info);
+    info->move(Buffer(), access::buffer(result), CapacityFor(info), N);
+    access::adopt(result, resultInfo);
+    info = &(kmillet::details::sized_any::info<void, Dispatch>);
+    return result;
+}
+
+template <kmillet::sized_any_storage Storage, class Dispatch>
+inline std::size_t kmillet::basic_sized_any<Storage, Dispatch>::CapacityFor(const kmillet::details::sized_any::ITypeInfo<Dispatch>* contents) const noexcept
+{
+    // Storage that is misaligned for the contents is treated as too small for them, so that every operation puts them on the heap.
+    return reinterpret_cast<std::uintptr_t>(Buffer()) % contents->alignment() == 0 ? Capacity() : 0;
+}
+
+template <kmillet::sized_any_storage Storage, class Dispatch>
+inline void kmillet::basic_sized_any<Storage, Dispatch>::reset() noexcept
+{
+    if (info == &(kmillet::details::sized_any::info<void, Dispatch>)) return;
+    KMILLET_SIZED_ANY_TRACE_EVENT(destroy, this, nullptr, info);
+    info->cleanUp(Buffer(), CapacityFor(info));
+    info = &(kmillet::details::sized_any::info<void, Dispatch>);
+}
+template <kmillet::sized_any_storage Storage, class Dispatch>
+inline bool kmillet::basic_sized_any<Storage, Dispatch>::has_value() const noexcept
+{
+    return info != &(kmillet::details::sized_any::info<void, Dispatch>);
+}
+template <kmillet::sized_any_storage Storage, class Dispatch>
+inline const std::type_info& kmillet::basic_sized_any<Storage, Dispatch>::type() const noexcept
+{
+    return info->type();
+}
+
+template <class T, kmillet::sized_any_storage Storage, class Dispatch>
+inline const T* kmillet::any_cast(const kmillet::basic_sized_any<Storage, Dispatch>* operand) noexcept
+{
+    if (!operand) return nullptr;
+    KMILLET_SIZED_ANY_TRACE_EVENT(cast, operand, nullptr, &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>));
+    if (operand->info != &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>)) return nullptr;
+    if (kmillet::details::sized_any::TypeInfo<std::decay_t<T>>::NeedsAlloc(operand->CapacityFor(operand->info)))
+    {
+        return kmillet::details::sized_any::heap<std::decay_t<T>>::get(*reinterpret_cast<const void* const*>(operand->Buffer()));
+    }
+    return std::launder(reinterpret_cast<const T*>(operand->Buffer()));
+}
+template <class T, kmillet::sized_any_storage Storage, class Dispatch>
+inline T* kmillet::any_cast(kmillet::basic_sized_any<Storage, Dispatch>* operand) noexcept
+{
+    if (!operand) return nullptr;
+    KMILLET_SIZED_ANY_TRACE_EVENT(cast, operand, nullptr, &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>));
+    if (operand->info != &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>)) return nullptr;
+    if (kmillet::details::sized_any::TypeInfo<std::decay_t<T>>::NeedsAlloc(operand->CapacityFor(operand->info)))
+    {
+        return kmillet::details::sized_any::heap<std::decay_t<T>>::get(*reinterpret_cast<void**>(operand->Buffer()));
+    }
+    return std::launder(reinterpret_cast<T*>(operand->Buffer()));
+}
+template <class T, kmillet::sized_any_storage Storage, class Dispatch>
+inline T kmillet::any_cast(const kmillet::basic_sized_any<Storage, Dispatch>& operand)
+{
+    if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(*casted);
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
+template <class T, kmillet::sized_any_storage Storage, class Dispatch>
+inline T kmillet::any_cast(kmillet::basic_sized_any<Storage, Dispatch>& operand)
+{
+    if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(*casted);
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
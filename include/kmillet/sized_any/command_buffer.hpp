@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file command_buffer.hpp
+ * @author Kenan Millet
+ * @brief A deferred command buffer that stores heterogeneous commands in packed streams segregated by type.
+ *
+ * This header provides the `kmillet::command_buffer` class template, an alternative to recording commands as `kmillet::any`
+ * and executing them through chains of `kmillet::any_cast`.
+ * - Each command type has its own stream, in which commands are stored contiguously without per-command type information.
+ *   Commands are relocated and destroyed through the same type information as `kmillet::sized_any`, so each stream slot
+ *   behaves like the buffer of a `kmillet::sized_any` of the size of the command: commands that are not noexcept-movable are heap-allocated.
+ * - The order of recording is kept as a sequence of stream indices, so commands can be executed in the order in which they were recorded.
+ * - When the caller does not need that order, `execute_grouped()` runs each stream in a single typed loop, with one indirect call per type.
+ * - Each type has a single handler, registered once.
+ *
+ * @section Usage
+ * @code
+ * kmillet::command_buffer<> commands;
+ * commands.handle<draw>([&](draw& d) { renderer.draw(d); });
+ * commands.handle<clear>([&](clear& c) { renderer.clear(c.color); });
+ * commands.record<clear>(black);
+ * commands.record<draw>(mesh, transform);
+ * commands.execute();         // in recorded order: clear, then draw
+ * // or, if the order does not matter:
+ * commands.execute_grouped(); // every draw, then every clear, each in a tight loop
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <algorithm>     // for max
+#include <concepts>      // for constructible_from, invocable
+#include <cstdint>       // for uint32_t
+#include <memory>        // for shared_ptr, make_shared
+#include <new>           // for align_val_t
+#include <type_traits>   // for decay_t, is_nothrow_move_constructible_v
+#include <unordered_map>
+#include <utility>       // for forward, move
+#include <vector>
+#include <cstddef>       // for size_t, byte
+
+namespace kmillet
+{
+    /**
+     * @brief A buffer of deferred commands of heterogeneous types, stored in one packed stream per type.
+     * @tparam Dispatch The dispatch policy of the type information used to relocate and destroy commands.
+     */
+    template<class Dispatch = default_dispatch>
+    class command_buffer
+    {
+    public:
+        /**
+         * @brief Constructs an empty buffer without handlers.
+         */
+        command_buffer() = default;
+        command_buffer(const command_buffer&) = delete;
+        command_buffer& operator=(const command_buffer&) = delete;
+        ~command_buffer();
+
+        /**
+         * @brief Registers the handler of the commands of type `T`, replacing the previous one if any.
+         * @tparam T The type of the commands to be handled.
+         * @tparam F The type of the handler.
+         * @param handler The handler, invoked with a `T&` referring to each command when it is executed.
+         */
+        template<class T, class F>
+        requires(std::invocable<std::decay_t<F>&, T&>)
+        void handle(F&& handler);
+
+        /**
+         * @brief Records a command of type `T`, direct-non-list-initialized from `std::forward<Args>(args)...`.
+         * @tparam T The type of the command.
+         * @tparam Args The types of the arguments to be forwarded to the constructor of `T`.
+         * @param args The arguments to be forwarded to the constructor of `T`.
+         * @details If no handler is registered for `T` when the command is executed, it is discarded.
+         */
+        template<class T, class... Args>
+        requires(std::constructible_from<T, Args...>)
+        void record(Args&&... args);
+
+        /**
+         * @brief Executes every recorded command in the order in which they were recorded, then discards them.
+         * @return The number of commands that were handled.
+         * @details If a handler throws, the exception is propagated and the remaining commands are discarded.
+         * Commands recorded by handlers during the execution are executed by the next call.
+         */
+        std::size_t execute();
+        /**
+         * @brief Executes every recorded command grouped by type, then discards them.
+         * @return The number of commands that were handled.
+         * @details The commands of each type are executed in the order in which they were recorded, but the commands of different
+         * types are not interleaved: the types are executed in the order in which they were first registered or recorded.
+         * If a handler throws, the exception is propagated and the remaining commands are discarded.
+         * Commands recorded by handlers during the execution are executed by the next call.
+         */
+        std::size_t execute_grouped();
+
+        /**
+         * @brief Discards every recorded command without executing it.
+         */
+        void clear() noexcept;
+        /**
+         * @brief Gets the number of recorded commands.
+         * @return The number of recorded commands.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return order.size(); }
+        /**
+         * @brief Checks whether any command is recorded.
+         * @return `true` if no command is recorded, otherwise `false`.
+         */
+        [[nodiscard]] bool empty() const noexcept { return order.empty(); }
+
+    private:
+        // The commands of a single type. Each slot is laid out like the buffer of a `kmillet::sized_any<stride>`.
+        struct stream
+        {
+            const details::sized_any::ITypeInfo<Dispatch>* info;
+            std::size_t stride;
+            std::size_t alignment;
+            std::byte* data = nullptr;
+            std::size_t count = 0;
+            std::size_t capacity = 0;
+            std::shared_ptr<void> handler = nullptr;
+            void (*invokeOne)(void* handler, std::byte* slot) = nullptr;
+            void (*invokeAll)(void* handler, std::byte* first, std::size_t count) = nullptr;
+        };
+        // Discards the commands of a batch once it has been executed, including when a handler throws.
+        struct batch
+        {
+            ~batch();
+
+            command_buffer& owner;
+            std::vector<stream> streams;
+            std::vector<std::uint32_t> order;
+        };
+
+        template<class T> static constexpr std::size_t Stride() noexcept;
+        template<class T> static T& Get(std::byte* slot) noexcept;
+        template<class T, class F> static void InvokeOne(void* handler, std::byte* slot);
+        template<class T, class F> static void InvokeAll(void* handler, std::byte* first, std::size_t count);
+        template<class T> std::uint32_t Stream();
+        void Grow(stream& s);
+        static void Destroy(stream& s) noexcept;
+        batch Take();
+
+    // Member variables
+        std::vector<stream> streams;
+        std::unordered_map<const void*, std::uint32_t> indices;
+        std::vector<std::uint32_t> order; // the stream index of each command, in recording order
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class Dispatch>
+inline kmillet::command_buffer<Dispatch>::~command_buffer()
+{
+    clear();
+    for (stream& s : streams) ::operator delete(s.data, std::align_val_t(s.alignment));
+}
+
+template <class Dispatch>
+template <class T, class F>
+requires(std::invocable<std::decay_t<F>&, T&>)
+inline void kmillet::command_buffer<Dispatch>::handle(F&& handler)
+{
+    stream& s = streams[Stream<T>()];
+    s.handler = std::make_shared<std::decay_t<F>>(std::forward<F>(handler));
+    s.invokeOne = &InvokeOne<T, std::decay_t<F>>;
+    s.invokeAll = &InvokeAll<T, std::decay_t<F>>;
+}
+
+template <class Dispatch>
+template <class T, class... Args>
+requires(std::constructible_from<T, Args...>)
+inline void kmillet::command_buffer<Dispatch>::record(Args&&... args)
+{
+    const std::uint32_t index = Stream<T>();
+    stream& s = streams[index];
+    if (s.count == s.capacity) Grow(s);
+    // Growing the order beforehand leaves nothing that can throw once the command is constructed.
+    if (order.size() == order.capacity()) order.reserve(std::max<std::size_t>(16, 2 * order.capacity()));
+    std::byte* slot = s.data + s.count * s.stride;
+    if constexpr (kmillet::details::sized_any::TypeInfo<T>::NeedsAlloc(Stride<T>()))
+    {
+        *reinterpret_cast<T**>(slot) = new T(std::forward<Args>(args)...);
+    }
+    else new (slot) T(std::forward<Args>(args)...);
+    ++s.count;
+    order.push_back(index);
+}
+
+template <class Dispatch>
+inline std::size_t kmillet::command_buffer<Dispatch>::execute()
+{
+    batch b = Take();
+    std::vector<std::byte*> cursors(b.streams.size());
+    for (std::size_t i = 0; i < b.streams.size(); ++i) cursors[i] = b.streams[i].data;
+    std::size_t handled = 0;
+    for (const std::uint32_t index : b.order)
+    {
+        const stream& s = b.streams[index];
+        std::byte* slot = cursors[index];
+        cursors[index] += s.stride;
+        if (!s.handler) continue;
+        s.invokeOne(s.handler.get(), slot);
+        ++handled;
+    }
+    return handled;
+}
+template <class Dispatch>
+inline std::size_t kmillet::command_buffer<Dispatch>::execute_grouped()
+{
+    batch b = Take();
+    std::size_t handled = 0;
+    for (const stream& s : b.streams)
+    {
+        if (!s.handler || s.count == 0) continue;
+        s.invokeAll(s.handler.get(), s.data, s.count);
+        handled += s.count;
+    }
+    return handled;
+}
+
+template <class Dispatch>
+inline void kmillet::command_buffer<Dispatch>::clear() noexcept
+{
+    for (stream& s : streams) Destroy(s);
+    order.clear();
+}
+
+template <class Dispatch>
+inline kmillet::command_buffer<Dispatch>::batch::~batch()
+{
+    // Hand the storage back to the owner for reuse, unless it has grown in the meantime.
+    for (std::size_t i = 0; i < streams.size(); ++i)
+    {
+        stream& s = streams[i];
+        Destroy(s);
+        stream& current = owner.streams[i];
+        if (current.count == 0 && current.capacity < s.capacity)
+        {
+            ::operator delete(current.data, std::align_val_t(current.alignment));
+            current.data = s.data;
+            current.capacity = s.capacity;
+        }
+        else ::operator delete(s.data, std::align_val_t(s.alignment));
+    }
+    if (owner.order.empty() && owner.order.capacity() < order.capacity())
+    {
+        order.clear();
+        owner.order.swap(order);
+    }
+}
+
+template <class Dispatch>
+template <class T>
+inline constexpr std::size_t kmillet::command_buffer<Dispatch>::Stride() noexcept
+{
+    // Commands that cannot be stored in-place are stored as a pointer to a heap allocation, as in `kmillet::sized_any`.
+    if constexpr (!std::is_nothrow_move_constructible_v<T>) return sizeof(void*);
+    else return (sizeof(T) + alignof(T) - 1) / alignof(T) * alignof(T);
+}
+template <class Dispatch>
+template <class T>
+inline T& kmillet::command_buffer<Dispatch>::Get(std::byte* slot) noexcept
+{
+    if constexpr (kmillet::details::sized_any::TypeInfo<T>::NeedsAlloc(Stride<T>())) return **reinterpret_cast<T**>(slot);
+    else return *std::launder(reinterpret_cast<T*>(slot));
+}
+template <class Dispatch>
+template <class T, class F>
+inline void kmillet::command_buffer<Dispatch>::InvokeOne(void* handler, std::byte* slot)
+{
+    (*static_cast<F*>(handler))(Get<T>(slot));
+}
+template <class Dispatch>
+template <class T, class F>
+inline void kmillet::command_buffer<Dispatch>::InvokeAll(void* handler, std::byte* first, std::size_t count)
+{
+    F& f = *static_cast<F*>(handler);
+    for (std::size_t i = 0; i < count; ++i) f(Get<T>(first + i * Stride<T>()));
+}
+
+template <class Dispatch>
+template <class T>
+inline std::uint32_t kmillet::command_buffer<Dispatch>::Stream()
+{
+    const auto* info = &(kmillet::details::sized_any::info<T, Dispatch>);
+    if (auto it = indices.find(info); it != indices.end()) return it->second;
+    const auto index = static_cast<std::uint32_t>(streams.size());
+    stream s{info, Stride<T>(), kmillet::details::sized_any::TypeInfo<T>::NeedsAlloc(Stride<T>()) ? alignof(void*) : alignof(T)};
+    streams.push_back(std::move(s));
+    indices.emplace(info, index);
+    return index;
+}
+template <class Dispatch>
+inline void kmillet::command_buffer<Dispatch>::Grow(stream& s)
+{
+    const std::size_t capacity = std::max<std::size_t>(8, 2 * s.capacity);
+    auto* data = static_cast<std::byte*>(::operator new(capacity * s.stride, std::align_val_t(s.alignment)));
+    // Slots only hold noexcept-movable objects or pointers, so relocating them cannot throw.
+    for (std::size_t i = 0; i < s.count; ++i)
+    {
+        s.info->move(s.data + i * s.stride, reinterpret_cast<char*>(data + i * s.stride), s.stride, s.stride);
+    }
+    ::operator delete(s.data, std::align_val_t(s.alignment));
+    s.data = data;
+    s.capacity = capacity;
+}
+template <class Dispatch>
+inline void kmillet::command_buffer<Dispatch>::Destroy(stream& s) noexcept
+{
+    for (std::size_t i = 0; i < s.count; ++i) s.info->cleanUp(s.data + i * s.stride, s.stride);
+    s.count = 0;
+}
+template <class Dispatch>
+inline typename kmillet::command_buffer<Dispatch>::batch kmillet::command_buffer<Dispatch>::Take()
+{
+    // The recorded commands are detached before execution, so that handlers can record new commands safely.
+    batch b{*this, streams, std::move(order)};
+    for (stream& s : streams)
+    {
+        s.data = nullptr;
+        s.count = 0;
+        s.capacity = 0;
+    }
+    order.clear();
+    return b;
+}
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file dispatcher.hpp
+ * @author Kenan Millet
+ * @brief Dispatch of `kmillet::sized_any<N>` values to typed handlers through a hashed table and per-call-site inline caches.
+ *
+ * This header provides the `kmillet::dispatcher<N, R>` class template, an alternative to trying `kmillet::any_cast` for each candidate type in turn.
+ * - Handlers are indexed by the type information pointer of their type in an open-addressing hash table, so resolving a value
+ *   to its handler costs one hash and usually one probe, however many handlers there are.
+ * - A `kmillet::dispatcher<N, R>::site` kept at a call site remembers the handlers of the last few types seen there. Once it is warm,
+ *   dispatching a value costs one or two pointer comparisons and the indirect call to the handler.
+ * - Values whose type has no handler, including empty values, are passed to a fallback.
+ *
+ * @section Usage
+ * @code
+ * kmillet::dispatcher<32, double> area;
+ * area.on<circle>([](const circle& c) { return 3.14159 * c.r * c.r; })
+ *     .on<square>([](const square& s) { return s.side * s.side; });
+ * static thread_local kmillet::dispatcher<32, double>::site cache; // one per call site and thread
+ * for (const auto& shape : shapes) total += area(cache, shape);
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <algorithm>     // for max
+#include <array>
+#include <atomic>        // for atomic
+#include <bit>           // for bit_ceil
+#include <concepts>      // for invocable, default_initializable
+#include <cstdint>       // for uintptr_t, uint64_t
+#include <functional>    // for invoke
+#include <memory>        // for shared_ptr, make_shared
+#include <type_traits>   // for decay_t, is_invocable_r_v, is_void_v
+#include <utility>       // for forward
+#include <vector>
+#include <cstddef>       // for size_t
+
+// Private utilities for kmillet::dispatcher
+namespace kmillet::details::dispatcher
+{
+    // Returns a generation that no table of any dispatcher has had before, so that a site filled by a destroyed dispatcher
+    // is never mistaken for a valid cache of another one constructed at the same address.
+    inline std::uint64_t next_generation() noexcept
+    {
+        static std::atomic<std::uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+}
+
+namespace kmillet
+{
+    /**
+     * @brief Dispatches `kmillet::sized_any<N, Dispatch>` values to the handler registered for the type of their contents.
+     * @tparam N The size of the buffer of the dispatched values.
+     * @tparam R The result type of the handlers.
+     * @tparam Dispatch The dispatch policy of the dispatched values.
+     * @details Handlers must be registered before values are dispatched; registering a handler while another thread dispatches is a data race.
+     */
+    template<std::size_t N, class R = void, class Dispatch = default_dispatch>
+    class dispatcher
+    {
+    public:
+        /**
+         * @brief The type of the dispatched values.
+         */
+        using value_type = sized_any<N, Dispatch>;
+
+        /**
+         * @brief An inline cache of the handlers of the last types dispatched at a call site.
+         * @details A site is not thread-safe, so each thread should use its own, for instance by declaring it `static thread_local`.
+         * A site may be used with several dispatchers, but it is most effective when used with a single one.
+         */
+        class site
+        {
+        public:
+            /**
+             * @brief The number of types that a site remembers.
+             */
+            static constexpr std::size_t ways = 4;
+
+        private:
+            friend class dispatcher;
+
+            struct entry
+            {
+                const void* key = nullptr;
+                R (*invoke)(void* handler, const value_type& operand) = nullptr;
+                void* handler = nullptr;
+            };
+
+        // Member variables
+            std::array<entry, ways> entries{};
+            const dispatcher* owner = nullptr;
+            std::uint64_t generation = 0;
+            std::size_t next = 0;
+        };
+
+        /**
+         * @brief Constructs a dispatcher without handlers, whose fallback does nothing and returns a value-initialized `R`.
+         */
+        dispatcher() requires(std::is_void_v<R> || std::default_initializable<R>);
+        /**
+         * @brief Constructs a dispatcher without handlers.
+         * @tparam F The type of the fallback.
+         * @param fallback Invoked with the value if no handler is registered for the type of its contents, or if it is empty.
+         */
+        template<class F>
+        requires(std::is_invocable_r_v<R, std::decay_t<F>&, const sized_any<N, Dispatch>&>)
+        explicit dispatcher(F&& fallback);
+        dispatcher(const dispatcher&) = delete;
+        dispatcher& operator=(const dispatcher&) = delete;
+
+        /**
+         * @brief Registers the handler of values whose contents are of type `T`, replacing the previous one if any.
+         * @tparam T The type of the contents to be handled.
+         * @tparam F The type of the handler.
+         * @param handler The handler, invoked with a `const T&` referring to the contents of each matching value.
+         * @return A reference to `*this`.
+         */
+        template<class T, class F>
+        requires(std::is_invocable_r_v<R, std::decay_t<F>&, const T&>)
+        dispatcher& on(F&& handler);
+
+        /**
+         * @brief Invokes the handler of the type of the contents of `operand`, found through the hash table.
+         * @param operand The value to be dispatched.
+         * @return The result of the handler or of the fallback.
+         */
+        R operator()(const value_type& operand) const;
+        /**
+         * @brief Invokes the handler of the type of the contents of `operand`, found through `cache` or, on a miss, through the hash table.
+         * @param cache The inline cache of the call site, which is updated on a miss.
+         * @param operand The value to be dispatched.
+         * @return The result of the handler or of the fallback.
+         */
+        R operator()(site& cache, const value_type& operand) const;
+
+        /**
+         * @brief Gets the number of registered handlers.
+         * @return The number of types that have a handler.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return handlers.size(); }
+
+    private:
+        using entry = typename site::entry;
+
+        template<class T, class F>
+        static R Invoke(void* handler, const value_type& operand);
+        template<class F>
+        static R Fallback(void* handler, const value_type& operand);
+        static std::size_t Hash(const void* key) noexcept;
+        const entry* Find(const void* key) const noexcept;
+        void Rebuild();
+
+    // Member variables
+        std::vector<std::shared_ptr<void>> handlers;
+        std::vector<entry> registered;
+        std::vector<entry> table;  // open addressing with linear probing; its size is a power of two
+        entry fallback;
+        std::shared_ptr<void> fallbackHandler;
+        std::uint64_t generation = 0;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class R, class Dispatch>
+inline kmillet::dispatcher<N, R, Dispatch>::dispatcher() requires(std::is_void_v<R> || std::default_initializable<R>)
+    : dispatcher([](const value_type&) -> R { return R(); })
+{}
+template <std::size_t N, class R, class Dispatch>
+template <class F>
+requires(std::is_invocable_r_v<R, std::decay_t<F>&, const kmillet::sized_any<N, Dispatch>&>)
+inline kmillet::dispatcher<N, R, Dispatch>::dispatcher(F&& fallback)
+    : fallbackHandler(std::make_shared<std::decay_t<F>>(std::forward<F>(fallback)))
+{
+    this->fallback = {nullptr, &Fallback<std::decay_t<F>>, fallbackHandler.get()};
+    Rebuild();
+}
+
+template <std::size_t N, class R, class Dispatch>
+template <class T, class F>
+requires(std::is_invocable_r_v<R, std::decay_t<F>&, const T&>)
+inline kmillet::dispatcher<N, R, Dispatch>& kmillet::dispatcher<N, R, Dispatch>::on(F&& handler)
+{
+    const void* key = &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>);
+    auto owned = std::make_shared<std::decay_t<F>>(std::forward<F>(handler));
+    const entry e{key, &Invoke<std::decay_t<T>, std::decay_t<F>>, owned.get()};
+    std::size_t i = 0;
+    while (i < registered.size() && registered[i].key != key) ++i;
+    if (i == registered.size())
+    {
+        registered.push_back(e);
+        handlers.push_back(std::move(owned));
+    }
+    else
+    {
+        registered[i] = e;
+        handlers[i] = std::move(owned);
+    }
+    Rebuild();
+    return *this;
+}
+
+template <std::size_t N, class R, class Dispatch>
+inline R kmillet::dispatcher<N, R, Dispatch>::operator()(const value_type& operand) const
+{
+    const entry* e = Find(kmillet::details::sized_any::access::info(operand));
+    if (!e) e = &fallback;
+    return e->invoke(e->handler, operand);
+}
+template <std::size_t N, class R, class Dispatch>
+inline R kmillet::dispatcher<N, R, Dispatch>::operator()(site& cache, const value_type& operand) const
+{
+    const void* key = kmillet::details::sized_any::access::info(operand);
+    if (cache.owner == this && cache.generation == generation)
+    {
+        for (const entry& e : cache.entries)
+        {
+            if (e.key == key) return e.invoke(e.handler, operand);
+        }
+    }
+    else
+    {
+        // The cache was filled by another dispatcher, or before handlers were registered.
+        cache.entries = {};
+        cache.owner = this;
+        cache.generation = generation;
+        cache.next = 0;
+    }
+    const entry* e = Find(key);
+    if (!e) return fallback.invoke(fallback.handler, operand);
+    cache.entries[cache.next] = *e;
+    cache.next = (cache.next + 1) % site::ways;
+    return e->invoke(e->handler, operand);
+}
+
+template <std::size_t N, class R, class Dispatch>
+template <class T, class F>
+inline R kmillet::dispatcher<N, R, Dispatch>::Invoke(void* handler, const value_type& operand)
+{
+    if constexpr (std::is_void_v<R>) std::invoke(*static_cast<F*>(handler), kmillet::details::sized_any::access::unchecked<T>(operand));
+    else return std::invoke(*static_cast<F*>(handler), kmillet::details::sized_any::access::unchecked<T>(operand));
+}
+template <std::size_t N, class R, class Dispatch>
+template <class F>
+inline R kmillet::dispatcher<N, R, Dispatch>::Fallback(void* handler, const value_type& operand)
+{
+    if constexpr (std::is_void_v<R>) std::invoke(*static_cast<F*>(handler), operand);
+    else return std::invoke(*static_cast<F*>(handler), operand);
+}
+template <std::size_t N, class R, class Dispatch>
+inline std::size_t kmillet::dispatcher<N, R, Dispatch>::Hash(const void* key) noexcept
+{
+    // Type information objects are at least pointer-aligned, so the low bits carry no information.
+    const auto bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key));
+    return static_cast<std::size_t>((bits >> 3) * 0x9E3779B97F4A7C15ull >> 32);
+}
+template <std::size_t N, class R, class Dispatch>
+inline const typename kmillet::dispatcher<N, R, Dispatch>::entry* kmillet::dispatcher<N, R, Dispatch>::Find(const void* key) const noexcept
+{
+    const std::size_t mask = table.size() - 1;
+    for (std::size_t i = Hash(key) & mask;; i = (i + 1) & mask)
+    {
+        if (table[i].key == key) return &table[i];
+        if (!table[i].key) return nullptr;
+    }
+}
+template <std::size_t N, class R, class Dispatch>
+inline void kmillet::dispatcher<N, R, Dispatch>::Rebuild()
+{
+    // At most half of the slots are used, so probe sequences stay short and always reach an empty slot.
+    std::vector<entry> rebuilt(std::bit_ceil(std::max<std::size_t>(8, 2 * registered.size())));
+    const std::size_t mask = rebuilt.size() - 1;
+    for (const entry& e : registered)
+    {
+        std::size_t i = Hash(e.key) & mask;
+        while (rebuilt[i].key) i = (i + 1) & mask;
+        rebuilt[i] = e;
+    }
+    table = std::move(rebuilt);
+    generation = kmillet::details::dispatcher::next_generation();
+}
@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file dynamic_record.hpp
+ * @author Kenan Millet
+ * @brief A record of runtime-defined fields, stored packed in a single allocation and described by a shared schema.
+ *
+ * This header provides the `kmillet::record_schema` and `kmillet::dynamic_record` classes, an alternative to `std::vector<kmillet::any>` for rows of heterogeneous values.
+ * - The schema is built once and shared by every record. It holds the type, offset and type-erased operations of each field,
+ *   so records carry no per-field type information and no per-field buffer padding.
+ * - Each record stores all of its fields in one allocation, laid out at the offsets computed by the schema.
+ * - Fields are accessed by index with `get<T>`, which checks the type through the same type information as `kmillet::sized_any`.
+ * - Records whose fields are all trivially copyable are copied with a single `memcpy`.
+ *
+ * @section Usage
+ * @code
+ * kmillet::record_schema schema;
+ * const std::size_t id = schema.add<int>();
+ * const std::size_t name = schema.add<std::string>();
+ * auto shared = std::make_shared<const kmillet::record_schema>(std::move(schema));
+ * kmillet::dynamic_record row(shared);  // fields are value-initialized
+ * row.get<int>(id) = 7;
+ * row.get<std::string>(name) = "seven";
+ * kmillet::dynamic_record copy = row;   // copies every field through the schema
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <algorithm>   // for max
+#include <concepts>    // for default_initializable, copy_constructible
+#include <cstring>     // for memcpy
+#include <memory>      // for shared_ptr
+#include <new>         // for align_val_t
+#include <type_traits> // for is_trivially_copyable_v, is_trivially_destructible_v
+#include <typeinfo>
+#include <utility>     // for exchange
+#include <vector>
+#include <cstddef>     // for size_t, byte
+
+namespace kmillet
+{
+    /**
+     * @brief Describes the fields of `kmillet::dynamic_record` objects: their types, their offsets and how to construct, copy and destroy them.
+     * @details Fields can be added until the schema is used by a `kmillet::dynamic_record`, after which it must not be modified.
+     */
+    class record_schema
+    {
+    public:
+        /**
+         * @brief Constructs a schema without fields.
+         */
+        record_schema() = default;
+
+        /**
+         * @brief Appends a field of type `T`.
+         * @tparam T The type of the field, which is value-initialized in new records.
+         * @return The index of the new field.
+         */
+        template<class T>
+        requires(std::default_initializable<T> && std::copy_constructible<T>)
+        std::size_t add();
+
+        /**
+         * @brief Gets the number of fields.
+         * @return The number of fields.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return fields.size(); }
+        /**
+         * @brief Gets the type of a field.
+         * @param index The index of the field.
+         * @return The `typeid` of the type of the field.
+         */
+        [[nodiscard]] const std::type_info& type(std::size_t index) const noexcept { return fields[index].info->type(); }
+        /**
+         * @brief Gets the size of the storage of each record.
+         * @return The number of bytes allocated by each record.
+         */
+        [[nodiscard]] std::size_t record_size() const noexcept { return bytes; }
+        /**
+         * @brief Gets the alignment of the storage of each record.
+         * @return The alignment of the storage, which is the strictest alignment of the fields.
+         */
+        [[nodiscard]] std::size_t record_alignment() const noexcept { return alignment; }
+
+    private:
+        friend class dynamic_record;
+
+        struct field
+        {
+            const details::sized_any::ITypeInfo<default_dispatch>* info;
+            std::size_t offset;
+            void (*construct)(void* to);
+            void (*copy)(const void* from, void* to);
+            void (*destroy)(void* at) noexcept;
+        };
+
+        template<class T> static void Construct(void* to);
+        template<class T> static void Copy(const void* from, void* to);
+        template<class T> static void Destroy(void* at) noexcept;
+
+    // Member variables
+        std::vector<field> fields;
+        std::size_t bytes = 0;
+        std::size_t alignment = alignof(std::byte);
+        bool trivial = true;
+    };
+
+    /**
+     * @brief A record whose fields are described by a shared `kmillet::record_schema` and stored packed in a single allocation.
+     */
+    class dynamic_record
+    {
+    public:
+        /**
+         * @brief Constructs a record with every field of `schema` value-initialized.
+         * @param schema The schema of the record.
+         */
+        explicit dynamic_record(std::shared_ptr<const record_schema> schema);
+        /**
+         * @brief Copies every field of `other` into a new record with the same schema.
+         * @param other The record to copy.
+         */
+        dynamic_record(const dynamic_record& other);
+        /**
+         * @brief Takes the storage of `other`, which is left without storage; it may then only be destroyed or assigned to.
+         * @param other The record to move.
+         */
+        dynamic_record(dynamic_record&& other) noexcept;
+        ~dynamic_record();
+
+        /**
+         * @brief Assigns by copying the schema and every field of `rhs`.
+         * @param rhs The record to copy.
+         * @return A reference to `*this`.
+         */
+        dynamic_record& operator=(const dynamic_record& rhs);
+        /**
+         * @brief Assigns by taking the schema and storage of `rhs`.
+         * @param rhs The record to move.
+         * @return A reference to `*this`.
+         */
+        dynamic_record& operator=(dynamic_record&& rhs) noexcept;
+
+        /**
+         * @brief Accesses a field, checking its type.
+         * @tparam T The type of the field.
+         * @param index The index of the field.
+         * @return A reference to the field.
+         * @exception `std::bad_any_cast` if the type of the field is not `T`.
+         */
+        template<class T>
+        T& get(std::size_t index);
+        /**
+         * @copydoc get
+         */
+        template<class T>
+        const T& get(std::size_t index) const;
+        /**
+         * @brief Accesses a field, checking its type.
+         * @tparam T The type of the field.
+         * @param index The index of the field.
+         * @return A pointer to the field, or `nullptr` if the type of the field is not `T`.
+         */
+        template<class T>
+        T* get_if(std::size_t index) noexcept;
+        /**
+         * @copydoc get_if
+         */
+        template<class T>
+        const T* get_if(std::size_t index) const noexcept;
+
+        /**
+         * @brief Gets the schema of the record.
+         * @return The schema.
+         */
+        [[nodiscard]] const record_schema& schema() const noexcept { return *layout; }
+
+    private:
+        // Constructs the fields of `data` one by one, destroying the constructed ones if one throws.
+        template<class F>
+        static void ConstructFields(const record_schema& schema, std::byte* data, F construct);
+        static std::byte* Allocate(const record_schema& schema);
+        static void Deallocate(const record_schema& schema, std::byte* data) noexcept;
+        void Release() noexcept;
+
+    // Member variables
+        std::shared_ptr<const record_schema> layout;
+        std::byte* data;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class T>
+requires(std::default_initializable<T> && std::copy_constructible<T>)
+inline std::size_t kmillet::record_schema::add()
+{
+    const std::size_t offset = (bytes + alignof(T) - 1) / alignof(T) * alignof(T);
+    fields.push_back({&(kmillet::details::sized_any::info<T>), offset, &Construct<T>, &Copy<T>, &Destroy<T>});
+    bytes = offset + sizeof(T);
+    alignment = std::max(alignment, alignof(T));
+    trivial = trivial && std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>;
+    return fields.size() - 1;
+}
+
+template <class T>
+inline void kmillet::record_schema::Construct(void* to)
+{
+    new (to) T();
+}
+template <class T>
+inline void kmillet::record_schema::Copy(const void* from, void* to)
+{
+    new (to) T(*static_cast<const T*>(from));
+}
+template <class T>
+inline void kmillet::record_schema::Destroy(void* at) noexcept
+{
+    static_cast<T*>(at)->~T();
+}
+
+inline kmillet::dynamic_record::dynamic_record(std::shared_ptr<const kmillet::record_schema> schema)
+    : layout(std::move(schema))
+    , data(Allocate(*layout))
+{
+    ConstructFields(*layout, data, [this](const kmillet::record_schema::field& f) { f.construct(data + f.offset); });
+}
+inline kmillet::dynamic_record::dynamic_record(const kmillet::dynamic_record& other)
+    : layout(other.layout)
+    , data(Allocate(*layout))
+{
+    if (layout->trivial) std::memcpy(data, other.data, layout->bytes);
+    else ConstructFields(*layout, data, [this, &other](const kmillet::record_schema::field& f) { f.copy(other.data + f.offset, data + f.offset); });
+}
+inline kmillet::dynamic_record::dynamic_record(kmillet::dynamic_record&& other) noexcept
+    : layout(std::move(other.layout))
+    , data(std::exchange(other.data, nullptr))
+{}
+inline kmillet::dynamic_record::~dynamic_record()
+{
+    Release();
+}
+
+inline kmillet::dynamic_record& kmillet::dynamic_record::operator=(const kmillet::dynamic_record& rhs)
+{
+    if (&rhs == this) return *this;
+    return *this = kmillet::dynamic_record(rhs);
+}
+inline kmillet::dynamic_record& kmillet::dynamic_record::operator=(kmillet::dynamic_record&& rhs) noexcept
+{
+    if (&rhs == this) return *this;
+    Release();
+    layout = std::move(rhs.layout);
+    data = std::exchange(rhs.data, nullptr);
+    return *this;
+}
+
+template <class T>
+inline T& kmillet::dynamic_record::get(std::size_t index)
+{
+    if (T* field = get_if<T>(index)) return *field;
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
+template <class T>
+inline const T& kmillet::dynamic_record::get(std::size_t index) const
+{
+    if (const T* field = get_if<T>(index)) return *field;
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
+template <class T>
+inline T* kmillet::dynamic_record::get_if(std::size_t index) noexcept
+{
+    const auto& f = layout->fields[index];
+    if (f.info != &(kmillet::details::sized_any::info<T>)) return nullptr;
+    return std::launder(reinterpret_cast<T*>(data + f.offset));
+}
+template <class T>
+inline const T* kmillet::dynamic_record::get_if(std::size_t index) const noexcept
+{
+    const auto& f = layout->fields[index];
+    if (f.info != &(kmillet::details::sized_any::info<T>)) return nullptr;
+    return std::launder(reinterpret_cast<const T*>(data + f.offset));
+}
+
+template <class F>
+inline void kmillet::dynamic_record::ConstructFields(const kmillet::record_schema& schema, std::byte* data, F construct)
+{
+    std::size_t constructed = 0;
+#if defined(__cpp_exceptions)
+    try
+    {
+        for (; constructed < schema.fields.size(); ++constructed) construct(schema.fields[constructed]);
+    }
+    catch (...)
+    {
+        while (constructed > 0)
+        {
+            const auto& f = schema.fields[--constructed];
+            f.destroy(data + f.offset);
+        }
+        Deallocate(schema, data);
+        throw;
+    }
+#else
+    for (; constructed < schema.fields.size(); ++constructed) construct(schema.fields[constructed]);
+#endif
+}
+inline std::byte* kmillet::dynamic_record::Allocate(const kmillet::record_schema& schema)
+{
+    return static_cast<std::byte*>(::operator new(std::max<std::size_t>(schema.bytes, 1), std::align_val_t(schema.alignment)));
+}
+inline void kmillet::dynamic_record::Deallocate(const kmillet::record_schema& schema, std::byte* data) noexcept
+{
+    ::operator delete(data, std::align_val_t(schema.alignment));
+}
+inline void kmillet::dynamic_record::Release() noexcept
+{
+    if (!data) return;
+    if (!layout->trivial)
+    {
+        for (const auto& f : layout->fields) f.destroy(data + f.offset);
+    }
+    Deallocate(*layout, std::exchange(data, nullptr));
+}
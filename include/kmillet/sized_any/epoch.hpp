@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file epoch.hpp
+ * @author Kenan Millet
+ * @brief Epoch-based reclamation of the immutable objects that the concurrent containers of this library publish to their readers.
+ *
+ * This header provides `kmillet::details::epoch`, which is private to this library.
+ * - A reader enters a critical section with a `guard`, loads a published pointer and reads through it without taking any lock.
+ *   Entering and leaving only write to a cache line owned by the calling thread, so readers never wait and do not contend with each other.
+ * - A writer that replaces a published object hands the old one to a `retired_list`, which destroys it once every reader that could
+ *   still be reading it has left its critical section. Writers never wait for readers either: a retired object whose readers are still
+ *   inside their critical sections is only destroyed by a later call to `reclaim`, or when the list itself is destroyed.
+ * - Guards nest, so a reader may publish or read again from inside its critical section, for instance from a handler it invokes.
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <algorithm> // for max, remove_if
+#include <atomic>    // for atomic, memory_order
+#include <vector>
+#include <cstddef>   // for size_t
+#include <cstdint>   // for uint64_t
+
+// Private utilities for the concurrent containers of this library
+namespace kmillet::details::epoch
+{
+    // The state of a thread that has entered a critical section. Records are never freed, and are reused by new threads once theirs exits.
+    struct alignas(64) record
+    {
+        std::atomic<std::uint64_t> pinned{0}; // the epoch observed by the outermost guard, or 0 outside of any critical section
+        std::atomic<bool> owned{true};
+        std::size_t depth = 0;                // only accessed by the owning thread
+        record* next = nullptr;
+    };
+
+    // Epochs start at 1, so that 0 marks a thread outside of any critical section.
+    inline std::atomic<std::uint64_t> global{1};
+    inline std::atomic<record*> records{nullptr};
+
+    // Returns the record of the calling thread, claiming one the first time the thread enters a critical section.
+    record& local();
+    // Moves the global epoch forward if every thread inside a critical section has observed it, and returns the global epoch.
+    std::uint64_t try_advance() noexcept;
+
+    // Keeps the objects published before it was constructed from being destroyed until it is destroyed.
+    class guard
+    {
+    public:
+        guard();
+        ~guard();
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+    private:
+        record& self;
+    };
+
+    // Objects that were unpublished by a writer and are waiting for their readers to leave. Not thread-safe: its owner serializes its writers.
+    class retired_list
+    {
+    public:
+        retired_list() = default;
+        retired_list(const retired_list&) = delete;
+        retired_list& operator=(const retired_list&) = delete;
+        // Destroys every retired object, which requires that no reader is left.
+        ~retired_list();
+
+        // Makes room for one more object, so that retiring it cannot throw once it has been unpublished.
+        void reserve();
+        // Retires an object that readers can no longer load, to be destroyed with `delete` once the readers that loaded it have left.
+        // Must follow a call to `reserve`.
+        template<class T>
+        void retire(const T* object) noexcept;
+        // Destroys the retired objects that no reader can still be reading.
+        void reclaim() noexcept;
+
+    private:
+        struct entry
+        {
+            const void* object;
+            void (*destroy)(const void* object) noexcept;
+            std::uint64_t epoch;
+        };
+
+        template<class T>
+        static void Destroy(const void* object) noexcept { delete static_cast<const T*>(object); }
+
+    // Member variables
+        std::vector<entry> list;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+inline kmillet::details::epoch::record& kmillet::details::epoch::local()
+{
+    // Hands the record back when the thread exits, so that the number of records is bounded by the number of threads alive at once.
+    struct owner
+    {
+        ~owner() { if (claimed) claimed->owned.store(false, std::memory_order_release); }
+        record* claimed = nullptr;
+    };
+    thread_local owner self;
+    if (self.claimed) return *self.claimed;
+    for (record* r = records.load(std::memory_order_acquire); r; r = r->next)
+    {
+        bool owned = false;
+        if (r->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) return *(self.claimed = r);
+    }
+    record* claimed = new record;
+    claimed->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(claimed->next, claimed, std::memory_order_release, std::memory_order_relaxed)) {}
+    return *(self.claimed = claimed);
+}
+
+inline std::uint64_t kmillet::details::epoch::try_advance() noexcept
+{
+    std::uint64_t current = global.load();
+    for (record* r = records.load(std::memory_order_acquire); r; r = r->next)
+    {
+        const std::uint64_t pinned = r->pinned.load();
+        if (pinned != 0 && pinned != current) return current;
+    }
+    // A failed exchange means that another writer advanced it, and loads the epoch it advanced to.
+    if (global.compare_exchange_strong(current, current + 1)) return current + 1;
+    return current;
+}
+
+inline kmillet::details::epoch::guard::guard()
+    : self(local())
+{
+    // Sequentially consistent, so that a writer that unpublishes an object after this store is ordered with it,
+    // and either sees this thread's epoch when it scans, or published its replacement before this thread loads it.
+    if (self.depth++ == 0) self.pinned.store(global.load());
+}
+inline kmillet::details::epoch::guard::~guard()
+{
+    if (--self.depth == 0) self.pinned.store(0, std::memory_order_release);
+}
+
+inline kmillet::details::epoch::retired_list::~retired_list()
+{
+    for (const entry& e : list) e.destroy(e.object);
+}
+inline void kmillet::details::epoch::retired_list::reserve()
+{
+    if (list.size() == list.capacity()) list.reserve(std::max<std::size_t>(8, 2 * list.capacity()));
+}
+template <class T>
+inline void kmillet::details::epoch::retired_list::retire(const T* object) noexcept
+{
+    // The epoch is read after the object was unpublished: readers that pinned a later epoch cannot have loaded it.
+    list.push_back({object, &Destroy<T>, global.load()});
+}
+inline void kmillet::details::epoch::retired_list::reclaim() noexcept
+{
+    // An object retired in epoch `e` may still be read by threads that pinned `e` or `e - 1`, and by no one once the epoch reaches `e + 2`.
+    // Advancing twice frees it right away when no reader is inside a critical section.
+    try_advance();
+    const std::uint64_t current = try_advance();
+    auto kept = std::remove_if(list.begin(), list.end(), [current](const entry& e) {
+        if (e.epoch + 2 > current) return false;
+        e.destroy(e.object);
+        return true;
+    });
+    list.erase(kept, list.end());
+}
@@ -0,0 +1,324 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file lazy_sized_any.hpp
+ * @author Kenan Millet
+ * @brief A `kmillet::sized_any<N>` that computes its value on first access.
+ *
+ * This header provides the `kmillet::lazy_sized_any<N>` class template.
+ * - A factory callable is stored in the buffer instead of the value it produces.
+ * - The first `kmillet::any_cast` (or call to `value()`) invokes the factory and replaces it, in the same buffer, with the produced value.
+ * - The type of the eventual value is known when the factory is stored, so `type()` never invokes the factory.
+ * - Values that are never accessed are never computed, and never allocate if their factory fits in the buffer.
+ *
+ * Materialization is not synchronized: concurrent first accesses to the same object must be serialized by the caller.
+ *
+ * @section Usage
+ * @code
+ * kmillet::lazy_sized_any<32> a([] { return expensive_computation(); }); // nothing is computed yet
+ * a.type();                               // typeid of the result of expensive_computation(), still not computed
+ * auto& result = kmillet::any_cast<const Result&>(a); // computes, stores and returns the result
+ * kmillet::lazy_sized_any<64> b(std::in_place_type<std::string>, [] { return "declared up front"; }); // stores a std::string once computed
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <any>         // for in_place_type_t
+#include <concepts>    // for invocable, copy_constructible, constructible_from
+#include <functional>  // for invoke
+#include <type_traits> // for decay_t, invoke_result_t
+#include <typeinfo>
+#include <utility>     // for exchange, forward, move
+#include <cstddef>     // for size_t
+
+// Forward declaration of kmillet::lazy_sized_any
+namespace kmillet
+{
+    template <std::size_t N, class Dispatch = default_dispatch> class lazy_sized_any;
+}
+
+// Private utilities for kmillet::lazy_sized_any
+namespace kmillet::details::lazy_sized_any
+{
+    // Used to exclude the factory constructor of `kmillet::lazy_sized_any<N>`
+    // from overload resolution when the argument is a specialization of `kmillet::lazy_sized_any`.
+    template<class T> struct is_lazy_sized_any : std::false_type {};
+    template<std::size_t N, class Dispatch> struct is_lazy_sized_any<::kmillet::lazy_sized_any<N, Dispatch>> : std::true_type {};
+}
+
+namespace kmillet
+{
+    /**
+     * @brief A `kmillet::sized_any<N, Dispatch>` whose value is produced by a factory on first access.
+     * @tparam N The size of the buffer shared by the factory and the value it produces.
+     * @tparam Dispatch The dispatch policy of the underlying `kmillet::sized_any`.
+     */
+    template<std::size_t N, class Dispatch>
+    class lazy_sized_any
+    {
+    public:
+        /**
+         * @brief Constructs an empty object.
+         */
+        constexpr lazy_sized_any() noexcept = default;
+        /**
+         * @brief Copies the factory or value of `other` into a new instance.
+         * @param other The `kmillet::lazy_sized_any<N>` to copy.
+         * @details Does not materialize the value of `other`.
+         */
+        lazy_sized_any(const lazy_sized_any& other) = default;
+        /**
+         * @brief Moves the factory or value of `other` into a new instance.
+         * @param other The `kmillet::lazy_sized_any<N>` to move.
+         * @details Leaves `other` empty. Does not materialize the value of `other`.
+         */
+        lazy_sized_any(lazy_sized_any&& other) noexcept;
+        /**
+         * @brief Constructs an object whose value will be `std::invoke(factory)`, of type `std::decay_t<std::invoke_result_t<F&>>`.
+         * @tparam F The type of the factory.
+         * @param factory The factory to be stored.
+         * @details Requires that `std::decay_t<F>` is copy-constructible and invocable with no arguments, and that its result is a copy-constructible object type.
+         */
+        template<class F>
+        requires(!details::lazy_sized_any::is_lazy_sized_any<std::decay_t<F>>::value && !details::sized_any::is_in_place_type<std::decay_t<F>>::value
+              && std::copy_constructible<std::decay_t<F>> && std::invocable<std::decay_t<F>&> && std::copy_constructible<std::decay_t<std::invoke_result_t<std::decay_t<F>&>>>)
+        explicit lazy_sized_any(F&& factory);
+        /**
+         * @brief Constructs an object whose value will be of type `std::decay_t<ValueType>`, direct-initialized from `std::invoke(factory)`.
+         * @tparam ValueType The declared type of the value.
+         * @tparam F The type of the factory.
+         * @param factory The factory to be stored.
+         * @details Requires that `std::decay_t<F>` is copy-constructible and invocable with no arguments,
+         * and that `std::decay_t<ValueType>` is copy-constructible and constructible from the factory's result.
+         */
+        template<class ValueType, class F>
+        requires(std::copy_constructible<std::decay_t<F>> && std::invocable<std::decay_t<F>&>
+              && std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, std::invoke_result_t<std::decay_t<F>&>>)
+        lazy_sized_any(std::in_place_type_t<ValueType>, F&& factory);
+
+        /**
+         * @brief Assigns by copying the factory or value of `rhs`.
+         * @param rhs The `kmillet::lazy_sized_any<N>` to copy.
+         * @return A reference to `*this`.
+         */
+        lazy_sized_any& operator=(const lazy_sized_any& rhs) = default;
+        /**
+         * @brief Assigns by moving the factory or value of `rhs`.
+         * @param rhs The `kmillet::lazy_sized_any<N>` to move.
+         * @return A reference to `*this`.
+         * @details Leaves `rhs` empty.
+         */
+        lazy_sized_any& operator=(lazy_sized_any&& rhs) noexcept;
+
+        /**
+         * @brief Materializes the value, if it has not been already, and returns the `kmillet::sized_any<N>` holding it.
+         * @return A reference to the `kmillet::sized_any<N>` holding the value.
+         * @details If the factory throws, the factory is kept and the exception is propagated.
+         */
+        sized_any<N, Dispatch>& value();
+        /**
+         * @copydoc value()
+         */
+        const sized_any<N, Dispatch>& value() const;
+
+        /**
+         * @brief Destroys the factory or value, if any.
+         */
+        void reset() noexcept;
+        /**
+         * @brief Gets the in-place storage capacity of the `kmillet::lazy_sized_any<N>` instance.
+         * @return The size of the buffer (in bytes) shared by the factory and the value, which is `N`.
+         */
+        [[nodiscard]] static constexpr std::size_t capacity() noexcept { return N; }
+        /**
+         * @brief Checks whether the object holds a factory or a value.
+         * @returns `true` if and only if the instance is non-empty, otherwise returns `false`.
+         */
+        [[nodiscard]] bool has_value() const noexcept { return storage.has_value(); }
+        /**
+         * @brief Checks whether the value has been produced.
+         * @returns `true` if and only if the instance holds a value rather than a factory.
+         */
+        [[nodiscard]] bool materialized() const noexcept { return materialize == nullptr; }
+        /**
+         * @brief Queries the type of the value, without materializing it.
+         * @returns The `type_info` of the (eventual) value if instance is non-empty, otherwise `typeid(void)`.
+         * Once the value is materialized, this is the type of whatever `value()` currently holds, which may have been changed through it.
+         */
+        [[nodiscard]] const std::type_info& type() const noexcept { return materialized() ? storage.type() : *eventualType; }
+
+    private:
+        template<class ValueType, class F>
+        static void Materialize(sized_any<N, Dispatch>& storage);
+
+    // Member variables
+        mutable sized_any<N, Dispatch> storage;
+        mutable void (*materialize)(sized_any<N, Dispatch>& storage) = nullptr;
+        const std::type_info* eventualType = &typeid(void);
+    };
+
+    /**
+     * @brief Performs type-safe access to the value, materializing it first if needed.
+     * @tparam T The type to which the value should be cast.
+     * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The `kmillet::lazy_sized_any<N>` to access.
+     * @exception `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the value of `operand`.
+     * @return Equivalent to `kmillet::any_cast<T>(operand.value())`.
+     * @details The value is not materialized if the requested `T` does not match the type of the value.
+     */
+    template<class T, std::size_t N, class Dispatch>
+    T any_cast(const lazy_sized_any<N, Dispatch>& operand);
+    /**
+     * @copydoc any_cast(const lazy_sized_any<N, Dispatch>&)
+     */
+    template<class T, std::size_t N, class Dispatch>
+    T any_cast(lazy_sized_any<N, Dispatch>& operand);
+    /**
+     * @brief Performs type-safe access to the value, materializing it first if needed.
+     * @tparam T The type to which the value should be cast.
+     * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The `kmillet::lazy_sized_any<N>` to access.
+     * @exception `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the value of `operand`.
+     * @return Equivalent to `kmillet::any_cast<T>(std::move(operand.value()))`.
+     * @details The value is not materialized if the requested `T` does not match the type of the value.
+     */
+    template<class T, std::size_t N, class Dispatch>
+    T any_cast(lazy_sized_any<N, Dispatch>&& operand);
+    /**
+     * @brief Performs type-safe access to the value, materializing it first if needed.
+     * @tparam T The type to which the value should be cast.
+     * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The pointer to the `kmillet::lazy_sized_any<N>` to access.
+     * @return A pointer to the value of `operand` if `operand` is not a null pointer and the `typeid` of the
+     * requested `T` matches that of the value of `operand`; otherwise returns a null pointer.
+     * @details The value is not materialized if the requested `T` does not match the type of the value.
+     */
+    template<class T, std::size_t N, class Dispatch>
+    const T* any_cast(const lazy_sized_any<N, Dispatch>* operand);
+    /**
+     * @copydoc any_cast(const lazy_sized_any<N, Dispatch>*)
+     */
+    template<class T, std::size_t N, class Dispatch>
+    T* any_cast(lazy_sized_any<N, Dispatch>* operand);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class Dispatch>
+inline kmillet::lazy_sized_any<N, Dispatch>::lazy_sized_any(kmillet::lazy_sized_any<N, Dispatch>&& other) noexcept
+    : storage(std::move(other.storage))
+    , materialize(std::exchange(other.materialize, nullptr))
+    , eventualType(std::exchange(other.eventualType, &typeid(void)))
+{}
+template <std::size_t N, class Dispatch>
+template <class F>
+requires(!kmillet::details::lazy_sized_any::is_lazy_sized_any<std::decay_t<F>>::value && !kmillet::details::sized_any::is_in_place_type<std::decay_t<F>>::value
+      && std::copy_constructible<std::decay_t<F>> && std::invocable<std::decay_t<F>&> && std::copy_constructible<std::decay_t<std::invoke_result_t<std::decay_t<F>&>>>)
+inline kmillet::lazy_sized_any<N, Dispatch>::lazy_sized_any(F&& factory)
+    : lazy_sized_any(std::in_place_type<std::decay_t<std::invoke_result_t<std::decay_t<F>&>>>, std::forward<F>(factory))
+{}
+template <std::size_t N, class Dispatch>
+template <class ValueType, class F>
+requires(std::copy_constructible<std::decay_t<F>> && std::invocable<std::decay_t<F>&>
+      && std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, std::invoke_result_t<std::decay_t<F>&>>)
+inline kmillet::lazy_sized_any<N, Dispatch>::lazy_sized_any(std::in_place_type_t<ValueType>, F&& factory)
+    : storage(std::in_place_type<std::decay_t<F>>, std::forward<F>(factory))
+    , materialize(&Materialize<std::decay_t<ValueType>, std::decay_t<F>>)
+    , eventualType(&typeid(std::decay_t<ValueType>))
+{}
+
+template <std::size_t N, class Dispatch>
+inline kmillet::lazy_sized_any<N, Dispatch>& kmillet::lazy_sized_any<N, Dispatch>::operator=(kmillet::lazy_sized_any<N, Dispatch>&& rhs) noexcept
+{
+    if (&rhs == this) return *this;
+    storage = std::move(rhs.storage);
+    materialize = std::exchange(rhs.materialize, nullptr);
+    eventualType = std::exchange(rhs.eventualType, &typeid(void));
+    return *this;
+}
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any<N, Dispatch>& kmillet::lazy_sized_any<N, Dispatch>::value()
+{
+    if (materialize)
+    {
+        materialize(storage);
+        materialize = nullptr;
+    }
+    return storage;
+}
+template <std::size_t N, class Dispatch>
+inline const kmillet::sized_any<N, Dispatch>& kmillet::lazy_sized_any<N, Dispatch>::value() const
+{
+    if (materialize)
+    {
+        materialize(storage);
+        materialize = nullptr;
+    }
+    return storage;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::lazy_sized_any<N, Dispatch>::reset() noexcept
+{
+    storage.reset();
+    materialize = nullptr;
+    eventualType = &typeid(void);
+}
+
+template <std::size_t N, class Dispatch>
+template <class ValueType, class F>
+inline void kmillet::lazy_sized_any<N, Dispatch>::Materialize(kmillet::sized_any<N, Dispatch>& storage)
+{
+    // The value is fully built while the factory is still alive, since the factory's result may refer to the factory itself.
+    // Only then is the factory replaced, by a move that cannot throw, so a throwing factory or constructor leaves `storage` untouched.
+    kmillet::sized_any<N, Dispatch> produced(std::in_place_type<ValueType>, std::invoke(kmillet::details::sized_any::access::unchecked<F>(storage)));
+    storage = std::move(produced);
+}
+
+template <class T, std::size_t N, class Dispatch>
+inline T kmillet::any_cast(const kmillet::lazy_sized_any<N, Dispatch>& operand)
+{
+    if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(*casted);
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
+template <class T, std::size_t N, class Dispatch>
+inline T kmillet::any_cast(kmillet::lazy_sized_any<N, Dispatch>& operand)
+{
+    if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(*casted);
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
+template <class T, std::size_t N, class Dispatch>
+inline T kmillet::any_cast(kmillet::lazy_sized_any<N, Dispatch>&& operand)
+{
+    if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(std::move(*casted));
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
+template <class T, std::size_t N, class Dispatch>
+inline const T* kmillet::any_cast(const kmillet::lazy_sized_any<N, Dispatch>* operand)
+{
+    if (!operand) return nullptr;
+    if (!operand->materialized() && operand->type() != typeid(std::decay_t<T>)) return nullptr;
+    return any_cast<T>(&operand->value());
+}
+template <class T, std::size_t N, class Dispatch>
+inline T* kmillet::any_cast(kmillet::lazy_sized_any<N, Dispatch>* operand)
+{
+    if (!operand) return nullptr;
+    if (!operand->materialized() && operand->type() != typeid(std::decay_t<T>)) return nullptr;
+    return any_cast<T>(&operand->value());
+}
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file per_core_any.hpp
+ * @author Kenan Millet
+ * @brief A `kmillet::sized_any<N>` value sharded into one slot per CPU, for contention-free accumulation.
+ *
+ * This header provides the `kmillet::per_core_any<N>` class template, for metrics and accumulators that are updated far more often than they are read.
+ * - Each slot holds its own `kmillet::sized_any<N>` and is padded to its own cache line, so writers on different CPUs never share a cache line.
+ *   This only holds for contents stored in-place: the contents must satisfy `kmillet::sized_any_optimized<N>`, which is checked at compile time.
+ * - Updates go to the slot of the CPU that the calling thread runs on (as reported by `sched_getcpu` where available, otherwise
+ *   chosen by thread). `update` is lock-free: it applies the update to a copy of the contents and publishes it with a compare-and-swap loop,
+ *   which requires contents that `std::atomic_ref` handles without locks, such as integers and floating point numbers.
+ *   Other contents are updated with `update_locked`, under a per-slot spin lock that blocks the threads sharing the slot if its holder is preempted.
+ * - `combine` folds every slot with a user function when the value is read.
+ *
+ * @section Usage
+ * @code
+ * kmillet::per_core_any<16> requests;
+ * requests.emplace_all<std::uint64_t>(0);
+ * requests.update<std::uint64_t>([](std::uint64_t& count) { ++count; }); // on every request, from any thread, without locking
+ * std::uint64_t total = requests.combine<std::uint64_t>(std::uint64_t{0}, std::plus<>{});
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <atomic>        // for atomic_flag, atomic_ref
+#include <concepts>      // for invocable, constructible_from
+#include <functional>    // for hash, invoke
+#include <memory>        // for unique_ptr, make_unique
+#include <mutex>         // for lock_guard
+#include <thread>        // for thread::hardware_concurrency, this_thread
+#include <type_traits>   // for is_trivially_copyable_v
+#include <utility>       // for forward, move, as_const
+#include <cstddef>       // for size_t
+
+#if defined(__linux__)
+#include <sched.h>       // for sched_getcpu
+#endif
+
+// Private utilities for kmillet::per_core_any
+namespace kmillet::details::per_core_any
+{
+    // Returns the CPU that the calling thread currently runs on, or a stable per-thread number if that is unknown.
+    inline std::size_t current_cpu() noexcept
+    {
+#if defined(__linux__)
+        if (const int cpu = sched_getcpu(); cpu >= 0) return static_cast<std::size_t>(cpu);
+#endif
+        thread_local const std::size_t id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        return id;
+    }
+
+    // Contents that are updated in place with a compare-and-swap loop. They lie at the start of the buffer of `Any`, right after its
+    // type information pointer, so they are aligned to `alignof(Any)`.
+    template<class T, class Any>
+    concept atomic_contents = std::is_trivially_copyable_v<T> && std::atomic_ref<T>::is_always_lock_free
+                           && std::atomic_ref<T>::required_alignment <= alignof(Any);
+
+    class spin_lock
+    {
+    public:
+        void lock() noexcept
+        {
+            while (flag.test_and_set(std::memory_order_acquire))
+            {
+                while (flag.test(std::memory_order_relaxed)) std::this_thread::yield();
+            }
+        }
+        void unlock() noexcept { flag.clear(std::memory_order_release); }
+
+    private:
+        std::atomic_flag flag;
+    };
+}
+
+namespace kmillet
+{
+    /**
+     * @brief A `kmillet::sized_any<N, Dispatch>` value sharded into cache-line-padded slots, one per CPU.
+     * @tparam N The size of the buffer of each slot.
+     * @tparam Dispatch The dispatch policy of each slot.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch>
+    class per_core_any
+    {
+    public:
+        /**
+         * @brief The type of each slot.
+         */
+        using value_type = sized_any<N, Dispatch>;
+
+        /**
+         * @brief Constructs empty slots.
+         * @param slots The number of slots. Defaults to the number of hardware threads.
+         */
+        explicit per_core_any(std::size_t slots = std::thread::hardware_concurrency());
+        per_core_any(const per_core_any&) = delete;
+        per_core_any& operator=(const per_core_any&) = delete;
+
+        /**
+         * @brief Replaces the contents of every slot by a `T` constructed from `args...`, typically the identity of the combining function.
+         * @tparam T The type of the contents.
+         * @tparam Args The types of the arguments of the constructor of `T`.
+         * @param args The arguments, which are not forwarded since they are used once per slot.
+         * @details `T` must satisfy `kmillet::sized_any_optimized<N>`. Must not run concurrently with `update`.
+         */
+        template<class T, class... Args>
+        requires(std::constructible_from<T, const Args&...>)
+        void emplace_all(const Args&... args);
+
+        /**
+         * @brief Updates the contents of the slot of the calling CPU without locking it, if it holds a `T`.
+         * @tparam T The expected type of the contents, which `std::atomic_ref` must handle without locks.
+         * @tparam F The type of the callable.
+         * @param f The callable, invoked with a `T&` to a copy of the contents, which then replaces the contents if they did not change meanwhile.
+         * @return `true` if the contents were updated, or `false` if the slot does not hold a `T`.
+         * @details `f` is invoked again on a fresh copy whenever another thread updated the slot first, so it must only modify its argument.
+         * Slots are not given a value here: fill them with `emplace_all` first, which, like `reset`, must not run concurrently with this function.
+         * `T` must satisfy `kmillet::sized_any_optimized<N>`.
+         */
+        template<class T, class F>
+        requires(details::per_core_any::atomic_contents<T, sized_any<N, Dispatch>> && std::invocable<F&, T&>)
+        bool update(F f);
+        /**
+         * @brief Invokes `f` with a reference to the contents of the slot of the calling CPU while the slot is locked, if it holds a `T`.
+         * @tparam T The expected type of the contents, for which `update` is not available.
+         * @tparam F The type of the callable.
+         * @param f The callable, invoked with a `T&` while the slot is locked.
+         * @return `true` if `f` was invoked, or `false` if the slot does not hold a `T`.
+         * @details An empty slot is first given a value-initialized `T`. `f` must not access `*this`. `T` must satisfy `kmillet::sized_any_optimized<N>`.
+         * A thread that is preempted while holding the lock blocks the other threads that update the same slot.
+         */
+        template<class T, class F>
+        requires(!details::per_core_any::atomic_contents<T, sized_any<N, Dispatch>> && std::invocable<F, T&>)
+        bool update_locked(F&& f);
+
+        /**
+         * @brief Folds the contents of every slot that holds a `T`.
+         * @tparam T The type of the contents to be folded.
+         * @tparam R The type of the result.
+         * @tparam F The type of the folding function.
+         * @param init The initial value of the fold.
+         * @param f The folding function, invoked as `init = f(std::move(init), value)` with a `const T&` to the contents of each slot, in turn,
+         * while that slot is locked.
+         * @return The result of the fold.
+         * @details The slots are read one at a time, so the result is not a snapshot under concurrent updates.
+         * Contents updated without locks with `update` are read atomically.
+         */
+        template<class T, class R, class F>
+        requires(std::invocable<F&, R, const T&>)
+        R combine(R init, F f) const;
+
+        /**
+         * @brief Empties every slot.
+         * @details Must not run concurrently with `update`.
+         */
+        void reset() noexcept;
+        /**
+         * @brief Gets the number of slots.
+         * @return The number of slots.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return count; }
+
+    private:
+        // Padded to its own cache line so that updates on one CPU do not invalidate the slots of the others.
+        struct alignas(64) slot
+        {
+            mutable details::per_core_any::spin_lock lock;
+            value_type value;
+        };
+
+    // Member variables
+        std::unique_ptr<slot[]> slots;
+        std::size_t count;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class Dispatch>
+inline kmillet::per_core_any<N, Dispatch>::per_core_any(std::size_t slots)
+    : slots(std::make_unique<slot[]>(slots ? slots : 1))
+    , count(slots ? slots : 1)
+{}
+
+template <std::size_t N, class Dispatch>
+template <class T, class... Args>
+requires(std::constructible_from<T, const Args&...>)
+inline void kmillet::per_core_any<N, Dispatch>::emplace_all(const Args&... args)
+{
+    static_assert(kmillet::sized_any_optimized<T, N>, "a heap-allocated content could share its cache line with the contents of other slots");
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::lock_guard lock(slots[i].lock);
+        slots[i].value.template emplace<T>(args...);
+    }
+}
+
+template <std::size_t N, class Dispatch>
+template <class T, class F>
+requires(kmillet::details::per_core_any::atomic_contents<T, kmillet::sized_any<N, Dispatch>> && std::invocable<F&, T&>)
+inline bool kmillet::per_core_any<N, Dispatch>::update(F f)
+{
+    static_assert(kmillet::sized_any_optimized<T, N>, "a heap-allocated content could share its cache line with the contents of other slots");
+    slot& s = slots[kmillet::details::per_core_any::current_cpu() % count];
+    T* value = kmillet::any_cast<T>(&s.value);
+    if (!value) return false;
+    // Relaxed, since the contents publish nothing but themselves.
+    std::atomic_ref<T> contents(*value);
+    T expected = contents.load(std::memory_order_relaxed);
+    T desired;
+    do
+    {
+        desired = expected;
+        std::invoke(f, desired);
+    }
+    while (!contents.compare_exchange_weak(expected, desired, std::memory_order_relaxed));
+    return true;
+}
+
+template <std::size_t N, class Dispatch>
+template <class T, class F>
+requires(!kmillet::details::per_core_any::atomic_contents<T, kmillet::sized_any<N, Dispatch>> && std::invocable<F, T&>)
+inline bool kmillet::per_core_any<N, Dispatch>::update_locked(F&& f)
+{
+    static_assert(kmillet::sized_any_optimized<T, N>, "a heap-allocated content could share its cache line with the contents of other slots");
+    slot& s = slots[kmillet::details::per_core_any::current_cpu() % count];
+    std::lock_guard lock(s.lock);
+    T* value = kmillet::any_cast<T>(&s.value);
+    if (!value)
+    {
+        if (s.value.has_value()) return false;
+        value = &s.value.template emplace<T>();
+    }
+    std::invoke(std::forward<F>(f), *value);
+    return true;
+}
+
+template <std::size_t N, class Dispatch>
+template <class T, class R, class F>
+requires(std::invocable<F&, R, const T&>)
+inline R kmillet::per_core_any<N, Dispatch>::combine(R init, F f) const
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::lock_guard lock(slots[i].lock);
+        // The slots are not part of the value of `*this`, so they are not const here.
+        T* value = kmillet::any_cast<T>(&slots[i].value);
+        if (!value) continue;
+        if constexpr (kmillet::details::per_core_any::atomic_contents<T, value_type>)
+        {
+            const T current = std::atomic_ref<T>(*value).load(std::memory_order_relaxed);
+            init = std::invoke(f, std::move(init), current);
+        }
+        else init = std::invoke(f, std::move(init), std::as_const(*value));
+    }
+    return init;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::per_core_any<N, Dispatch>::reset() noexcept
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::lock_guard lock(slots[i].lock);
+        slots[i].value.reset();
+    }
+}
@@ -11,6 +11,10 @@
  * - Strong exception safety and type-safe access via `kmillet::any_cast<T>`.
  * - Helper functions `kmillet::make_sized_any` and `kmillet::make_any` mirror the standard library's `std::make_any`.
  * - The alias `kmillet::any` provides a direct replacement for `std::any` with the same buffer size.
+ * - The optional `Dispatch` template parameter (`kmillet::virtual_dispatch` or `kmillet::table_dispatch`) selects how type-erased operations are dispatched.
+ *   `KMILLET_SIZED_ANY_NO_VIRTUAL()` only selects `kmillet::default_dispatch`, so both policies can be used within the same program.
+ * - If `KMILLET_SIZED_ANY_TRACE()` is enabled, constructions, copies, moves, swaps, casts and destructions are reported to a hook
+ *   installed with `kmillet::set_sized_any_trace_hook` (see `kmillet/sized_any/sized_any_trace.hpp`). Otherwise, tracing compiles to nothing.
  *
  * @section Usage
  * @code
@@ -28,6 +32,7 @@
  *
  * @section Deviations
  * - The `kmillet::sized_any<N>::emplace` method may reuse heap-allocated storage for performance, which is a deliberate deviation from the strict behavior of `std::any::emplace`.
+ * - The `kmillet::sized_any<N>::emplace_or_reuse` method, which `std::any` has no counterpart of, keeps the contained object alive when its type matches, so that the resources it owns are reused.
  * - Unlike `std::any`, which leaves the source object in a valid but unspecified state after a move construct/assignment, `kmillet::sized_any<N>` leaves the source in an empty state equivalent to a default-constructed `kmillet::sized_any<N>`.
  *
  * @section License
@@ -43,10 +48,16 @@
 
 #include <any>         // for any, in_place_type_t, in_place_type, bad_any_cast
 #include <array>
+#include <atomic>      // for atomic, memory_order
+#include <bit>         // for bit_ceil
 #include <concepts>    // for various concepts
+#include <functional>  // for invoke
+#include <new>         // for align_val_t, launder
 #include <type_traits> // for true_type, false_type, and various meta-functions
 #include <typeinfo>
 #include <cstddef>     // for size_t
+#include <cstdint>     // for uintptr_t
+#include <cstdint>     // for uint64_t, uintptr_t
 
 #ifndef KMILLET_IV_THROW_OR_ABORT
 
@@ -67,10 +78,65 @@
 #define KMILLET_SIZED_ANY_NO_VIRTUAL() 0
 #endif
 
-// Forward declaration of kmillet::sized_any
+#ifndef KMILLET_SIZED_ANY_TRACE
+#define KMILLET_SIZED_ANY_TRACE() 0
+#endif
+
+#if KMILLET_SIZED_ANY_TRACE()
+#define KMILLET_SIZED_ANY_TRACE_EVENT(event, self, other, type) ::kmillet::details::sized_any::trace(::kmillet::sized_any_trace_event::event, self, other, type)
+#else
+#define KMILLET_SIZED_ANY_TRACE_EVENT(event, self, other, type) ((void)0)
+#endif
+
+// Dispatch policies and forward declaration of kmillet::sized_any
 namespace kmillet
 {
-    template <std::size_t N> class sized_any;
+    /**
+     * @brief Dispatch policy under which `kmillet::sized_any` performs type-erased operations through virtual function calls.
+     */
+    struct virtual_dispatch {};
+    /**
+     * @brief Dispatch policy under which `kmillet::sized_any` performs type-erased operations through a table of function pointers.
+     * @details Consider this policy if the performance of `kmillet::virtual_dispatch` is below expectations.
+     */
+    struct table_dispatch {};
+    /**
+     * @brief The dispatch policy used by `kmillet::sized_any` when none is specified.
+     * @details `kmillet::table_dispatch` if `KMILLET_SIZED_ANY_NO_VIRTUAL()` is enabled, otherwise `kmillet::virtual_dispatch`.
+     */
+    using default_dispatch = std::conditional_t<KMILLET_SIZED_ANY_NO_VIRTUAL(), table_dispatch, virtual_dispatch>;
+
+    /**
+     * @brief The operations of `kmillet::sized_any` that are reported to the trace hook when `KMILLET_SIZED_ANY_TRACE()` is enabled.
+     */
+    enum class sized_any_trace_event : unsigned char
+    {
+        construct, ///< A value was constructed in `self`, by a constructor or by `emplace`.
+        copy,      ///< `self` was copy-constructed from `other`.
+        move,      ///< `self` was move-constructed from `other`, which is now empty.
+        swap,      ///< The contents of `self` and `other` were swapped.
+        cast,      ///< The contents of `self` were accessed through `kmillet::any_cast`.
+        destroy,   ///< The contents of `self` were destroyed.
+    };
+    /**
+     * @brief The type of the trace hook.
+     * @details `self` and `other` are the addresses of the `kmillet::sized_any` objects involved (`other` is `nullptr` if there is none),
+     * `size` and `alignment` are the size and the alignment of the type of the contents involved, and `nothrowMovable` tells whether it is
+     * nothrow move constructible, which together determine whether a `kmillet::sized_any<N>` allocates. Swaps report the empty type.
+     */
+    using sized_any_trace_hook = void (*)(sized_any_trace_event event, const void* self, const void* other,
+                                          std::size_t size, std::size_t alignment, bool nothrowMovable) noexcept;
+#if KMILLET_SIZED_ANY_TRACE()
+    /**
+     * @brief Installs the hook to which every traced operation of `kmillet::sized_any` is reported.
+     * @param hook The hook to install, or `nullptr` to stop tracing.
+     * @return The previously installed hook.
+     * @details Only available if `KMILLET_SIZED_ANY_TRACE()` is enabled, which must be the case for every translation unit of the program.
+     */
+    sized_any_trace_hook set_sized_any_trace_hook(sized_any_trace_hook hook) noexcept;
+#endif
+
+    template <std::size_t N, class Dispatch = default_dispatch> class sized_any;
 }
 
 // Private utilities for kmillet::sized_any
@@ -79,7 +145,7 @@ namespace kmillet::details::sized_any
     // Used to exclude `ValueType` versions of `kmillet::sized_any<N>` constructors and assignment operators
     // from overload resolution when the `ValueType` argument is a specialization of `kmillet::sized_any`.
     template<class T> struct is_sized_any : std::false_type {};
-    template<std::size_t N> struct is_sized_any<::kmillet::sized_any<N>> : std::true_type {};
+    template<std::size_t N, class Dispatch> struct is_sized_any<::kmillet::sized_any<N, Dispatch>> : std::true_type {};
 
     // Used to exclude `ValueType` versions of `kmillet::sized_any<N>` constructors
     // from overload resolution when the `ValueType` argument is a specialization of `std::in_place_type_t`.
@@ -87,11 +153,30 @@ namespace kmillet::details::sized_any
     template<class T> struct is_in_place_type<std::in_place_type_t<T>> : std::true_type {};
 
     // Interface that `kmillet::sized_any` specializations use to store type information
-    // and check if dynamic allocation is needed.
-    struct ITypeInfo;
-    // Implementation of `ITypeInfo` for a given type `T`.
+    // and check if dynamic allocation is needed. Specialized for each dispatch policy.
+    template<class Dispatch> struct ITypeInfo;
+    // Operations on a given type `T` that are shared by every dispatch policy.
     template<class T> struct TypeInfo;
-    template<class T> inline constexpr TypeInfo<T> info{};
+    // Implementation of `ITypeInfo<Dispatch>` for a given type `T`.
+    template<class T, class Dispatch> struct DispatchTypeInfo;
+    template<class T, class Dispatch = ::kmillet::default_dispatch> inline constexpr DispatchTypeInfo<T, Dispatch> info{};
+    // Converts type information of one dispatch policy into the equivalent type information of another.
+    template<class To, class From> const ITypeInfo<To>* rebind(const ITypeInfo<From>* from) noexcept;
+    // Heap-allocated contents are allocated with `new`, unless `kmillet::compact_heap_payloads` moved them side by side into an arena:
+    // those are preceded by a pointer to their arena, and the pointer to them is tagged so that they are destroyed accordingly.
+    struct arena;
+    // Reads and destroys the heap-allocated contents of type `T`, whether or not they lie in an arena.
+    template<class T> struct heap;
+    // Grants the other components of this library unchecked access to the contents of `kmillet::sized_any`.
+    struct access;
+    // Finds the position of a type among `Ts` from its type information, in constant time.
+    template<class Dispatch, class... Ts> struct info_index;
+#if KMILLET_SIZED_ANY_TRACE()
+    inline std::atomic<::kmillet::sized_any_trace_hook> tracer{nullptr};
+    // Reports an operation on contents of the type described by `type` to the installed trace hook, if any.
+    template<class Dispatch>
+    void trace(::kmillet::sized_any_trace_event event, const void* self, const void* other, const ITypeInfo<Dispatch>* type) noexcept;
+#endif
 }
 
 namespace kmillet
@@ -105,7 +190,7 @@ namespace kmillet
      * @tparam N The size of the buffer.
      */
     template<class T, std::size_t N>
-    concept sized_any_optimized = !details::sized_any::info<std::decay_t<T>>.NeedsAlloc(N);
+    concept sized_any_optimized = !details::sized_any::TypeInfo<std::decay_t<T>>::NeedsAlloc(N);
 
     /**
      * @brief A type-erased container similar to `std::any`, but with a template-sized buffer for in-place allocation.
@@ -118,14 +203,19 @@ namespace kmillet
      * - `kmillet::any` alias is provided as a direct replacement of `std::any` that is compatible with other specializations of `kmillet::sized_any`.
      * - `kmillet::make_any` functions are provided as a direct replacement of `std::make_any`.
      *
+     * - The `Dispatch` policy selects how type-erased operations are performed. Specializations with different policies may be
+     *   copied, moved, assigned and swapped between each other.
+     *
      * See documentation below for usage and design details.
      * @tparam N The size of the buffer used for in-place storage.
+     * @tparam Dispatch The dispatch policy, either `kmillet::virtual_dispatch` or `kmillet::table_dispatch`. Defaults to `kmillet::default_dispatch`.
      */
-    template<std::size_t N>
+    template<std::size_t N, class Dispatch>
     class sized_any
     {
         // The size of the buffer used must be at least the size of a pointer to ensure that it can hold a pointer to heap-allocated memory if needed.
         static_assert(N >= sizeof(void*));
+        static_assert(std::disjunction_v<std::is_same<Dispatch, virtual_dispatch>, std::is_same<Dispatch, table_dispatch>>);
     public:
         /**
          * @brief Constructs an empty object.
@@ -140,11 +230,12 @@ namespace kmillet
         /**
          * @brief Copies the content of `other` into a new instance.
          * @tparam M The size of the buffer used by `other`.
-         * @param other The `kmillet::sized_any<M>` to copy.
+         * @tparam OtherDispatch The dispatch policy used by `other`.
+         * @param other The `kmillet::sized_any<M, OtherDispatch>` to copy.
          * @details No dynamic allocation will occur if the content of `other` satisfies `kmillet::sized_any_optimized<N>`.
          */
-        template<std::size_t M>
-        sized_any(const sized_any<M>& other);
+        template<std::size_t M, class OtherDispatch>
+        sized_any(const sized_any<M, OtherDispatch>& other);
         /**
          * @brief Moves the content of `other` into a new instance.
          * @param other The `kmillet::sized_any<N>` to move.
@@ -158,14 +249,15 @@ namespace kmillet
         /**
          * @brief Moves the content of `other` into a new instance.
          * @tparam M The size of the buffer used by `other`.
-         * @param other The `kmillet::sized_any<M>` to move.
+         * @tparam OtherDispatch The dispatch policy used by `other`.
+         * @param other The `kmillet::sized_any<M, OtherDispatch>` to move.
          * @details Unlike `std::any`, which leaves `other` in a valid but unspecified state after the move,
-         * this implementation leaves `other` in a state that is equivalent to an empty `kmillet::sized_any<M>`.
+         * this implementation leaves `other` in a state that is equivalent to an empty `kmillet::sized_any<M, OtherDispatch>`.
          * Dynamic allocation will occur if and only if the content of `other` does not satisfy `kmillet::sized_any_optimized<N>`, but it does satisfy `kmillet::sized_any_optimized<M>`.
-         * This means that if `M < N`, then no dynamic allocation will occur.
+         * This means that if `M <= N`, then no dynamic allocation will occur.
          */
-        template<std::size_t M>
-        sized_any(sized_any<M>&& other) noexcept(M < N);
+        template<std::size_t M, class OtherDispatch>
+        sized_any(sized_any<M, OtherDispatch>&& other) noexcept(M <= N);
         /**
          * @brief Constructs an object with initial content of type `std::decay_t<ValueType>`, direct-initialized from `std::forward<ValueType>(value)`.
          * @tparam ValueType The type of the value to be stored.
@@ -215,11 +307,12 @@ namespace kmillet
         /**
          * @brief Assigns by copying the state of `rhs`, as if by `kmillet::sized_any<N>(rhs).swap(*this)`.
          * @tparam M The size of the buffer used by `rhs`.
-         * @param rhs The `kmillet::sized_any<M>` to copy.
+         * @tparam OtherDispatch The dispatch policy used by `rhs`.
+         * @param rhs The `kmillet::sized_any<M, OtherDispatch>` to copy.
          * @return A reference to `*this`.
          */
-        template<std::size_t M>
-        sized_any& operator=(const sized_any<M>& rhs);
+        template<std::size_t M, class OtherDispatch>
+        sized_any& operator=(const sized_any<M, OtherDispatch>& rhs);
         /**
          * @brief Assigns by moving the state of `rhs`, as if by `kmillet::sized_any<N>(std::move(rhs)).swap(*this)`.
          * @param rhs The `kmillet::sized_any<N>` to move.
@@ -231,15 +324,16 @@ namespace kmillet
         /**
          * @brief Assigns by moving the state of `rhs`, as if by `kmillet::sized_any<N>(std::move(rhs)).swap(*this)`.
          * @tparam M The size of the buffer used by `rhs`.
-         * @param rhs The `kmillet::sized_any<M>` to move.
+         * @tparam OtherDispatch The dispatch policy used by `rhs`.
+         * @param rhs The `kmillet::sized_any<M, OtherDispatch>` to move.
          * @return A reference to `*this`.
          * @details Unlike `std::any`, which leaves `other` in a valid but unspecified state after the assignment,
          * this implementation leaves `other` in a state that is equivalent to an empty `kmillet::sized_any<N>`.
          * Dynamic allocation will occur if and only if the content of `other` does not satisfy `kmillet::sized_any_optimized<N>`, but it does satisfy `kmillet::sized_any_optimized<M>`.
-         * This means that if `M < N`, then no dynamic allocation will occur.
+         * This means that if `M <= N`, then no dynamic allocation will occur.
          */
-        template<std::size_t M>
-        sized_any& operator=(sized_any<M>&& rhs) noexcept(M < N);
+        template<std::size_t M, class OtherDispatch>
+        sized_any& operator=(sized_any<M, OtherDispatch>&& rhs) noexcept(M <= N);
         /**
          * @brief Assigns the type and value of `rhs`, as if by `kmillet::sized_any<N>(std::forward<ValueType>(rhs)).swap(*this)`.
          * @tparam ValueType The type of the value to be assigned.
@@ -285,6 +379,21 @@ namespace kmillet
         template<class ValueType, class U, class... Args>
         requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, std::initializer_list<U>&, Args...>)
         std::decay_t<ValueType>& emplace(std::initializer_list<U> il, Args&&... args) noexcept(noexcept(sized_any{std::in_place_type<ValueType>, il, std::forward<Args>(args)...}));
+        /**
+         * @brief Reuses the contained object if it is of type `std::decay_t<ValueType>`, otherwise changes it to one constructed from the arguments.
+         * @tparam ValueType The type of the value to be stored.
+         * @tparam F The type of the callable.
+         * @tparam Args The types of the arguments to be forwarded to the constructor of `std::decay_t<ValueType>`.
+         * @param reuse The callable, invoked with a `std::decay_t<ValueType>&` to the contained object if it is already of that type, to clear or reassign it.
+         * @param args The arguments to be forwarded to the constructor of `std::decay_t<ValueType>` otherwise.
+         * @return A reference to the contained object of type `std::decay_t<ValueType>`.
+         * @details Unlike `emplace`, which always destroys the contained object, this keeps it alive when the types match, so that the resources
+         * that it owns, such as the capacity of a container, are reused. Otherwise, behaves like `emplace<ValueType>(std::forward<Args>(args)...)`,
+         * and `reuse` is not invoked.
+         */
+        template<class ValueType, class F, class... Args>
+        requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...> && std::invocable<F, std::decay_t<ValueType>&>)
+        std::decay_t<ValueType>& emplace_or_reuse(F&& reuse, Args&&... args);
 
         /**
          * @brief If `*this` contains a value, destroys the contained value.
@@ -297,12 +406,13 @@ namespace kmillet
          */
         void swap(sized_any& other) noexcept;
         /**
-         * @brief Swaps the content of a `kmillet::sized_any<N>` object with a `kmillet::sized_any<M>` object.
+         * @brief Swaps the content of a `kmillet::sized_any<N>` object with a `kmillet::sized_any<M, OtherDispatch>` object.
          * @tparam M The size of the buffer used by `other`.
-         * @param other The `kmillet::sized_any<M>` to swap with.
+         * @tparam OtherDispatch The dispatch policy used by `other`.
+         * @param other The `kmillet::sized_any<M, OtherDispatch>` to swap with.
          */
-        template<std::size_t M>
-        void swap(sized_any<M>& other);
+        template<std::size_t M, class OtherDispatch>
+        void swap(sized_any<M, OtherDispatch>& other);
 
         /**
          * @brief Gets the in-place storage capacity of the `kmillet::sized_any<N>` instance.
@@ -322,14 +432,15 @@ namespace kmillet
 
     private:
     // Friend Declarations
-        template<std::size_t M> friend class sized_any;
-        template<class T, std::size_t M>
-        friend const T* any_cast(const sized_any<M>* operand) noexcept;
-        template<class T, std::size_t M>
-        friend T* any_cast(sized_any<M>* operand) noexcept;
+        template<std::size_t M, class OtherDispatch> friend class sized_any;
+        template<class T, std::size_t M, class OtherDispatch>
+        friend const T* any_cast(const sized_any<M, OtherDispatch>* operand) noexcept;
+        template<class T, std::size_t M, class OtherDispatch>
+        friend T* any_cast(sized_any<M, OtherDispatch>* operand) noexcept;
+        friend struct details::sized_any::access;
 
     // Member variables
-        const details::sized_any::ITypeInfo* info;
+        const details::sized_any::ITypeInfo<Dispatch>* info;
         std::array<char, N> buff;
     };
 
@@ -337,6 +448,7 @@ namespace kmillet
      * @brief Performs type-safe access to the contained object.
      * @tparam T The type to which the contained object should be cast.
      * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
      * @param operand The `kmillet::sized_any<N>` to access.
      * @exception `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the contents of `operand`.
      * @return A reference to the object contained in `operand`, casted to type `T`.
@@ -344,12 +456,13 @@ namespace kmillet
      * Throws `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the contents of `operand`.
      * Otherwise, returns `static_cast<T>(*any_cast<std::remove_cvref_t<T>>(&operand))`.
      */
-    template<class T, std::size_t N>
-    T any_cast(const sized_any<N>& operand);
+    template<class T, std::size_t N, class Dispatch>
+    T any_cast(const sized_any<N, Dispatch>& operand);
     /**
      * @brief Performs type-safe access to the contained object.
      * @tparam T The type to which the contained object should be cast.
      * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
      * @param operand The `kmillet::sized_any<N>` to access.
      * @exception `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the contents of `operand`.
      * @return A reference to the object contained in `operand`, casted to type `T`.
@@ -357,12 +470,13 @@ namespace kmillet
      * Throws `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the contents of `operand`.
      * Otherwise, returns `static_cast<T>(*any_cast<std::remove_cvref_t<T>>(&operand))`.
      */
-    template<class T, std::size_t N>
-    T any_cast(sized_any<N>& operand);
+    template<class T, std::size_t N, class Dispatch>
+    T any_cast(sized_any<N, Dispatch>& operand);
     /**
      * @brief Performs type-safe access to the contained object.
      * @tparam T The type to which the contained object should be cast.
      * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
      * @param operand The `kmillet::sized_any<N>` to access.
      * @exception `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the contents of `operand`.
      * @return A reference to the object contained in `operand`, move-casted to type `T`.
@@ -370,12 +484,13 @@ namespace kmillet
      * Throws `std::bad_any_cast` if the `typeid` of the requested `T` does not match that of the contents of `operand`.
      * Otherwise, returns `static_cast<T>(std::move(*any_cast<std::remove_cvref_t<T>>(&operand)))`.
      */
-    template<class T, std::size_t N>
-    T any_cast(sized_any<N>&& operand);
+    template<class T, std::size_t N, class Dispatch>
+    T any_cast(sized_any<N, Dispatch>&& operand);
     /**
      * @brief Performs type-safe access to the contained object.
      * @tparam T The type to which the contained object should be cast.
      * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
      * @param operand The pointer to the `kmillet::sized_any<N>` to access.
      * @return A pointer to the object contained in `operand`, casted to type `const T*` if `operand` is not a null pointer and the `typeid` of the
      * requested `T` matches that of the contents of `operand`; otherwise returns a null pointer.
@@ -383,12 +498,13 @@ namespace kmillet
      * If `operand` is not a null pointer and the `typeid` of the requested `T` matches that of the contents of `operand`,
      * returns a pointer to the value contained by `operand`; otherwise returns a null pointer.
      */
-    template<class T, std::size_t N>
-    const T* any_cast(const sized_any<N>* operand) noexcept;
+    template<class T, std::size_t N, class Dispatch>
+    const T* any_cast(const sized_any<N, Dispatch>* operand) noexcept;
     /**
      * @brief Performs type-safe access to the contained object.
      * @tparam T The type to which the contained object should be cast.
      * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
      * @param operand The pointer to the `kmillet::sized_any<N>` to access.
      * @return A pointer to the object contained in `operand`, casted to type `T*` if `operand` is not a null pointer and the `typeid` of the
      * requested `T` matches that of the contents of `operand`; otherwise returns a null pointer.
@@ -396,8 +512,8 @@ namespace kmillet
      * If `operand` is not a null pointer and the `typeid` of the requested `T` matches that of the contents of `operand`,
      * returns a pointer to the value contained by `operand`; otherwise returns a null pointer.
      */
-    template<class T, std::size_t N>
-    T* any_cast(sized_any<N>* operand) noexcept;
+    template<class T, std::size_t N, class Dispatch>
+    T* any_cast(sized_any<N, Dispatch>* operand) noexcept;
 
     /**
      * @brief Constructs a `kmillet::sized_any<N>` object containing an object of type `T`, passing the provided arguments to `T`'s constructor.
@@ -492,59 +608,158 @@ namespace kmillet
 // Implementation details below this point.
 // ----------------------------------------------------------------------------
 
-#if KMILLET_SIZED_ANY_NO_VIRTUAL()
-struct kmillet::details::sized_any::ITypeInfo
+template<>
+struct kmillet::details::sized_any::ITypeInfo<kmillet::table_dispatch>
 {
     const std::type_info& (* const type) () noexcept;
     std::size_t (* const size) () noexcept;
+    std::size_t (* const alignment) () noexcept;
+    const void* (* const marker) () noexcept;
     bool (* const needsAlloc) (std::size_t cap) noexcept;
     void (* const copy) (const void* from, char* to, std::size_t fromCap, std::size_t toCap);
     void (* const move) (void* from, char* to, std::size_t fromCap, std::size_t toCap);
     void (* const destructReuseHeap) (void* buff) noexcept;
     void (* const cleanUp) (void* buff, std::size_t cap) noexcept;
+    bool (* const relocatable) () noexcept;
+    void* (* const relocate) (void* buff, std::byte* content, arena* owner);
+    const ITypeInfo<kmillet::virtual_dispatch>* (* const counterpart) () noexcept;
 };
-#else
-struct kmillet::details::sized_any::ITypeInfo
+template<>
+struct kmillet::details::sized_any::ITypeInfo<kmillet::virtual_dispatch>
 {
     virtual constexpr const std::type_info& type() const noexcept = 0;
     virtual constexpr std::size_t size() const noexcept = 0;
+    virtual constexpr std::size_t alignment() const noexcept = 0;
+    virtual constexpr const void* marker() const noexcept = 0;
     virtual constexpr bool needsAlloc(std::size_t cap) const noexcept = 0;
     virtual void copy(const void* from, char* to, std::size_t fromCap, std::size_t toCap) const = 0;
     virtual void move(void* from, char* to, std::size_t fromCap, std::size_t toCap) const = 0;
     virtual void destructReuseHeap(void* buff) const noexcept = 0;
     virtual void cleanUp(void* buff, std::size_t cap) const noexcept = 0;
+    virtual constexpr bool relocatable() const noexcept = 0;
+    virtual void* relocate(void* buff, std::byte* content, arena* owner) const = 0;
+    virtual const ITypeInfo<kmillet::table_dispatch>* counterpart() const noexcept = 0;
 };
-#endif
 
 template<class T>
-struct kmillet::details::sized_any::TypeInfo final : kmillet::details::sized_any::ITypeInfo
+struct kmillet::details::sized_any::TypeInfo
 {
     static constexpr const std::type_info& Type() noexcept;
     static constexpr std::size_t Size() noexcept;
+    static constexpr std::size_t Alignment() noexcept;
+    // Returns `T::sized_any_marker` if `T` declares one, which lets a header recognize every specialization of a class template
+    // by its type information alone, otherwise `nullptr`.
+    static constexpr const void* Marker() noexcept;
     static constexpr bool NeedsAlloc(std::size_t cap) noexcept;
     static void Copy(const void* from, char* to, std::size_t fromCap, std::size_t toCap);
     static void Move(void* from, char* to, std::size_t fromCap, std::size_t toCap);
     static void DestructReuseHeap(void* buff) noexcept;
     static void CleanUp(void* buff, std::size_t cap) noexcept;
-#if KMILLET_SIZED_ANY_NO_VIRTUAL()
-    constexpr TypeInfo() noexcept
-        : ITypeInfo{.type=&Type,
-                    .size=&Size,
-                    .needsAlloc=&NeedsAlloc,
-                    .copy=&Copy,
-                    .move=&Move,
-                    .destructReuseHeap=&DestructReuseHeap,
-                    .cleanUp=&CleanUp}
+    // Returns whether heap-allocated objects of type `T` can be moved into an arena by `Relocate`.
+    static constexpr bool Relocatable() noexcept;
+    // Moves the heap-allocated object pointed to by `buff` to `content`, in the arena `owner`, and returns the stored pointer to the moved-from object.
+    static void* Relocate(void* buff, std::byte* content, arena* owner);
+};
+
+template<class T>
+struct kmillet::details::sized_any::DispatchTypeInfo<T, kmillet::table_dispatch> final : kmillet::details::sized_any::ITypeInfo<kmillet::table_dispatch>
+{
+    static const ITypeInfo<kmillet::virtual_dispatch>* Counterpart() noexcept { return &info<T, kmillet::virtual_dispatch>; }
+    constexpr DispatchTypeInfo() noexcept
+        : ITypeInfo{.type=&TypeInfo<T>::Type,
+                    .size=&TypeInfo<T>::Size,
+                    .alignment=&TypeInfo<T>::Alignment,
+                    .marker=&TypeInfo<T>::Marker,
+                    .needsAlloc=&TypeInfo<T>::NeedsAlloc,
+                    .copy=&TypeInfo<T>::Copy,
+                    .move=&TypeInfo<T>::Move,
+                    .destructReuseHeap=&TypeInfo<T>::DestructReuseHeap,
+                    .cleanUp=&TypeInfo<T>::CleanUp,
+                    .relocatable=&TypeInfo<T>::Relocatable,
+                    .relocate=&TypeInfo<T>::Relocate,
+                    .counterpart=&Counterpart}
     {}
-#else
-    constexpr const std::type_info& type() const noexcept override { return Type(); }
-    constexpr std::size_t size() const noexcept override { return Size(); }
-    constexpr bool needsAlloc(std::size_t cap) const noexcept override { return NeedsAlloc(cap); }
-    void copy(const void* from, char* to, std::size_t fromCap, std::size_t toCap) const override { return Copy(from, to, fromCap, toCap); }
-    void move(void* from, char* to, std::size_t fromCap, std::size_t toCap) const override { return Move(from, to, fromCap, toCap); }
-    void destructReuseHeap(void* buff) const noexcept override { return DestructReuseHeap(buff); }
-    void cleanUp(void* buff, std::size_t cap) const noexcept override { return CleanUp(buff, cap); }
-#endif
+};
+template<class T>
+struct kmillet::details::sized_any::DispatchTypeInfo<T, kmillet::virtual_dispatch> final : kmillet::details::sized_any::ITypeInfo<kmillet::virtual_dispatch>
+{
+    constexpr const std::type_info& type() const noexcept override { return TypeInfo<T>::Type(); }
+    constexpr std::size_t size() const noexcept override { return TypeInfo<T>::Size(); }
+    constexpr std::size_t alignment() const noexcept override { return TypeInfo<T>::Alignment(); }
+    constexpr const void* marker() const noexcept override { return TypeInfo<T>::Marker(); }
+    constexpr bool needsAlloc(std::size_t cap) const noexcept override { return TypeInfo<T>::NeedsAlloc(cap); }
+    void copy(const void* from, char* to, std::size_t fromCap, std::size_t toCap) const override { return TypeInfo<T>::Copy(from, to, fromCap, toCap); }
+    void move(void* from, char* to, std::size_t fromCap, std::size_t toCap) const override { return TypeInfo<T>::Move(from, to, fromCap, toCap); }
+    void destructReuseHeap(void* buff) const noexcept override { return TypeInfo<T>::DestructReuseHeap(buff); }
+    void cleanUp(void* buff, std::size_t cap) const noexcept override { return TypeInfo<T>::CleanUp(buff, cap); }
+    constexpr bool relocatable() const noexcept override { return TypeInfo<T>::Relocatable(); }
+    void* relocate(void* buff, std::byte* content, arena* owner) const override { return TypeInfo<T>::Relocate(buff, content, owner); }
+    const ITypeInfo<kmillet::table_dispatch>* counterpart() const noexcept override { return &info<T, kmillet::table_dispatch>; }
+};
+
+template<class To, class From>
+inline const kmillet::details::sized_any::ITypeInfo<To>* kmillet::details::sized_any::rebind(const ITypeInfo<From>* from) noexcept
+{
+    if constexpr (std::is_same_v<To, From>) return from;
+    else return from->counterpart();
+}
+
+struct kmillet::details::sized_any::arena
+{
+    // Pointers to contents placed in an arena are tagged by setting their lowest bit, which the alignment of relocatable types leaves clear.
+    static bool tagged(const void* stored) noexcept { return reinterpret_cast<std::uintptr_t>(stored) & 1; }
+    static void* untagged(const void* stored) noexcept { return reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(stored) & ~std::uintptr_t{1}); }
+
+    // Drops a reference held by a content or by the pass filling the arena, and frees the arena with the last one.
+    static void release(arena* a) noexcept
+    {
+        if (a->references.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        const std::size_t bytes = a->bytes, alignment = a->alignment;
+        a->~arena();
+        ::operator delete(a, bytes, std::align_val_t(alignment));
+    }
+
+    std::atomic<std::size_t> references;
+    std::size_t bytes;
+    std::size_t alignment;
+};
+
+template<class T>
+struct kmillet::details::sized_any::heap
+{
+    // Contents can only be moved into an arena if their alignment leaves room for the tag,
+    // and if they have no allocation functions of their own, which the arena would bypass.
+    static constexpr bool relocatable = alignof(T) >= 2
+        && !requires { T::operator new(std::size_t{}); } && !requires { T::operator new(std::size_t{}, std::align_val_t{}); };
+
+    // Returns the content that a stored pointer points to.
+    static T* get(void* stored) noexcept
+    {
+        if constexpr (relocatable) return static_cast<T*>(arena::untagged(stored));
+        else return static_cast<T*>(stored);
+    }
+    static const T* get(const void* stored) noexcept { return get(const_cast<void*>(stored)); }
+    // Constructs a content at `content`, in the arena `owner`, with the pointer to the arena just before it, and returns the stored pointer to it.
+    template<class... Args>
+    static void* make_in(std::byte* content, arena* owner, Args&&... args)
+    {
+        ::new (static_cast<void*>(content)) T(std::forward<Args>(args)...);
+        ::new (static_cast<void*>(content - sizeof(arena*))) arena*(owner);
+        return content + 1;
+    }
+    // Destroys a content, then deletes it or returns its storage to its arena.
+    static void destroy(void* stored) noexcept
+    {
+        if (!relocatable || !arena::tagged(stored))
+        {
+            delete static_cast<T*>(stored);
+            return;
+        }
+        T* content = get(stored);
+        arena* owner = *std::launder(reinterpret_cast<arena**>(reinterpret_cast<std::byte*>(content) - sizeof(arena*)));
+        content->~T();
+        arena::release(owner);
+    }
 };
 
 template<>
@@ -558,6 +773,16 @@ inline constexpr std::size_t kmillet::details::sized_any::TypeInfo<void>::Size()
     return 0;
 }
 template<>
+inline constexpr std::size_t kmillet::details::sized_any::TypeInfo<void>::Alignment() noexcept
+{
+    return 1;
+}
+template<>
+inline constexpr const void* kmillet::details::sized_any::TypeInfo<void>::Marker() noexcept
+{
+    return nullptr;
+}
+template<>
 inline constexpr bool kmillet::details::sized_any::TypeInfo<void>::NeedsAlloc(std::size_t cap) noexcept
 {
     return false;
@@ -582,6 +807,17 @@ inline void kmillet::details::sized_any::TypeInfo<void>::CleanUp(void*, std::siz
 {
     // No operation needed for void type
 }
+template<>
+inline constexpr bool kmillet::details::sized_any::TypeInfo<void>::Relocatable() noexcept
+{
+    return false;
+}
+template<>
+inline void* kmillet::details::sized_any::TypeInfo<void>::Relocate(void*, std::byte*, arena*)
+{
+    // No operation needed for void type
+    return nullptr;
+}
 
 template <class T>
 inline constexpr const std::type_info& kmillet::details::sized_any::TypeInfo<T>::Type() noexcept
@@ -594,6 +830,17 @@ inline constexpr std::size_t kmillet::details::sized_any::TypeInfo<T>::Size() no
     return sizeof(T);
 }
 template<class T>
+inline constexpr std::size_t kmillet::details::sized_any::TypeInfo<T>::Alignment() noexcept
+{
+    return alignof(T);
+}
+template<class T>
+inline constexpr const void* kmillet::details::sized_any::TypeInfo<T>::Marker() noexcept
+{
+    if constexpr (requires { { T::sized_any_marker } -> std::convertible_to<const void*>; }) return T::sized_any_marker;
+    else return nullptr;
+}
+template<class T>
 inline constexpr bool kmillet::details::sized_any::TypeInfo<T>::NeedsAlloc(std::size_t cap) noexcept
 {
     return sizeof(T) > cap || !std::is_nothrow_move_constructible_v<T>;
@@ -605,13 +852,13 @@ inline void kmillet::details::sized_any::TypeInfo<T>::Copy(const void* from, cha
     {
         if (NeedsAlloc(fromCap))
         {
-            *reinterpret_cast<const void**>(to) = new T(**reinterpret_cast<const T* const*>(from));
+            *reinterpret_cast<const void**>(to) = new T(*heap<T>::get(*reinterpret_cast<const void* const*>(from)));
         }
         else *reinterpret_cast<const void**>(to) = new T(*reinterpret_cast<const T*>(from));
     }
     else if (NeedsAlloc(fromCap))
     {
-        new (to) T(**reinterpret_cast<const T* const*>(from));
+        new (to) T(*heap<T>::get(*reinterpret_cast<const void* const*>(from)));
     }
     else new (to) T(*reinterpret_cast<const T*>(from));
 }
@@ -629,8 +876,8 @@ inline void kmillet::details::sized_any::TypeInfo<T>::Move(void* from, char* to,
     }
     else if (NeedsAlloc(fromCap))
     {
-        new (to) T(std::move(**reinterpret_cast<T**>(from)));
-        delete *reinterpret_cast<T**>(from);
+        new (to) T(std::move(*heap<T>::get(*reinterpret_cast<void**>(from))));
+        heap<T>::destroy(*reinterpret_cast<void**>(from));
         return;
     }
     else new (to) T(std::move(*reinterpret_cast<T*>(from)));
@@ -639,208 +886,389 @@ inline void kmillet::details::sized_any::TypeInfo<T>::Move(void* from, char* to,
 template<class T>
 inline void kmillet::details::sized_any::TypeInfo<T>::DestructReuseHeap(void* buff) noexcept
 {
-    (*reinterpret_cast<T**>(buff))->~T();
+    heap<T>::get(*reinterpret_cast<void**>(buff))->~T();
 }
 template<class T>
 inline void kmillet::details::sized_any::TypeInfo<T>::CleanUp(void* buff, std::size_t cap) noexcept
 {
     if (NeedsAlloc(cap))
     {
-        delete *reinterpret_cast<T**>(buff);
+        heap<T>::destroy(*reinterpret_cast<void**>(buff));
     }
     else reinterpret_cast<T*>(buff)->~T();
 }
+template<class T>
+inline constexpr bool kmillet::details::sized_any::TypeInfo<T>::Relocatable() noexcept
+{
+    return heap<T>::relocatable;
+}
+template<class T>
+inline void* kmillet::details::sized_any::TypeInfo<T>::Relocate(void* buff, std::byte* content, arena* owner)
+{
+    if constexpr (heap<T>::relocatable)
+    {
+        void* old = *reinterpret_cast<void**>(buff);
+        *reinterpret_cast<void**>(buff) = heap<T>::make_in(content, owner, std::move(*heap<T>::get(old)));
+        return old;
+    }
+    else return nullptr;
+}
+
+#if KMILLET_SIZED_ANY_TRACE()
+template<class Dispatch>
+inline void kmillet::details::sized_any::trace(kmillet::sized_any_trace_event event, const void* self, const void* other, const ITypeInfo<Dispatch>* type) noexcept
+{
+    // A type needs to be allocated in a buffer of its own size only if it is not nothrow move constructible.
+    if (auto hook = tracer.load(std::memory_order_relaxed)) hook(event, self, other, type->size(), type->alignment(), !type->needsAlloc(type->size()));
+}
+inline kmillet::sized_any_trace_hook kmillet::set_sized_any_trace_hook(kmillet::sized_any_trace_hook hook) noexcept
+{
+    return kmillet::details::sized_any::tracer.exchange(hook);
+}
+#endif
 
-template <std::size_t N>
-inline constexpr kmillet::sized_any<N>::sized_any() noexcept
-    : info(&(kmillet::details::sized_any::info<void>))
+struct kmillet::details::sized_any::access
+{
+    template<std::size_t N, class Dispatch>
+    static const ITypeInfo<Dispatch>* info(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept { return operand.info; }
+    // Returns the address of the contained object, or of the empty buffer if there is none.
+    template<std::size_t N, class Dispatch>
+    static const void* data(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept
+    {
+        if (!operand.info->needsAlloc(N)) return operand.buff.data();
+        const void* stored = *reinterpret_cast<const void* const*>(operand.buff.data());
+        // Only the pointers to contents of relocatable types may be tagged.
+        if (operand.info->relocatable()) return arena::untagged(stored);
+        else return stored;
+    }
+    // Returns the buffer of `operand`, which holds either the contained object or a pointer to it.
+    template<std::size_t N, class Dispatch>
+    static char* buffer(::kmillet::sized_any<N, Dispatch>& operand) noexcept { return operand.buff.data(); }
+    template<std::size_t N, class Dispatch>
+    static const char* buffer(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept { return operand.buff.data(); }
+    // Replaces the type information of `operand` without touching its buffer, after its contents were constructed or moved out directly.
+    template<std::size_t N, class Dispatch>
+    static void adopt(::kmillet::sized_any<N, Dispatch>& operand, const ITypeInfo<Dispatch>* info) noexcept { operand.info = info; }
+    // Returns whether the contained object is heap-allocated and can be moved into an arena by `relocate`.
+    template<std::size_t N, class Dispatch>
+    static bool relocatable(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept
+    {
+        return operand.info->needsAlloc(N) && operand.info->relocatable();
+    }
+    // Moves a relocatable contained object to `content`, in the arena `owner`, which must be aligned for it and leave room for the pointer
+    // to the arena just before it. Returns the stored pointer to the moved-from object, which must be released with `release`.
+    template<std::size_t N, class Dispatch>
+    static void* relocate(::kmillet::sized_any<N, Dispatch>& operand, std::byte* content, arena* owner)
+    {
+        return operand.info->relocate(operand.buff.data(), content, owner);
+    }
+    // Destroys an object returned by `relocate` and releases its storage, given the type information of its object.
+    template<std::size_t N, class Dispatch>
+    static void release(const ITypeInfo<Dispatch>* info, void* payload) noexcept
+    {
+        info->cleanUp(&payload, N);
+    }
+    // Returns the contained object, which must be of type `T`.
+    template<class T, std::size_t N, class Dispatch>
+    static T& unchecked(::kmillet::sized_any<N, Dispatch>& operand) noexcept
+    {
+        if constexpr (TypeInfo<T>::NeedsAlloc(N)) return *heap<T>::get(*reinterpret_cast<void**>(operand.buff.data()));
+        else return *reinterpret_cast<T*>(operand.buff.data());
+    }
+    template<class T, std::size_t N, class Dispatch>
+    static const T& unchecked(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept
+    {
+        if constexpr (TypeInfo<T>::NeedsAlloc(N)) return *heap<T>::get(*reinterpret_cast<const void* const*>(operand.buff.data()));
+        else return *reinterpret_cast<const T*>(operand.buff.data());
+    }
+};
+
+template<class Dispatch, class... Ts>
+struct kmillet::details::sized_any::info_index
+{
+    static constexpr std::size_t size = sizeof...(Ts);
+
+    // Returns the position of the first of `Ts` whose type information is `key`, or `size` if there is none.
+    static std::size_t find(const ITypeInfo<Dispatch>* key) noexcept
+    {
+        if constexpr (size <= linear)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                if (infos[i] == key) return i;
+            }
+            return size;
+        }
+        else
+        {
+            // Addresses are not known until link time, so the table is hashed on first use.
+            static const std::array<slot, capacity> table = Build();
+            for (std::size_t i = Hash(key) & (capacity - 1);; i = (i + 1) & (capacity - 1))
+            {
+                if (table[i].key == key) return table[i].index;
+                if (!table[i].key) return size;
+            }
+        }
+    }
+
+private:
+    struct slot
+    {
+        const ITypeInfo<Dispatch>* key = nullptr;
+        std::size_t index = 0;
+    };
+
+    // Below this many types, comparing every pointer is faster than hashing.
+    static constexpr std::size_t linear = 4;
+    // At most half of the slots are used, so that probes stay short and always reach an empty slot.
+    static constexpr std::size_t capacity = std::bit_ceil(2 * size);
+    static constexpr std::array<const ITypeInfo<Dispatch>*, size> infos{&info<Ts, Dispatch>...};
+
+    static std::size_t Hash(const void* key) noexcept
+    {
+        // Type information objects are at least pointer-aligned, so the low bits carry no information.
+        const auto bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key));
+        return static_cast<std::size_t>((bits >> 3) * 0x9E3779B97F4A7C15ull >> 32);
+    }
+    static std::array<slot, capacity> Build() noexcept
+    {
+        std::array<slot, capacity> table{};
+        for (std::size_t index = 0; index < size; ++index)
+        {
+            std::size_t i = Hash(infos[index]) & (capacity - 1);
+            while (table[i].key && table[i].key != infos[index]) i = (i + 1) & (capacity - 1);
+            // Repeated types keep their first position.
+            if (!table[i].key) table[i] = {infos[index], index};
+        }
+        return table;
+    }
+};
+
+template <std::size_t N, class Dispatch>
+inline constexpr kmillet::sized_any<N, Dispatch>::sized_any() noexcept
+    : info(&(kmillet::details::sized_any::info<void, Dispatch>))
 {}
-template <std::size_t N>
-inline kmillet::sized_any<N>::sized_any(const kmillet::sized_any<N>& other)
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any<N, Dispatch>::sized_any(const kmillet::sized_any<N, Dispatch>& other)
     : info(other.info)
 {
     info->copy(other.buff.data(), buff.data(), N, N);
+    KMILLET_SIZED_ANY_TRACE_EVENT(copy, this, &other, info);
 }
-template <std::size_t N>
-template<std::size_t M>
-inline kmillet::sized_any<N>::sized_any(const kmillet::sized_any<M>& other)
-    : info(other.info)
+template <std::size_t N, class Dispatch>
+template <std::size_t M, class OtherDispatch>
+inline kmillet::sized_any<N, Dispatch>::sized_any(const kmillet::sized_any<M, OtherDispatch>& other)
+    : info(kmillet::details::sized_any::rebind<Dispatch>(other.info))
 {
     info->copy(other.buff.data(), buff.data(), M, N);
+    KMILLET_SIZED_ANY_TRACE_EVENT(copy, this, &other, info);
 }
-template <std::size_t N>
-inline kmillet::sized_any<N>::sized_any(kmillet::sized_any<N>&& other) noexcept
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any<N, Dispatch>::sized_any(kmillet::sized_any<N, Dispatch>&& other) noexcept
     : info(other.info)
 {
     info->move(other.buff.data(), buff.data(), N, N);
-    other.info = &(kmillet::details::sized_any::info<void>);
+    KMILLET_SIZED_ANY_TRACE_EVENT(move, this, &other, info);
+    other.info = &(kmillet::details::sized_any::info<void, Dispatch>);
 }
-template <std::size_t N>
-template<std::size_t M>
-inline kmillet::sized_any<N>::sized_any(kmillet::sized_any<M>&& other) noexcept(M < N)
-    : info(other.info)
+template <std::size_t N, class Dispatch>
+template <std::size_t M, class OtherDispatch>
+inline kmillet::sized_any<N, Dispatch>::sized_any(kmillet::sized_any<M, OtherDispatch>&& other) noexcept(M <= N)
+    : info(kmillet::details::sized_any::rebind<Dispatch>(other.info))
 {
     info->move(other.buff.data(), buff.data(), M, N);
-    other.info = &(kmillet::details::sized_any::info<void>);
+    KMILLET_SIZED_ANY_TRACE_EVENT(move, this, &other, info);
+    other.info = &(kmillet::details::sized_any::info<void, OtherDispatch>);
 }
-template <std::size_t N>
+template <std::size_t N, class Dispatch>
 template <class ValueType>
 requires(std::conjunction_v<std::negation<kmillet::details::sized_any::is_sized_any<std::decay_t<ValueType>>>, std::negation<std::is_same<std::decay_t<ValueType>, std::any>>, std::negation<kmillet::details::sized_any::is_in_place_type<std::decay_t<ValueType>>>, std::is_copy_constructible<std::decay_t<ValueType>>>)
-inline kmillet::sized_any<N>::sized_any(ValueType&& value) noexcept(std::is_nothrow_constructible_v<std::decay_t<ValueType>, ValueType> && kmillet::sized_any_optimized<ValueType, N>)
-    : info(&(kmillet::details::sized_any::info<std::decay_t<ValueType>>))
+inline kmillet::sized_any<N, Dispatch>::sized_any(ValueType&& value) noexcept(std::is_nothrow_constructible_v<std::decay_t<ValueType>, ValueType> && kmillet::sized_any_optimized<ValueType, N>)
+    : info(&(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>))
 {
-    if constexpr (kmillet::details::sized_any::info<std::decay_t<ValueType>>.NeedsAlloc(N))
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::NeedsAlloc(N))
     {
         *reinterpret_cast<void**>(buff.data()) = new std::decay_t<ValueType>(std::forward<ValueType>(value));
     }
     else new (buff.data()) std::decay_t<ValueType>(std::forward<ValueType>(value));
+    KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, info);
 }
-template <std::size_t N>
+template <std::size_t N, class Dispatch>
 template <class ValueType, class... Args>
 requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
-inline kmillet::sized_any<N>::sized_any(std::in_place_type_t<ValueType>, Args&&... args) noexcept(std::is_nothrow_constructible_v<std::decay_t<ValueType>, Args...> && kmillet::sized_any_optimized<ValueType, N>)
-    : info(&(kmillet::details::sized_any::info<std::decay_t<ValueType>>))
+inline kmillet::sized_any<N, Dispatch>::sized_any(std::in_place_type_t<ValueType>, Args&&... args) noexcept(std::is_nothrow_constructible_v<std::decay_t<ValueType>, Args...> && kmillet::sized_any_optimized<ValueType, N>)
+    : info(&(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>))
 {
-    if constexpr (kmillet::details::sized_any::info<std::decay_t<ValueType>>.NeedsAlloc(N))
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::NeedsAlloc(N))
     {
         *reinterpret_cast<void**>(buff.data()) = new std::decay_t<ValueType>(std::forward<Args>(args)...);
     }
     else new (buff.data()) std::decay_t<ValueType>(std::forward<Args>(args)...);
+    KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, info);
 }
-template <std::size_t N>
+template <std::size_t N, class Dispatch>
 template <class ValueType, class U, class... Args>
 requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, std::initializer_list<U>&, Args...>)
-inline kmillet::sized_any<N>::sized_any(std::in_place_type_t<ValueType>, std::initializer_list<U> il, Args&&... args) noexcept(std::is_nothrow_constructible_v<std::decay_t<ValueType>, std::initializer_list<U>&, Args...> && kmillet::sized_any_optimized<ValueType, N>)
-    : info(&(kmillet::details::sized_any::info<std::decay_t<ValueType>>))
+inline kmillet::sized_any<N, Dispatch>::sized_any(std::in_place_type_t<ValueType>, std::initializer_list<U> il, Args&&... args) noexcept(std::is_nothrow_constructible_v<std::decay_t<ValueType>, std::initializer_list<U>&, Args...> && kmillet::sized_any_optimized<ValueType, N>)
+    : info(&(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>))
 {
-    if constexpr (kmillet::details::sized_any::info<std::decay_t<ValueType>>.NeedsAlloc(N))
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::NeedsAlloc(N))
     {
         *reinterpret_cast<void**>(buff.data()) = new std::decay_t<ValueType>(il, std::forward<Args>(args)...);
     }
     else new (buff.data()) std::decay_t<ValueType>(il, std::forward<Args>(args)...);
+    KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, info);
 }
 
-template <std::size_t N>
-inline kmillet::sized_any<N>::~sized_any()
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any<N, Dispatch>::~sized_any()
 {
     reset();
 }
 
-template <std::size_t N>
-inline kmillet::sized_any<N>& kmillet::sized_any<N>::operator=(const kmillet::sized_any<N>& rhs)
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any<N, Dispatch>& kmillet::sized_any<N, Dispatch>::operator=(const kmillet::sized_any<N, Dispatch>& rhs)
 {
     if (&rhs == this) return *this;
-    kmillet::sized_any<N>(rhs).swap(*this);
+    kmillet::sized_any<N, Dispatch>(rhs).swap(*this);
     return *this;
 }
-template <std::size_t N>
-template <std::size_t M>
-inline kmillet::sized_any<N>& kmillet::sized_any<N>::operator=(const kmillet::sized_any<M>& rhs)
+template <std::size_t N, class Dispatch>
+template <std::size_t M, class OtherDispatch>
+inline kmillet::sized_any<N, Dispatch>& kmillet::sized_any<N, Dispatch>::operator=(const kmillet::sized_any<M, OtherDispatch>& rhs)
 {
-    kmillet::sized_any<N>(rhs).swap(*this);
+    kmillet::sized_any<N, Dispatch>(rhs).swap(*this);
     return *this;
 }
-template <std::size_t N>
-inline kmillet::sized_any<N>& kmillet::sized_any<N>::operator=(kmillet::sized_any<N>&& rhs) noexcept
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any<N, Dispatch>& kmillet::sized_any<N, Dispatch>::operator=(kmillet::sized_any<N, Dispatch>&& rhs) noexcept
 {
     if (&rhs == this) return *this;
-    kmillet::sized_any<N>(std::move(rhs)).swap(*this);
+    kmillet::sized_any<N, Dispatch>(std::move(rhs)).swap(*this);
     return *this;
 }
-template <std::size_t N>
-template <std::size_t M>
-inline kmillet::sized_any<N>& kmillet::sized_any<N>::operator=(kmillet::sized_any<M>&& rhs) noexcept(M < N)
+template <std::size_t N, class Dispatch>
+template <std::size_t M, class OtherDispatch>
+inline kmillet::sized_any<N, Dispatch>& kmillet::sized_any<N, Dispatch>::operator=(kmillet::sized_any<M, OtherDispatch>&& rhs) noexcept(M <= N)
 {
-    kmillet::sized_any<N>(std::move(rhs)).swap(*this);
+    kmillet::sized_any<N, Dispatch>(std::move(rhs)).swap(*this);
     return *this;
 }
-template <std::size_t N>
+template <std::size_t N, class Dispatch>
 template <class ValueType>
 requires(std::conjunction_v<std::negation<kmillet::details::sized_any::is_sized_any<std::decay_t<ValueType>>>, std::negation<std::is_same<std::decay_t<ValueType>, std::any>>, std::is_copy_constructible<std::decay_t<ValueType>>>)
-inline kmillet::sized_any<N>& kmillet::sized_any<N>::operator=(ValueType&& rhs) noexcept(noexcept(kmillet::sized_any<N>{std::forward<ValueType>(rhs)}))
+inline kmillet::sized_any<N, Dispatch>& kmillet::sized_any<N, Dispatch>::operator=(ValueType&& rhs) noexcept(noexcept(kmillet::sized_any<N, Dispatch>{std::forward<ValueType>(rhs)}))
 {
-    kmillet::sized_any<N>(std::forward<ValueType>(rhs)).swap(*this);
+    kmillet::sized_any<N, Dispatch>(std::forward<ValueType>(rhs)).swap(*this);
     return *this;
 }
 
-template <std::size_t N>
+template <std::size_t N, class Dispatch>
 template <class ValueType, class... Args>
 requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
-inline std::decay_t<ValueType>& kmillet::sized_any<N>::emplace(Args&&... args) noexcept(noexcept(kmillet::sized_any<N>{std::in_place_type<ValueType>, std::forward<Args>(args)...}))
+inline std::decay_t<ValueType>& kmillet::sized_any<N, Dispatch>::emplace(Args&&... args) noexcept(noexcept(kmillet::sized_any<N, Dispatch>{std::in_place_type<ValueType>, std::forward<Args>(args)...}))
 {
-    if constexpr (kmillet::details::sized_any::info<std::decay_t<ValueType>>.NeedsAlloc(N))
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::NeedsAlloc(N))
     {
-        if (info->needsAlloc(N) && info->size() == kmillet::details::sized_any::info<std::decay_t<ValueType>>.Size())
+        using heap = kmillet::details::sized_any::heap<std::decay_t<ValueType>>;
+        void*& stored = *reinterpret_cast<void**>(buff.data());
+        // Storage in an arena is only reused for contents that may lie there, and whose alignment it satisfies.
+        const bool inArena = info->needsAlloc(N) && info->relocatable() && kmillet::details::sized_any::arena::tagged(stored);
+        if (info->needsAlloc(N) && info->size() == kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::Size()
+            && (!inArena || (heap::relocatable && alignof(std::decay_t<ValueType>) <= info->alignment())))
         {
             info->destructReuseHeap(buff.data());
-            new (*reinterpret_cast<void**>(buff.data())) std::decay_t<ValueType>(std::forward<Args>(args)...);
+            new (inArena ? kmillet::details::sized_any::arena::untagged(stored) : stored) std::decay_t<ValueType>(std::forward<Args>(args)...);
         }
         else
         {
             info->cleanUp(buff.data(), N);
-            *reinterpret_cast<void**>(buff.data()) = new std::decay_t<ValueType>(std::forward<Args>(args)...);
+            stored = new std::decay_t<ValueType>(std::forward<Args>(args)...);
         }
-        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>>);
-        return **reinterpret_cast<std::decay_t<ValueType>**>(buff.data());
+        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>);
+        KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, info);
+        return *heap::get(stored);
     }
     else
     {
         info->cleanUp(buff.data(), N);
         new (buff.data()) std::decay_t<ValueType>(std::forward<Args>(args)...);
-        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>>);
+        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>);
+        KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, info);
         return *reinterpret_cast<std::decay_t<ValueType>*>(buff.data());
     }
 }
-template <std::size_t N>
+template <std::size_t N, class Dispatch>
 template<class ValueType, class U, class... Args>
 requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, std::initializer_list<U>&, Args...>)
-inline std::decay_t<ValueType>& kmillet::sized_any<N>::emplace(std::initializer_list<U> il, Args&&... args) noexcept(noexcept(kmillet::sized_any<N>{std::in_place_type<ValueType>, il, std::forward<Args>(args)...}))
+inline std::decay_t<ValueType>& kmillet::sized_any<N, Dispatch>::emplace(std::initializer_list<U> il, Args&&... args) noexcept(noexcept(kmillet::sized_any<N, Dispatch>{std::in_place_type<ValueType>, il, std::forward<Args>(args)...}))
 {
-    if constexpr (kmillet::details::sized_any::info<std::decay_t<ValueType>>.NeedsAlloc(N))
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::NeedsAlloc(N))
     {
-        if (info->needsAlloc(N) && info->size() == kmillet::details::sized_any::info<std::decay_t<ValueType>>.Size())
+        using heap = kmillet::details::sized_any::heap<std::decay_t<ValueType>>;
+        void*& stored = *reinterpret_cast<void**>(buff.data());
+        // Storage in an arena is only reused for contents that may lie there, and whose alignment it satisfies.
+        const bool inArena = info->needsAlloc(N) && info->relocatable() && kmillet::details::sized_any::arena::tagged(stored);
+        if (info->needsAlloc(N) && info->size() == kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::Size()
+            && (!inArena || (heap::relocatable && alignof(std::decay_t<ValueType>) <= info->alignment())))
         {
             info->destructReuseHeap(buff.data());
-            new (*reinterpret_cast<void**>(buff.data())) std::decay_t<ValueType>(il, std::forward<Args>(args)...);
+            new (inArena ? kmillet::details::sized_any::arena::untagged(stored) : stored) std::decay_t<ValueType>(il, std::forward<Args>(args)...);
         }
         else
         {
             info->cleanUp(buff.data(), N);
-            *reinterpret_cast<void**>(buff.data()) = new std::decay_t<ValueType>(il, std::forward<Args>(args)...);
+            stored = new std::decay_t<ValueType>(il, std::forward<Args>(args)...);
         }
-        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>>);
-        return **reinterpret_cast<std::decay_t<ValueType>**>(buff.data());
+        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>);
+        KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, info);
+        return *heap::get(stored);
     }
     else
     {
         info->cleanUp(buff.data(), N);
         new (buff.data()) std::decay_t<ValueType>(il, std::forward<Args>(args)...);
-        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>>);
+        info = &(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>);
+        KMILLET_SIZED_ANY_TRACE_EVENT(construct, this, nullptr, info);
         return *reinterpret_cast<std::decay_t<ValueType>*>(buff.data());
     }
 }
 
-template <std::size_t N>
-inline void kmillet::sized_any<N>::reset() noexcept
+template <std::size_t N, class Dispatch>
+template <class ValueType, class F, class... Args>
+requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...> && std::invocable<F, std::decay_t<ValueType>&>)
+inline std::decay_t<ValueType>& kmillet::sized_any<N, Dispatch>::emplace_or_reuse(F&& reuse, Args&&... args)
 {
-    if (info == &(kmillet::details::sized_any::info<void>)) return;
+    if (info != &(kmillet::details::sized_any::info<std::decay_t<ValueType>, Dispatch>)) return emplace<ValueType>(std::forward<Args>(args)...);
+    auto& value = kmillet::details::sized_any::access::unchecked<std::decay_t<ValueType>>(*this);
+    std::invoke(std::forward<F>(reuse), value);
+    return value;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any<N, Dispatch>::reset() noexcept
+{
+    if (info == &(kmillet::details::sized_any::info<void, Dispatch>)) return;
+    KMILLET_SIZED_ANY_TRACE_EVENT(destroy, this, nullptr, info);
     info->cleanUp(buff.data(), N);
-    info = &(kmillet::details::sized_any::info<void>);
+    info = &(kmillet::details::sized_any::info<void, Dispatch>);
 }
-template <std::size_t N>
-inline void kmillet::sized_any<N>::swap(kmillet::sized_any<N>& other) noexcept
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any<N, Dispatch>::swap(kmillet::sized_any<N, Dispatch>& other) noexcept
 {
     if (&other == this) return; 
+    KMILLET_SIZED_ANY_TRACE_EVENT(swap, this, &other, &(kmillet::details::sized_any::info<void, Dispatch>));
     std::array<char, N> tmp;
     other.info->move(other.buff.data(), tmp.data(), N, N);
     info->move(buff.data(), other.buff.data(), N, N);
-    info->move(tmp.data(), buff.data(), N, N);
+    other.info->move(tmp.data(), buff.data(), N, N);
     if (info != other.info) std::swap(info, other.info);
 }
-template <std::size_t N>
-template <std::size_t M>
-inline void kmillet::sized_any<N>::swap(kmillet::sized_any<M>& other)
+template <std::size_t N, class Dispatch>
+template <std::size_t M, class OtherDispatch>
+inline void kmillet::sized_any<N, Dispatch>::swap(kmillet::sized_any<M, OtherDispatch>& other)
 {
+    KMILLET_SIZED_ANY_TRACE_EVENT(swap, this, &other, &(kmillet::details::sized_any::info<void, Dispatch>));
     if constexpr (M < N)
     {
         std::array<char, M> tmp;
@@ -853,57 +1281,63 @@ inline void kmillet::sized_any<N>::swap(kmillet::sized_any<M>& other)
         std::array<char, N> tmp;
         other.info->move(other.buff.data(), tmp.data(), M, N);
         info->move(buff.data(), other.buff.data(), N, M);
-        info->move(tmp.data(), buff.data(), N, N);
+        other.info->move(tmp.data(), buff.data(), N, N);
     }
-    if (info != other.info) std::swap(info, other.info);
+    const auto* otherInfo = kmillet::details::sized_any::rebind<Dispatch>(other.info);
+    other.info = kmillet::details::sized_any::rebind<OtherDispatch>(info);
+    info = otherInfo;
 }
 
-template <std::size_t N>
-inline bool kmillet::sized_any<N>::has_value() const noexcept
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_any<N, Dispatch>::has_value() const noexcept
 {
-    return info != &(kmillet::details::sized_any::info<void>);
+    return info != &(kmillet::details::sized_any::info<void, Dispatch>);
 }
-template <std::size_t N>
-inline const std::type_info& kmillet::sized_any<N>::type() const noexcept
+template <std::size_t N, class Dispatch>
+inline const std::type_info& kmillet::sized_any<N, Dispatch>::type() const noexcept
 {
     return info->type();
 }
 
-template <class T, std::size_t N>
-inline T kmillet::any_cast(const kmillet::sized_any<N>& operand)
+template <class T, std::size_t N, class Dispatch>
+inline T kmillet::any_cast(const kmillet::sized_any<N, Dispatch>& operand)
 {
     if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(*casted);
     KMILLET_SIZED_ANY_THROW_OR_ABORT();
 }
-template <class T, std::size_t N>
-inline T kmillet::any_cast(kmillet::sized_any<N>& operand)
+template <class T, std::size_t N, class Dispatch>
+inline T kmillet::any_cast(kmillet::sized_any<N, Dispatch>& operand)
 {
     if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(*casted);
     KMILLET_SIZED_ANY_THROW_OR_ABORT();
 }
-template <class T, std::size_t N>
-inline T kmillet::any_cast(kmillet::sized_any<N>&& operand)
+template <class T, std::size_t N, class Dispatch>
+inline T kmillet::any_cast(kmillet::sized_any<N, Dispatch>&& operand)
 {
     if (auto* casted = any_cast<std::remove_cvref_t<T>>(&operand)) return static_cast<T>(std::move(*casted));
     KMILLET_SIZED_ANY_THROW_OR_ABORT();
 }
-template <class T, std::size_t N>
-inline const T* kmillet::any_cast(const kmillet::sized_any<N>* operand) noexcept
+template <class T, std::size_t N, class Dispatch>
+inline const T* kmillet::any_cast(const kmillet::sized_any<N, Dispatch>* operand) noexcept
 {
-    if (!operand || operand->info != &(kmillet::details::sized_any::info<std::decay_t<T>>)) return nullptr;
-    if constexpr (kmillet::details::sized_any::info<std::decay_t<T>>.NeedsAlloc(N))
+    if (!operand) return nullptr;
+    KMILLET_SIZED_ANY_TRACE_EVENT(cast, operand, nullptr, &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>));
+    if (operand->info != &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>)) return nullptr;
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<T>>::NeedsAlloc(N))
     {
-        return *reinterpret_cast<const T**>(operand->buff.data());
+        return kmillet::details::sized_any::heap<std::decay_t<T>>::get(*reinterpret_cast<const void* const*>(operand->buff.data()));
     }
     else return reinterpret_cast<const T*>(operand->buff.data());
 }
-template <class T, std::size_t N>
-inline T* kmillet::any_cast(kmillet::sized_any<N>* operand) noexcept
+template <class T, std::size_t N, class Dispatch>
+inline T* kmillet::any_cast(kmillet::sized_any<N, Dispatch>* operand) noexcept
 {
-    if (!operand || operand->info != &(kmillet::details::sized_any::info<std::decay_t<T>>)) return nullptr;
-    if constexpr (kmillet::details::sized_any::info<std::decay_t<T>>.NeedsAlloc(N))
+    if (!operand) return nullptr;
+    KMILLET_SIZED_ANY_TRACE_EVENT(cast, operand, nullptr, &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>));
+    if (operand->info != &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>)) return nullptr;
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<T>>::NeedsAlloc(N))
     {
-        return *reinterpret_cast<T**>(operand->buff.data());
+        return kmillet::details::sized_any::heap<std::decay_t<T>>::get(*reinterpret_cast<void**>(operand->buff.data()));
     }
     else return reinterpret_cast<T*>(operand->buff.data());
 }
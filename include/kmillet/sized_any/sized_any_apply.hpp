@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_apply.hpp
+ * @author Kenan Millet
+ * @brief Invocation of typed callables with arguments held in a range of `kmillet::sized_any<N>`, checked against their signature at once.
+ *
+ * This header provides the `kmillet::apply_any` and `kmillet::can_apply_any` function templates, an alternative to one `kmillet::any_cast` per parameter.
+ * - The parameter types of the callable are deduced from its signature, and the type information pointers that its arguments must have
+ *   are computed at compile time.
+ * - All arguments are checked with a single branch-free comparison of those pointers, after which the callable is invoked with references
+ *   to the contents of the arguments, wherever they are stored (in-place or on the heap), without copying them.
+ * - Arguments are moved into parameters taken by value or by rvalue reference when the range is an rvalue that owns its elements,
+ *   such as a `std::vector` passed with `std::move`, and copied otherwise.
+ *
+ * The callable must have a single signature: a function, a pointer to a function, or an object with a single, non-template `operator()`,
+ * such as a lambda whose parameters are not `auto`.
+ *
+ * @section Usage
+ * @code
+ * std::vector<kmillet::any> args{std::string("alice"), 42};
+ * auto handler = [](const std::string& name, int age) { return name.size() + age; };
+ * std::size_t result = kmillet::apply_any(handler, args); // throws std::bad_any_cast unless kmillet::can_apply_any(handler, args)
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <array>
+#include <functional>  // for invoke
+#include <ranges>      // for contiguous_range, sized_range, data, size, view, range_reference_t
+#include <tuple>       // for tuple_element_t
+#include <type_traits> // for remove_cvref_t, remove_cv_t, is_lvalue_reference_v, is_rvalue_reference_v, is_const_v
+#include <utility>     // for forward, move, index_sequence
+#include <cstddef>     // for size_t
+
+// Private utilities for kmillet::apply_any and kmillet::can_apply_any
+namespace kmillet::details::sized_any_apply
+{
+    template<class R, class... Args>
+    struct signature_traits
+    {
+        using result = R;
+        static constexpr std::size_t arity = sizeof...(Args);
+        template<std::size_t I> using parameter = std::tuple_element_t<I, std::tuple<Args...>>;
+    };
+
+    template<class F> struct signature : signature<decltype(&F::operator())> {};
+    template<class R, class... Args> struct signature<R(Args...)> : signature_traits<R, Args...> {};
+    template<class R, class... Args> struct signature<R(Args...) noexcept> : signature_traits<R, Args...> {};
+    template<class R, class... Args> struct signature<R(*)(Args...)> : signature_traits<R, Args...> {};
+    template<class R, class... Args> struct signature<R(*)(Args...) noexcept> : signature_traits<R, Args...> {};
+    template<class C, class R, class... Args> struct signature<R(C::*)(Args...)> : signature_traits<R, Args...> {};
+    template<class C, class R, class... Args> struct signature<R(C::*)(Args...) noexcept> : signature_traits<R, Args...> {};
+    template<class C, class R, class... Args> struct signature<R(C::*)(Args...) const> : signature_traits<R, Args...> {};
+    template<class C, class R, class... Args> struct signature<R(C::*)(Args...) const noexcept> : signature_traits<R, Args...> {};
+
+    template<class F>
+    using traits = signature<std::remove_cvref_t<F>>;
+
+    template<class Range>
+    using element = std::remove_reference_t<std::ranges::range_reference_t<Range>>;
+
+    template<class Range>
+    concept sized_any_range = std::ranges::contiguous_range<Range> && std::ranges::sized_range<Range>
+        && ::kmillet::details::sized_any::is_sized_any<std::remove_cv_t<element<Range>>>::value;
+
+    // Arguments are moved out of ranges that are rvalues and own their elements, since nothing else can observe them afterwards.
+    template<class Range>
+    inline constexpr bool moves = !std::is_lvalue_reference_v<Range> && !std::ranges::view<std::remove_cvref_t<Range>> && !std::is_const_v<element<Range>>;
+
+    template<class Any> struct any_traits;
+    template<std::size_t N, class Dispatch> struct any_traits<::kmillet::sized_any<N, Dispatch>> { using dispatch = Dispatch; };
+
+    // Compares the type information pointers of all arguments with those expected by the parameters of `F`, without branching between them.
+    template<class F, class Any, std::size_t... Is>
+    bool matches(const Any* args, std::index_sequence<Is...>) noexcept
+    {
+        using dispatch = typename any_traits<std::remove_cv_t<Any>>::dispatch;
+        static constexpr std::array<const sized_any::ITypeInfo<dispatch>*, sizeof...(Is)> expected{
+            &(sized_any::info<std::remove_cvref_t<typename traits<F>::template parameter<Is>>, dispatch>)...};
+        return (true & ... & (sized_any::access::info(args[Is]) == expected[Is]));
+    }
+
+    // Passes the contents of an argument as the parameter of type `P`. A copy is passed to an rvalue reference parameter when the contents
+    // cannot be moved from, since an lvalue would not bind to it.
+    template<class P, bool Move, class Any>
+    decltype(auto) argument(Any& arg)
+    {
+        auto& contents = sized_any::access::unchecked<std::remove_cvref_t<P>>(arg);
+        if constexpr (Move && !std::is_lvalue_reference_v<P>) return std::move(contents);
+        else if constexpr (std::is_rvalue_reference_v<P>) return std::remove_cvref_t<P>(contents);
+        else return (contents);
+    }
+
+    template<bool Move, class F, class Any, std::size_t... Is>
+    typename traits<F>::result invoke(F&& f, Any* args, std::index_sequence<Is...>)
+    {
+        return std::invoke(std::forward<F>(f), argument<typename traits<F>::template parameter<Is>, Move>(args[Is])...);
+    }
+}
+
+namespace kmillet
+{
+    /**
+     * @brief Checks whether the objects in `args` are, in order, of the parameter types of `f`.
+     * @tparam F The type of the callable, which must have a single signature.
+     * @tparam Range A contiguous range of `kmillet::sized_any` objects.
+     * @param f The callable, which is not invoked.
+     * @param args The arguments.
+     * @return `true` if and only if `kmillet::apply_any(f, args)` would invoke `f`.
+     */
+    template<class F, class Range>
+    requires(details::sized_any_apply::sized_any_range<Range>)
+    [[nodiscard]] bool can_apply_any(const F& f, Range&& args) noexcept;
+
+    /**
+     * @brief Invokes `f` with the contents of the objects in `args`, once they have all been checked to be of its parameter types.
+     * @tparam F The type of the callable, which must have a single signature.
+     * @tparam Range A contiguous range of `kmillet::sized_any` objects.
+     * @param f The callable.
+     * @param args The arguments, as many as `f` has parameters.
+     * @return The result of `f`.
+     * @details Parameters taken by reference refer to the contents of the arguments. Parameters taken by value or by rvalue reference
+     * are moved from the arguments if `args` is an rvalue that owns its elements, and copied from them otherwise.
+     * If the number of arguments differs from the number of parameters of `f`, or an argument is not of the type of its parameter,
+     * `f` is not invoked and `std::bad_any_cast` is thrown, or the program is aborted if exceptions are disabled.
+     */
+    template<class F, class Range>
+    requires(details::sized_any_apply::sized_any_range<Range>)
+    typename details::sized_any_apply::traits<F>::result apply_any(F&& f, Range&& args);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class F, class Range>
+requires(kmillet::details::sized_any_apply::sized_any_range<Range>)
+inline bool kmillet::can_apply_any(const F&, Range&& args) noexcept
+{
+    using traits = kmillet::details::sized_any_apply::traits<F>;
+    if (std::ranges::size(args) != traits::arity) return false;
+    return kmillet::details::sized_any_apply::matches<F>(std::ranges::data(args), std::make_index_sequence<traits::arity>{});
+}
+
+template <class F, class Range>
+requires(kmillet::details::sized_any_apply::sized_any_range<Range>)
+inline typename kmillet::details::sized_any_apply::traits<F>::result kmillet::apply_any(F&& f, Range&& args)
+{
+    using traits = kmillet::details::sized_any_apply::traits<F>;
+    constexpr bool move = kmillet::details::sized_any_apply::moves<Range>;
+    if (kmillet::can_apply_any(f, args))
+    {
+        return kmillet::details::sized_any_apply::invoke<move>(std::forward<F>(f), std::ranges::data(args), std::make_index_sequence<traits::arity>{});
+    }
+    KMILLET_SIZED_ANY_THROW_OR_ABORT();
+}
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_broadcast.hpp
+ * @author Kenan Millet
+ * @brief A single-writer ring of `kmillet::sized_any<N>` slots that several consumers read in place.
+ *
+ * This header provides the `kmillet::sized_any_broadcast<N>` class template, for fanning values out to several consumers without copying them.
+ * - Every value published to the ring is seen by every consumer, which reads it in place through a const reference.
+ * - Each consumer has its own sequence cursor, padded to its own cache line. The writer reuses a slot only once every cursor has passed it,
+ *   and only reads the cursors when its cached copy of the slowest one says there is not enough room.
+ * - Both sides work in batches: the writer fills and publishes several slots with a single release store, and a consumer reads every
+ *   available slot before publishing its cursor once.
+ * - Neither side ever blocks or allocates after construction: when the ring is full or empty, the calls return `0` and the caller
+ *   decides whether to spin, yield or do something else.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any_broadcast<64> events(1024, 3); // 1024 slots, 3 consumers
+ * // on the writer thread:
+ * events.try_publish(trade{...});
+ * // on the thread of consumer 1:
+ * events.consume(1, [](const kmillet::sized_any<64>& event) { ... });
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <algorithm>   // for min
+#include <atomic>      // for atomic, memory_order
+#include <bit>         // for bit_ceil
+#include <concepts>    // for invocable
+#include <cstdint>     // for uint64_t
+#include <functional>  // for invoke
+#include <limits>      // for numeric_limits
+#include <memory>      // for unique_ptr, make_unique
+#include <utility>     // for move, as_const
+#include <vector>
+#include <cstddef>     // for size_t
+
+namespace kmillet
+{
+    /**
+     * @brief A bounded ring of `kmillet::sized_any<N, Dispatch>` slots written by a single thread and read, in full, by a fixed number of consumers.
+     * @tparam N The size of the buffer of each slot.
+     * @tparam Dispatch The dispatch policy of each slot.
+     * @details Publishing must only be done by one thread at a time. Each consumer must only be read from by one thread at a time,
+     * but different consumers may be read from concurrently, with each other and with the writer.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch>
+    class sized_any_broadcast
+    {
+    public:
+        /**
+         * @brief The type of each slot.
+         */
+        using value_type = sized_any<N, Dispatch>;
+
+        /**
+         * @brief Constructs an empty ring.
+         * @param capacity The number of slots, rounded up to a power of two.
+         * @param consumers The number of consumers, numbered from `0`.
+         */
+        sized_any_broadcast(std::size_t capacity, std::size_t consumers);
+        sized_any_broadcast(const sized_any_broadcast&) = delete;
+        sized_any_broadcast& operator=(const sized_any_broadcast&) = delete;
+
+        /**
+         * @brief Claims up to `count` free slots, lets `fill` write them, and publishes them to every consumer at once.
+         * @tparam F The type of the callable.
+         * @param count The maximum number of slots to claim.
+         * @param fill The callable, invoked in order with a `value_type&` to each claimed slot. The slot still holds the value that it was
+         * last published with, if any, so that `fill` may reuse it, for instance with `kmillet::sized_any::emplace`.
+         * @return The number of slots published, which is `0` if the ring is full.
+         * @details Must only be called by the writer. If `fill` throws, nothing is published.
+         */
+        template<class F>
+        requires(std::invocable<F&, value_type&>)
+        std::size_t publish(std::size_t count, F&& fill);
+        /**
+         * @brief Publishes `value` to every consumer, if there is a free slot.
+         * @param value The value to publish, which is moved into the slot. Left untouched if the ring is full.
+         * @return `true` if the value was published, or `false` if the ring is full.
+         * @details Must only be called by the writer.
+         */
+        bool try_publish(value_type& value);
+        /**
+         * @copydoc try_publish(value_type&)
+         */
+        bool try_publish(value_type&& value) { return try_publish(value); }
+
+        /**
+         * @brief Invokes `f` with each value published since the last call for `consumer`, in order, then releases their slots.
+         * @tparam F The type of the callable.
+         * @param consumer The consumer, which must be less than `consumers()`.
+         * @param f The callable, invoked with a `const value_type&` to each slot. The reference is only valid during the call.
+         * @param max The maximum number of values to read.
+         * @return The number of values read, which is `0` if there was none.
+         * @details If `f` throws, the value that it threw on and the following ones are read again by the next call.
+         */
+        template<class F>
+        requires(std::invocable<F&, const value_type&>)
+        std::size_t consume(std::size_t consumer, F&& f, std::size_t max = std::numeric_limits<std::size_t>::max());
+
+        /**
+         * @brief Gets the number of slots.
+         * @return The number of slots, which is a power of two.
+         */
+        [[nodiscard]] std::size_t capacity() const noexcept { return mask + 1; }
+        /**
+         * @brief Gets the number of consumers.
+         * @return The number of consumers.
+         */
+        [[nodiscard]] std::size_t consumers() const noexcept { return cursorCount; }
+        /**
+         * @brief Counts the values that `consumer` has yet to read.
+         * @param consumer The consumer, which must be less than `consumers()`.
+         * @return The number of values, which may be stale under concurrent use.
+         */
+        [[nodiscard]] std::size_t pending(std::size_t consumer) const noexcept;
+
+    private:
+        // Padded to its own cache line so that a consumer publishing its cursor does not invalidate the others.
+        struct alignas(64) cursor
+        {
+            std::atomic<std::uint64_t> sequence{0};
+        };
+
+        std::size_t Free(std::size_t wanted) noexcept;
+
+    // Member variables
+        std::vector<value_type> slots;
+        std::size_t mask;
+        std::unique_ptr<cursor[]> cursors;
+        std::size_t cursorCount;
+        alignas(64) std::atomic<std::uint64_t> published{0};
+        std::uint64_t slowest = 0;  // the writer's cached copy of the slowest cursor
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any_broadcast<N, Dispatch>::sized_any_broadcast(std::size_t capacity, std::size_t consumers)
+    : slots(std::bit_ceil(capacity ? capacity : 1))
+    , mask(slots.size() - 1)
+    , cursors(std::make_unique<cursor[]>(consumers))
+    , cursorCount(consumers)
+{}
+
+template <std::size_t N, class Dispatch>
+template <class F>
+requires(std::invocable<F&, typename kmillet::sized_any_broadcast<N, Dispatch>::value_type&>)
+inline std::size_t kmillet::sized_any_broadcast<N, Dispatch>::publish(std::size_t count, F&& fill)
+{
+    const std::uint64_t first = published.load(std::memory_order_relaxed);
+    count = std::min(count, Free(count));
+    for (std::size_t i = 0; i < count; ++i) std::invoke(fill, slots[(first + i) & mask]);
+    if (count) published.store(first + count, std::memory_order_release);
+    return count;
+}
+
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_any_broadcast<N, Dispatch>::try_publish(value_type& value)
+{
+    return publish(1, [&](value_type& slot) { slot = std::move(value); }) == 1;
+}
+
+template <std::size_t N, class Dispatch>
+template <class F>
+requires(std::invocable<F&, const typename kmillet::sized_any_broadcast<N, Dispatch>::value_type&>)
+inline std::size_t kmillet::sized_any_broadcast<N, Dispatch>::consume(std::size_t consumer, F&& f, std::size_t max)
+{
+    std::atomic<std::uint64_t>& sequence = cursors[consumer].sequence;
+    const std::uint64_t first = sequence.load(std::memory_order_relaxed);
+    const std::uint64_t last = first + std::min<std::uint64_t>(max, published.load(std::memory_order_acquire) - first);
+    std::uint64_t next = first;
+#if defined(__cpp_exceptions)
+    try
+    {
+#endif
+        for (; next != last; ++next) std::invoke(f, std::as_const(slots[next & mask]));
+#if defined(__cpp_exceptions)
+    }
+    catch (...)
+    {
+        sequence.store(next, std::memory_order_release);
+        throw;
+    }
+#endif
+    sequence.store(last, std::memory_order_release);
+    return static_cast<std::size_t>(last - first);
+}
+
+template <std::size_t N, class Dispatch>
+inline std::size_t kmillet::sized_any_broadcast<N, Dispatch>::pending(std::size_t consumer) const noexcept
+{
+    return static_cast<std::size_t>(published.load(std::memory_order_acquire) - cursors[consumer].sequence.load(std::memory_order_acquire));
+}
+
+template <std::size_t N, class Dispatch>
+inline std::size_t kmillet::sized_any_broadcast<N, Dispatch>::Free(std::size_t wanted) noexcept
+{
+    const std::uint64_t head = published.load(std::memory_order_relaxed);
+    const auto free = static_cast<std::size_t>(slots.size() - (head - slowest));
+    if (free >= wanted) return free;
+    // The cached cursor says that there is not enough room, so find out how far the slowest consumer has actually come.
+    // The acquire loads order the consumers' reads of the slots before the writer overwrites them.
+    std::uint64_t minimum = head;
+    for (std::size_t i = 0; i < cursorCount; ++i) minimum = std::min(minimum, cursors[i].sequence.load(std::memory_order_acquire));
+    slowest = minimum;
+    return static_cast<std::size_t>(slots.size() - (head - slowest));
+}
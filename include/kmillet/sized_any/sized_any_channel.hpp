@@ -0,0 +1,409 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_channel.hpp
+ * @author Kenan Millet
+ * @brief A bounded channel of `kmillet::sized_any<N>` values that coroutines can `co_await` on.
+ *
+ * This header provides the `kmillet::sized_any_channel<N>` class template.
+ * - Buffered values are held in a ring of `kmillet::sized_any<N>` slots that is allocated once, at construction.
+ * - A sender that finds a waiting receiver hands its value directly to that receiver without going through the ring.
+ * - `try_receive` drains up to a batch of buffered values at once without suspending.
+ * - Waiting senders and receivers are kept in intrusive lists inside their awaiters, so suspending never allocates.
+ *
+ * Waiters are resumed by the thread that unblocks them, after the channel's lock has been released. A waiter unblocked from within
+ * the resumption of another is queued, and resumed once that resumption returns, so that a chain of coroutines unblocking each other
+ * runs in a loop on the thread that started it instead of nesting on its stack.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any_channel<32> channel(64); // buffers up to 64 values
+ * // in a producer coroutine:
+ * co_await channel.send(42);
+ * // in a consumer coroutine:
+ * kmillet::sized_any<32> value = co_await channel.receive(); // empty if the channel was closed
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <coroutine> // for coroutine_handle
+#include <mutex>     // for mutex, lock_guard, unique_lock
+#include <span>
+#include <utility>   // for move, exchange
+#include <vector>
+#include <cstddef>   // for size_t
+
+// Private utilities for kmillet::sized_any_channel
+namespace kmillet::details::sized_any_channel
+{
+    // A suspended coroutine waiting on a channel.
+    struct waiter
+    {
+        std::coroutine_handle<> waiting;
+        waiter* ready = nullptr;
+    };
+
+    // Waiters unblocked on this thread while it is already resuming one, in the order in which they were unblocked.
+    struct ready_queue
+    {
+        waiter* first = nullptr;
+        waiter* last = nullptr;
+        bool resuming = false;
+    };
+    inline thread_local ready_queue queue;
+
+    // Resumes `w` now if this thread is not already resuming a waiter, and queues it for the outermost resumption otherwise.
+    void resume(waiter& w);
+}
+
+namespace kmillet
+{
+    /**
+     * @brief A bounded, thread-safe channel of `kmillet::sized_any<N, Dispatch>` values with awaitable `send` and `receive` operations.
+     * @tparam N The size of the buffer of each `kmillet::sized_any` slot.
+     * @tparam Dispatch The dispatch policy of the transported `kmillet::sized_any` values.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch>
+    class sized_any_channel
+    {
+    public:
+        /**
+         * @brief The type of the values transported by the channel.
+         */
+        using value_type = sized_any<N, Dispatch>;
+
+        class send_awaiter;
+        class receive_awaiter;
+
+        /**
+         * @brief Constructs an open channel that buffers up to `capacity` values.
+         * @param capacity The number of values that can be buffered. If `0`, every send waits for a receiver.
+         */
+        explicit sized_any_channel(std::size_t capacity);
+        sized_any_channel(const sized_any_channel&) = delete;
+        sized_any_channel& operator=(const sized_any_channel&) = delete;
+
+        /**
+         * @brief Sends `value` through the channel.
+         * @param value The value to send.
+         * @return An awaiter that completes once the value has been handed to a receiver or buffered.
+         * `co_await`-ing it yields `true` if the value was sent, or `false` if the channel was closed.
+         */
+        [[nodiscard]] send_awaiter send(value_type value) noexcept;
+        /**
+         * @brief Receives a value from the channel.
+         * @return An awaiter that completes once a value is available.
+         * `co_await`-ing it yields the received value, or an empty value if the channel is closed and drained.
+         */
+        [[nodiscard]] receive_awaiter receive() noexcept;
+
+        /**
+         * @brief Sends `value` without suspending.
+         * @param value The value to send. Left untouched if the value could not be sent.
+         * @return `true` if the value was handed to a waiting receiver or buffered, otherwise `false`.
+         */
+        bool try_send(value_type& value);
+        /**
+         * @brief Receives up to `out.size()` values without suspending.
+         * @param out The slots that the received values are moved into.
+         * @return The number of values received.
+         */
+        std::size_t try_receive(std::span<value_type> out);
+
+        /**
+         * @brief Closes the channel.
+         * @details Waiting senders complete with `false`. Buffered values can still be received; once drained,
+         * receivers complete with an empty value.
+         */
+        void close();
+        /**
+         * @brief Checks whether the channel has been closed.
+         * @returns `true` if and only if `close()` has been called.
+         */
+        [[nodiscard]] bool closed() const;
+
+    private:
+        void Push(value_type& value) noexcept;
+        void Pop(value_type& value) noexcept;
+        // Refills the ring from the first waiting sender, if any, and returns the sender to resume.
+        send_awaiter* Refill() noexcept;
+        template<class Awaiter>
+        static void Resume(Awaiter& awaiter) { details::sized_any_channel::resume(awaiter); }
+
+    // Member variables
+        mutable std::mutex mutex;
+        std::vector<value_type> slots;
+        std::size_t head = 0;
+        std::size_t count = 0;
+        bool isClosed = false;
+        send_awaiter* firstSender = nullptr;
+        send_awaiter* lastSender = nullptr;
+        receive_awaiter* firstReceiver = nullptr;
+        receive_awaiter* lastReceiver = nullptr;
+    };
+
+    /**
+     * @brief The awaiter returned by `kmillet::sized_any_channel<N>::send`.
+     */
+    template<std::size_t N, class Dispatch>
+    class sized_any_channel<N, Dispatch>::send_awaiter : private details::sized_any_channel::waiter
+    {
+    public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() const noexcept { return sent; }
+
+    private:
+        friend class sized_any_channel;
+        send_awaiter(sized_any_channel& channel, value_type&& value) noexcept : channel(channel), value(std::move(value)) {}
+
+    // Member variables
+        sized_any_channel& channel;
+        value_type value;
+        send_awaiter* next = nullptr;
+        bool sent = false;
+    };
+
+    /**
+     * @brief The awaiter returned by `kmillet::sized_any_channel<N>::receive`.
+     */
+    template<std::size_t N, class Dispatch>
+    class sized_any_channel<N, Dispatch>::receive_awaiter : private details::sized_any_channel::waiter
+    {
+    public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        value_type await_resume() noexcept { return std::move(value); }
+
+    private:
+        friend class sized_any_channel;
+        explicit receive_awaiter(sized_any_channel& channel) noexcept : channel(channel) {}
+
+    // Member variables
+        sized_any_channel& channel;
+        value_type value;
+        receive_awaiter* next = nullptr;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+inline void kmillet::details::sized_any_channel::resume(waiter& w)
+{
+    if (queue.resuming)
+    {
+        w.ready = nullptr;
+        if (queue.last) queue.last->ready = &w;
+        else queue.first = &w;
+        queue.last = &w;
+        return;
+    }
+    struct outermost
+    {
+        outermost() noexcept { queue.resuming = true; }
+        ~outermost() { queue.resuming = false; }
+    } guard;
+    w.waiting.resume();
+    while (waiter* next = queue.first)
+    {
+        // Unlink before resuming, since a resumed coroutine may destroy its awaiter.
+        queue.first = next->ready;
+        if (!queue.first) queue.last = nullptr;
+        next->waiting.resume();
+    }
+}
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any_channel<N, Dispatch>::sized_any_channel(std::size_t capacity)
+    : slots(capacity)
+{}
+
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_any_channel<N, Dispatch>::send_awaiter kmillet::sized_any_channel<N, Dispatch>::send(value_type value) noexcept
+{
+    return send_awaiter{*this, std::move(value)};
+}
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_any_channel<N, Dispatch>::receive_awaiter kmillet::sized_any_channel<N, Dispatch>::receive() noexcept
+{
+    return receive_awaiter{*this};
+}
+
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_any_channel<N, Dispatch>::try_send(value_type& value)
+{
+    std::unique_lock lock(mutex);
+    if (isClosed) return false;
+    if (receive_awaiter* receiver = firstReceiver)
+    {
+        firstReceiver = receiver->next;
+        if (!firstReceiver) lastReceiver = nullptr;
+        receiver->value = std::move(value);
+        lock.unlock();
+        Resume(*receiver);
+        return true;
+    }
+    if (count == slots.size()) return false;
+    Push(value);
+    return true;
+}
+template <std::size_t N, class Dispatch>
+inline std::size_t kmillet::sized_any_channel<N, Dispatch>::try_receive(std::span<value_type> out)
+{
+    std::size_t received = 0;
+    // Unblocked senders are chained through their `next` member, which is unused once they leave the waiting list.
+    send_awaiter* unblocked = nullptr;
+    {
+        std::lock_guard lock(mutex);
+        for (; received < out.size(); ++received)
+        {
+            send_awaiter* sender = nullptr;
+            if (count > 0)
+            {
+                Pop(out[received]);
+                sender = Refill();
+            }
+            else if ((sender = firstSender))
+            {
+                firstSender = sender->next;
+                if (!firstSender) lastSender = nullptr;
+                out[received] = std::move(sender->value);
+                sender->sent = true;
+            }
+            else break;
+            if (sender) sender->next = std::exchange(unblocked, sender);
+        }
+    }
+    while (unblocked)
+    {
+        send_awaiter* sender = std::exchange(unblocked, unblocked->next);
+        Resume(*sender);
+    }
+    return received;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_channel<N, Dispatch>::close()
+{
+    send_awaiter* senders;
+    receive_awaiter* receivers;
+    {
+        std::lock_guard lock(mutex);
+        isClosed = true;
+        senders = std::exchange(firstSender, nullptr);
+        receivers = std::exchange(firstReceiver, nullptr);
+        lastSender = nullptr;
+        lastReceiver = nullptr;
+    }
+    // Read `next` before resuming, since a resumed coroutine may destroy its awaiter.
+    while (senders)
+    {
+        send_awaiter* sender = std::exchange(senders, senders->next);
+        Resume(*sender);
+    }
+    while (receivers)
+    {
+        receive_awaiter* receiver = std::exchange(receivers, receivers->next);
+        Resume(*receiver);
+    }
+}
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_any_channel<N, Dispatch>::closed() const
+{
+    std::lock_guard lock(mutex);
+    return isClosed;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_channel<N, Dispatch>::Push(value_type& value) noexcept
+{
+    slots[(head + count) % slots.size()] = std::move(value);
+    ++count;
+}
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_channel<N, Dispatch>::Pop(value_type& value) noexcept
+{
+    value = std::move(slots[head]);
+    head = (head + 1) % slots.size();
+    --count;
+}
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_any_channel<N, Dispatch>::send_awaiter* kmillet::sized_any_channel<N, Dispatch>::Refill() noexcept
+{
+    send_awaiter* sender = firstSender;
+    if (!sender) return nullptr;
+    firstSender = sender->next;
+    if (!firstSender) lastSender = nullptr;
+    Push(sender->value);
+    sender->sent = true;
+    return sender;
+}
+
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_any_channel<N, Dispatch>::send_awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    std::unique_lock lock(channel.mutex);
+    if (channel.isClosed) return false;
+    if (receive_awaiter* receiver = channel.firstReceiver)
+    {
+        channel.firstReceiver = receiver->next;
+        if (!channel.firstReceiver) channel.lastReceiver = nullptr;
+        receiver->value = std::move(value);
+        sent = true;
+        lock.unlock();
+        Resume(*receiver);
+        return false;
+    }
+    if (channel.count < channel.slots.size())
+    {
+        channel.Push(value);
+        sent = true;
+        return false;
+    }
+    waiting = handle;
+    if (channel.lastSender) channel.lastSender->next = this;
+    else channel.firstSender = this;
+    channel.lastSender = this;
+    return true;
+}
+
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_any_channel<N, Dispatch>::receive_awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    std::unique_lock lock(channel.mutex);
+    if (channel.count > 0)
+    {
+        channel.Pop(value);
+        send_awaiter* sender = channel.Refill();
+        lock.unlock();
+        if (sender) Resume(*sender);
+        return false;
+    }
+    if (send_awaiter* sender = channel.firstSender)
+    {
+        channel.firstSender = sender->next;
+        if (!channel.firstSender) channel.lastSender = nullptr;
+        value = std::move(sender->value);
+        sender->sent = true;
+        lock.unlock();
+        Resume(*sender);
+        return false;
+    }
+    if (channel.isClosed) return false;
+    waiting = handle;
+    if (channel.lastReceiver) channel.lastReceiver->next = this;
+    else channel.firstReceiver = this;
+    channel.lastReceiver = this;
+    return true;
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_compaction.hpp
+ * @author Kenan Millet
+ * @brief Restores the memory locality of heap-allocated contents of long-lived `kmillet::sized_any<N>` collections.
+ *
+ * This header provides `kmillet::compact_heap_payloads`.
+ * - A first pass over the range sizes a single arena for every heap-allocated content it holds, and a second pass moves the contents
+ *   into it back to back, in iteration order. The moved-from allocations are released once the whole pass is done.
+ * - Contents placed in an arena are destroyed like any other: the arena is freed once the last of them is, and compacting them again
+ *   moves them into a new arena.
+ * - Heap-allocated contents are allocated with `new` until they are compacted. Only compacted contents are preceded by a pointer to their arena.
+ * - Contents stored in-place are left untouched, as are contents whose type has an alignment of `1` or allocation functions of its own.
+ * - A pass can be bounded to a number of relocations and resumed later from where it stopped, in which case each step fills an arena of its own.
+ *   A bounded pass always relocates at least one content if there is one left, so resuming always makes progress.
+ *
+ * @section Usage
+ * @code
+ * std::vector<kmillet::sized_any<16>> values = ...;
+ * kmillet::compact_heap_payloads(values.begin(), values.end());   // compacts everything at once
+ * // or incrementally, at most 256 relocations at a time:
+ * for (auto it = values.begin(); it != values.end();) it = kmillet::compact_heap_payloads(it, values.end(), 256);
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <algorithm> // for max
+#include <iterator>  // for forward_iterator, iter_value_t
+#include <limits>
+#include <new>       // for align_val_t
+#include <vector>
+#include <cassert>
+#include <cstddef>   // for size_t, byte
+
+// Private utilities for kmillet::compact_heap_payloads
+namespace kmillet::details::sized_any_compaction
+{
+    // Places the contents of a pass one after the other, after the arena header, each just after the pointer to the arena.
+    struct cursor
+    {
+        template<class Info>
+        std::size_t next(const Info* info) noexcept
+        {
+            const std::size_t align = std::max(info->alignment(), alignof(sized_any::arena*));
+            const std::size_t content = (offset + sizeof(sized_any::arena*) + align - 1) / align * align;
+            offset = content + info->size();
+            alignment = std::max(alignment, align);
+            return content;
+        }
+
+        std::size_t offset = sizeof(sized_any::arena);
+        std::size_t alignment = alignof(sized_any::arena);
+    };
+
+    template<class T> struct traits;
+    template<std::size_t N, class Dispatch>
+    struct traits<::kmillet::sized_any<N, Dispatch>>
+    {
+        struct retired
+        {
+            const sized_any::ITypeInfo<Dispatch>* info;
+            void* payload;
+        };
+
+        // Releases the moved-from contents, then the reference of the pass to its arena, when the pass ends, including when a relocation throws.
+        struct retirement
+        {
+            ~retirement()
+            {
+                for (const retired& r : list) sized_any::access::release<N>(r.info, r.payload);
+                if (arena) sized_any::arena::release(arena);
+            }
+
+            std::vector<retired> list;
+            sized_any::arena* arena = nullptr;
+        };
+    };
+}
+
+namespace kmillet
+{
+    /**
+     * @brief Moves the heap-allocated contents of the `kmillet::sized_any<N>` objects in `[first, last)` into a single contiguous arena, in iteration order.
+     * @tparam It A forward iterator whose value type is a specialization of `kmillet::sized_any`.
+     * @param first The beginning of the range.
+     * @param last The end of the range.
+     * @param maxRelocations The maximum number of contents to relocate before stopping, which must not be `0`.
+     * @return The iterator at which the pass stopped, which is `last` if the whole range was compacted.
+     * Passing it as `first` to a later call resumes the pass.
+     * @details The range is traversed twice: once to size the arena, and once to move the contents into it.
+     * The contained objects are moved with their move constructors, so references to them are invalidated.
+     * If a move constructor or the allocation of the arena throws, the exception is propagated and the contents relocated so far stay in the arena.
+     * A `maxRelocations` of `0` would never make progress: it is asserted against, and treated as `1` when assertions are disabled.
+     */
+    template<std::forward_iterator It>
+    requires(details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+    It compact_heap_payloads(It first, It last, std::size_t maxRelocations = std::numeric_limits<std::size_t>::max());
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::forward_iterator It>
+requires(kmillet::details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+inline It kmillet::compact_heap_payloads(It first, It last, std::size_t maxRelocations)
+{
+    using traits = kmillet::details::sized_any_compaction::traits<std::iter_value_t<It>>;
+    using access = kmillet::details::sized_any::access;
+    using arena = kmillet::details::sized_any::arena;
+    assert(maxRelocations > 0 && "a pass bounded to 0 relocations never makes progress");
+    maxRelocations = std::max<std::size_t>(maxRelocations, 1);
+
+    // First pass: find where the pass stops and how large its arena must be.
+    kmillet::details::sized_any_compaction::cursor sizing;
+    std::size_t count = 0;
+    It stop = first;
+    for (; stop != last && count < maxRelocations; ++stop)
+    {
+        if (!access::relocatable(*stop)) continue;
+        sizing.next(access::info(*stop));
+        ++count;
+    }
+    if (count == 0) return stop;
+
+    typename traits::retirement retired;
+    // Reserved before anything is moved, so that recording a moved-from content cannot throw.
+    retired.list.reserve(count);
+    void* block = ::operator new(sizing.offset, std::align_val_t(sizing.alignment));
+    // The pass holds a reference of its own, so that the arena outlives a relocation that throws before any content holds one.
+    retired.arena = ::new (block) arena{{1}, sizing.offset, sizing.alignment};
+
+    // Second pass: move the contents into the arena, in the same order.
+    kmillet::details::sized_any_compaction::cursor placing;
+    for (; first != stop; ++first)
+    {
+        if (!access::relocatable(*first)) continue;
+        const auto* info = access::info(*first);
+        std::byte* content = static_cast<std::byte*>(block) + placing.next(info);
+        void* old = access::relocate(*first, content, retired.arena);
+        retired.arena->references.fetch_add(1, std::memory_order_relaxed);
+        retired.list.push_back({info, old});
+    }
+    return stop;
+}
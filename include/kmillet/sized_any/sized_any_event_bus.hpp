@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_event_bus.hpp
+ * @author Kenan Millet
+ * @brief A publish/subscribe event bus that routes `kmillet::sized_any<N>` events by the type of their contents.
+ *
+ * This header provides the `kmillet::sized_any_event_bus<N>` class template.
+ * - Subscriptions are indexed by the type information of their payload type, so publishing an event looks up the
+ *   interested subscribers in O(1) and invokes only them, with a typed reference to the payload.
+ * - The subscriber table is copy-on-write: subscribing and unsubscribing build a new table under a mutex and then publish it through
+ *   an atomic pointer, while publishers enter an epoch (see `kmillet/sized_any/epoch.hpp`) and load the current one. Publishing takes
+ *   no lock and never waits, neither for writers nor for other publishers. A replaced table is destroyed once no publication can still use it.
+ * - Handlers are invoked through a `const` reference, since several threads may publish at once: a handler that changes state
+ *   must synchronize it itself, for instance through an atomic or a captured mutex.
+ * - Events can also be posted for deferred delivery and delivered in batches by `flush()`.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any_event_bus<32> bus;
+ * auto id = bus.subscribe<int>([](const int& value) { std::cout << value; });
+ * bus.publish(kmillet::sized_any<32>(42)); // prints 42
+ * bus.post(7);                             // queued
+ * bus.flush();                             // prints 7
+ * bus.unsubscribe(id);
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+#include <kmillet/sized_any/epoch.hpp>
+
+#include <atomic>
+#include <concepts>      // for invocable
+#include <memory>        // for shared_ptr, make_shared, make_unique, unique_ptr
+#include <mutex>         // for mutex, lock_guard
+#include <type_traits>   // for decay_t
+#include <unordered_map>
+#include <utility>       // for forward, move
+#include <vector>
+#include <cstddef>       // for size_t
+
+namespace kmillet
+{
+    /**
+     * @brief A publish/subscribe event bus for `kmillet::sized_any<N, Dispatch>` events, indexed by payload type.
+     * @tparam N The size of the buffer of the `kmillet::sized_any` events.
+     * @tparam Dispatch The dispatch policy of the `kmillet::sized_any` events.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch>
+    class sized_any_event_bus
+    {
+    public:
+        /**
+         * @brief The type of the events published through the bus.
+         */
+        using value_type = sized_any<N, Dispatch>;
+        /**
+         * @brief Identifies a subscription so that it can be removed.
+         */
+        using subscription = std::size_t;
+
+        /**
+         * @brief Constructs a bus without subscribers.
+         */
+        sized_any_event_bus();
+        /**
+         * @brief Destroys the bus, which must not be accessed concurrently.
+         */
+        ~sized_any_event_bus();
+        sized_any_event_bus(const sized_any_event_bus&) = delete;
+        sized_any_event_bus& operator=(const sized_any_event_bus&) = delete;
+
+        /**
+         * @brief Subscribes `handler` to events whose contents are of type `T`.
+         * @tparam T The payload type of the events to be handled.
+         * @tparam F The type of the handler.
+         * @param handler The handler, invoked through a `const` reference with a `const T&` referring to the payload of each matching event.
+         * @return The identifier of the new subscription.
+         * @details Handlers of the same type are invoked in subscription order. A handler may be invoked by several publishing threads at once.
+         */
+        template<class T, class F>
+        requires(std::invocable<const std::decay_t<F>&, const T&>)
+        subscription subscribe(F&& handler);
+        /**
+         * @brief Removes a subscription.
+         * @param id The identifier returned by `subscribe`.
+         * @return `true` if the subscription existed, otherwise `false`.
+         * @details A publication that is already in progress may still invoke the removed handler.
+         */
+        bool unsubscribe(subscription id);
+
+        /**
+         * @brief Delivers `event` to every handler subscribed to the type of its contents.
+         * @param event The event to be delivered. Empty events are not delivered.
+         * @return The number of handlers that were invoked.
+         * @details Takes no lock. Tables replaced during the call are not destroyed until it returns, so handlers should not block for long.
+         */
+        std::size_t publish(const value_type& event) const;
+        /**
+         * @brief Delivers `event` to every handler subscribed to `T` without wrapping it in a `kmillet::sized_any`.
+         * @tparam T The type of the event.
+         * @param event The event to be delivered.
+         * @return The number of handlers that were invoked.
+         */
+        template<class T>
+        requires(!details::sized_any::is_sized_any<std::decay_t<T>>::value)
+        std::size_t publish(const T& event) const;
+
+        /**
+         * @brief Queues `event` to be delivered by the next call to `flush()`.
+         * @param event The event to be queued.
+         */
+        void post(value_type event);
+        /**
+         * @brief Delivers every queued event, in the order in which they were posted.
+         * @return The number of events delivered.
+         * @details Events posted by handlers during the flush are delivered by the next call to `flush()`.
+         */
+        std::size_t flush();
+
+    private:
+        struct subscriber
+        {
+            subscription id;
+            std::shared_ptr<const void> handler;
+            void (*invoke)(const void* handler, const void* payload);
+        };
+        using table = std::unordered_map<const void*, std::vector<subscriber>>;
+
+        template<class T>
+        static const void* Key() noexcept;
+        template<class T, class F>
+        static void Invoke(const void* handler, const void* payload);
+        std::size_t Publish(const void* key, const void* payload) const;
+        void Store(std::unique_ptr<const table> updated);
+
+    // Member variables
+        std::atomic<const table*> subscribers; // only loaded inside an epoch
+        std::mutex writeMutex;
+        kmillet::details::epoch::retired_list retired; // guarded by writeMutex
+        subscription nextId = 0;
+        std::mutex pendingMutex;
+        std::vector<value_type> pending;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any_event_bus<N, Dispatch>::sized_any_event_bus()
+    : subscribers(new table())
+{}
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any_event_bus<N, Dispatch>::~sized_any_event_bus()
+{
+    delete subscribers.load(std::memory_order_relaxed);
+}
+
+template <std::size_t N, class Dispatch>
+template <class T, class F>
+requires(std::invocable<const std::decay_t<F>&, const T&>)
+inline typename kmillet::sized_any_event_bus<N, Dispatch>::subscription kmillet::sized_any_event_bus<N, Dispatch>::subscribe(F&& handler)
+{
+    subscriber entry{0, std::make_shared<const std::decay_t<F>>(std::forward<F>(handler)), &Invoke<std::decay_t<T>, std::decay_t<F>>};
+    std::lock_guard lock(writeMutex);
+    const subscription id = entry.id = nextId++;
+    auto updated = std::make_unique<table>(*subscribers.load(std::memory_order_relaxed));
+    (*updated)[Key<T>()].push_back(std::move(entry));
+    Store(std::move(updated));
+    return id;
+}
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_any_event_bus<N, Dispatch>::unsubscribe(subscription id)
+{
+    std::lock_guard lock(writeMutex);
+    const table* current = subscribers.load(std::memory_order_relaxed);
+    for (const auto& [key, entries] : *current)
+    {
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            if (entries[i].id != id) continue;
+            auto updated = std::make_unique<table>(*current);
+            auto& list = (*updated)[key];
+            list.erase(list.begin() + i);
+            if (list.empty()) updated->erase(key);
+            Store(std::move(updated));
+            return true;
+        }
+    }
+    return false;
+}
+
+template <std::size_t N, class Dispatch>
+inline std::size_t kmillet::sized_any_event_bus<N, Dispatch>::publish(const value_type& event) const
+{
+    if (!event.has_value()) return 0;
+    return Publish(kmillet::details::sized_any::access::info(event), kmillet::details::sized_any::access::data(event));
+}
+template <std::size_t N, class Dispatch>
+template <class T>
+requires(!kmillet::details::sized_any::is_sized_any<std::decay_t<T>>::value)
+inline std::size_t kmillet::sized_any_event_bus<N, Dispatch>::publish(const T& event) const
+{
+    return Publish(Key<T>(), &event);
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_event_bus<N, Dispatch>::post(value_type event)
+{
+    std::lock_guard lock(pendingMutex);
+    pending.push_back(std::move(event));
+}
+template <std::size_t N, class Dispatch>
+inline std::size_t kmillet::sized_any_event_bus<N, Dispatch>::flush()
+{
+    std::vector<value_type> batch;
+    {
+        std::lock_guard lock(pendingMutex);
+        batch.swap(pending);
+    }
+    for (const auto& event : batch) publish(event);
+    const std::size_t delivered = batch.size();
+    // Hand the batch's storage back so that steady-state posting does not allocate.
+    batch.clear();
+    {
+        std::lock_guard lock(pendingMutex);
+        if (pending.empty()) pending.swap(batch);
+    }
+    return delivered;
+}
+
+template <std::size_t N, class Dispatch>
+template <class T>
+inline const void* kmillet::sized_any_event_bus<N, Dispatch>::Key() noexcept
+{
+    const kmillet::details::sized_any::ITypeInfo<Dispatch>* info = &(kmillet::details::sized_any::info<std::decay_t<T>, Dispatch>);
+    return info;
+}
+template <std::size_t N, class Dispatch>
+template <class T, class F>
+inline void kmillet::sized_any_event_bus<N, Dispatch>::Invoke(const void* handler, const void* payload)
+{
+    (*static_cast<const F*>(handler))(*static_cast<const T*>(payload));
+}
+template <std::size_t N, class Dispatch>
+inline std::size_t kmillet::sized_any_event_bus<N, Dispatch>::Publish(const void* key, const void* payload) const
+{
+    // Handlers may subscribe or unsubscribe, which retires the table without waiting for this publication to end.
+    kmillet::details::epoch::guard pin;
+    const table* current = subscribers.load();
+    auto it = current->find(key);
+    if (it == current->end()) return 0;
+    for (const auto& entry : it->second) entry.invoke(entry.handler.get(), payload);
+    return it->second.size();
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_event_bus<N, Dispatch>::Store(std::unique_ptr<const table> updated)
+{
+    // Must be called with the write mutex held. Nothing can throw once the new table is published.
+    retired.reserve();
+    retired.retire(subscribers.exchange(updated.release()));
+    retired.reclaim();
+}
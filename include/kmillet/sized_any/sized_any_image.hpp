@@ -0,0 +1,364 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_image.hpp
+ * @author Kenan Millet
+ * @brief A relocatable, pointer-free image of a range of `kmillet::sized_any<N>` objects, usable in place after being mapped from a file.
+ *
+ * This header provides the `kmillet::make_sized_any_image<TypeList>` function template and the `kmillet::sized_any_image<TypeList>` class template.
+ * - `kmillet::make_sized_any_image` lays out the trivially copyable contents of a range of `kmillet::sized_any<N>` in a single block of bytes,
+ *   wherever they were stored (in-place or on the heap). Contents are found through offsets from the beginning of the block instead of
+ *   pointers, and their types are recorded by their index in a `kmillet::type_list`, so the block may be written to a file as is.
+ * - `kmillet::sized_any_image` reads such a block in place, for instance after it has been mapped into memory with `mmap`, without
+ *   deserializing or copying it. Opening an image only checks its header, and each object is checked when it is accessed.
+ * - Types may be appended to the list without invalidating existing images, but not reordered. The stable identifier, size and alignment
+ *   of each type are recorded in the image and checked when it is opened. Identifiers are supplied by `kmillet::sized_any_image_id<T>`,
+ *   either through a `static constexpr std::uint64_t sized_any_image_id` member of `T` or a specialization of the trait. Fundamental types
+ *   and `std::byte` have built-in identifiers, and a list with a type that has none is rejected at compile time.
+ *   The image is in the byte order of the host, so both ends must run on the same ABI.
+ *
+ * @section Usage
+ * @code
+ * struct limits { static constexpr std::uint64_t sized_any_image_id = 0x6C696D6974730001; std::int32_t id; double bounds[4]; };
+ * using settings = kmillet::type_list<std::int64_t, double, limits>;
+ * std::optional<std::vector<std::byte>> bytes = kmillet::make_sized_any_image<settings>(values.begin(), values.end());
+ * // ... write *bytes to a file, then on restart map the file into memory ...
+ * auto image = kmillet::sized_any_image<settings>::open({static_cast<const std::byte*>(mapped), length});
+ * const limits* l = image->get<limits>(42);                 // points into the mapping, or nullptr if object 42 is not a limits
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+#include <kmillet/sized_any/sized_any_visit.hpp> // for type_list
+
+#include <algorithm>   // for max
+#include <array>
+#include <concepts>    // for convertible_to
+#include <cstdint>     // for uint16_t, uint32_t, uint64_t, uintptr_t
+#include <cstring>     // for memcpy
+#include <iterator>    // for forward_iterator, iter_value_t, distance
+#include <optional>
+#include <span>
+#include <type_traits> // for is_trivially_copyable_v, is_same_v, is_arithmetic_v, is_floating_point_v, is_signed_v, integral_constant
+#include <utility>     // for in_place_type
+#include <vector>
+#include <cstddef>     // for size_t, byte
+
+// Private utilities for kmillet::sized_any_image_id
+namespace kmillet::details::sized_any_image
+{
+    // The built-in identifiers have "KSAI" in their upper half, and the kind and the size of the type in their lower half.
+    // Types of the same kind and size, such as `long` and `long long` on some platforms, are laid out alike and may be read as one another.
+    template<class T>
+    constexpr std::uint64_t builtin_id() noexcept
+    {
+        std::uint64_t kind;
+        if constexpr (std::is_same_v<T, bool>) kind = 1;
+        else if constexpr (std::is_same_v<T, std::byte>) kind = 2;
+        else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, wchar_t> || std::is_same_v<T, char8_t>
+                        || std::is_same_v<T, char16_t> || std::is_same_v<T, char32_t>) kind = 3;
+        else if constexpr (std::is_floating_point_v<T>) kind = 4;
+        else if constexpr (std::is_signed_v<T>) kind = 5;
+        else kind = 6;
+        return (std::uint64_t{0x4B534149} << 32) | (kind << 8) | sizeof(T);
+    }
+}
+
+namespace kmillet
+{
+    /**
+     * @brief The stable identifier of `T` recorded in images, which is checked when they are opened, so that an image is not read
+     *        with a list whose types differ from the ones it was made with but happen to have the same sizes and alignments.
+     * @tparam T The type.
+     * @details The identifier is `T::sized_any_image_id` if `T` has such a member. Fundamental types and `std::byte` have built-in identifiers,
+     * whose upper 32 bits are `0x4B534149`, which other identifiers should avoid. Specialize this trait to identify other types that
+     * cannot be given a member, such as enumerations or third-party types. Other types have no identifier and cannot be stored in images.
+     * Identifiers must never change once images exist.
+     */
+    template<class T> struct sized_any_image_id {};
+    template<class T>
+    requires(requires { { T::sized_any_image_id } -> std::convertible_to<std::uint64_t>; })
+    struct sized_any_image_id<T> : std::integral_constant<std::uint64_t, T::sized_any_image_id> {};
+    template<class T>
+    requires(std::is_arithmetic_v<T> || std::is_same_v<T, std::byte>)
+    struct sized_any_image_id<T> : std::integral_constant<std::uint64_t, details::sized_any_image::builtin_id<T>()> {};
+}
+
+// Private utilities for kmillet::make_sized_any_image and kmillet::sized_any_image
+namespace kmillet::details::sized_any_image
+{
+    inline constexpr std::uint32_t magic = 0x4941534B;  // "KSAI" in little-endian order
+    inline constexpr std::uint16_t format = 3;
+    inline constexpr std::uint16_t empty = 0xFFFF;
+
+    struct header
+    {
+        std::uint32_t magic;
+        std::uint16_t format;
+        std::uint16_t types;    // the number of entries of the type table
+        std::uint64_t count;    // the number of records
+        std::uint64_t records;  // the offset of the record table
+        std::uint64_t size;     // the size of the whole image
+    };
+    struct type_entry
+    {
+        std::uint64_t id;       // the value of `kmillet::sized_any_image_id` for the type
+        std::uint32_t size;
+        std::uint32_t alignment;
+    };
+    struct record
+    {
+        std::uint64_t offset;   // the offset of the contents, or 0 if the object is empty
+        std::uint16_t tag;      // the index of the type in the list, or `empty`
+        std::uint16_t reserved[3];
+    };
+
+    template<class TypeList> struct image_list;
+    template<class... Ts>
+    struct image_list<::kmillet::type_list<Ts...>>
+    {
+        static_assert((std::is_trivially_copyable_v<Ts> && ...), "Only trivially copyable contents can be stored in an image.");
+        static_assert(sizeof...(Ts) < empty, "Too many types to be tagged in an image.");
+        static_assert((requires { { ::kmillet::sized_any_image_id<Ts>::value } -> std::convertible_to<std::uint64_t>; } && ...),
+                      "Every type stored in an image needs a kmillet::sized_any_image_id.");
+
+        static constexpr std::array<type_entry, sizeof...(Ts)> types{type_entry{::kmillet::sized_any_image_id<Ts>::value, sizeof(Ts), alignof(Ts)}...};
+        static constexpr std::size_t alignment = std::max({alignof(record), alignof(Ts)...});
+
+        template<class T, std::size_t N, class Dispatch>
+        static const void* Address(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept { return &sized_any::access::unchecked<T>(operand); }
+
+        // Gets the address of the contents of `operand`, whose contained type is the one at `index` in the list.
+        template<std::size_t N, class Dispatch>
+        static const void* address(const ::kmillet::sized_any<N, Dispatch>& operand, std::size_t index) noexcept
+        {
+            static constexpr std::array<const void* (*)(const ::kmillet::sized_any<N, Dispatch>&) noexcept, sizeof...(Ts)> table{&Address<Ts, N, Dispatch>...};
+            return table[index](operand);
+        }
+
+        template<class T, std::size_t N, class Dispatch>
+        static ::kmillet::sized_any<N, Dispatch> Load(const void* contents)
+        {
+            return ::kmillet::sized_any<N, Dispatch>(std::in_place_type<T>, *static_cast<const T*>(contents));
+        }
+
+        // Copies the contents at `contents`, of the type at `index` in the list, into a new object.
+        template<std::size_t N, class Dispatch>
+        static ::kmillet::sized_any<N, Dispatch> load(std::size_t index, const void* contents)
+        {
+            static constexpr std::array<::kmillet::sized_any<N, Dispatch> (*)(const void*), sizeof...(Ts)> table{&Load<Ts, N, Dispatch>...};
+            return table[index](contents);
+        }
+
+        // The index of `T` in the list, or the size of the list if it is not in it.
+        template<class T>
+        static constexpr std::size_t index_of = []
+        {
+            constexpr std::array<bool, sizeof...(Ts)> matches{std::is_same_v<T, Ts>...};
+            for (std::size_t i = 0; i < matches.size(); ++i)
+            {
+                if (matches[i]) return i;
+            }
+            return matches.size();
+        }();
+    };
+
+    constexpr std::size_t align_up(std::size_t offset, std::size_t alignment) noexcept
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+namespace kmillet
+{
+    /**
+     * @brief Lays out the contents of the objects in `[first, last)` in an image that may be read by `kmillet::sized_any_image<TypeList>`.
+     * @tparam TypeList A `kmillet::type_list` of the trivially copyable types that may be stored.
+     * @tparam It A forward iterator whose value type is a specialization of `kmillet::sized_any`.
+     * @param first The beginning of the range.
+     * @param last The end of the range.
+     * @return The bytes of the image, or an empty `std::optional` if an object holds a type that is not in `TypeList`.
+     * @details The bytes are only aligned to `__STDCPP_DEFAULT_NEW_ALIGNMENT__`, see `kmillet::sized_any_image<TypeList>::alignment`.
+     */
+    template<class TypeList, std::forward_iterator It>
+    requires(details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+    [[nodiscard]] std::optional<std::vector<std::byte>> make_sized_any_image(It first, It last);
+
+    /**
+     * @brief A read-only view of an image made by `kmillet::make_sized_any_image<TypeList>`, whose contents are accessed in place.
+     * @tparam TypeList A `kmillet::type_list` of the trivially copyable types that may be stored. It must begin with the list the image was made with.
+     */
+    template<class TypeList>
+    class sized_any_image
+    {
+    public:
+        /**
+         * @brief The alignment that the bytes of an image must have, which `mmap` always provides.
+         * @details `operator new`, and so the `std::vector<std::byte>` returned by `kmillet::make_sized_any_image`, only provides it
+         * if it does not exceed `__STDCPP_DEFAULT_NEW_ALIGNMENT__`. Otherwise the bytes must be copied to suitably aligned storage before being opened.
+         */
+        static constexpr std::size_t alignment = details::sized_any_image::image_list<TypeList>::alignment;
+
+        /**
+         * @brief Opens an image.
+         * @param bytes The bytes of the image, which must outlive the view and all pointers obtained from it.
+         * @return A view of the image, or an empty `std::optional` if `bytes` are misaligned or truncated, or were not made with a prefix of `TypeList`,
+         * as told by the identifiers, sizes and alignments of its types.
+         * @details Only the header and the type table are read, so opening an image takes constant time.
+         */
+        [[nodiscard]] static std::optional<sized_any_image> open(std::span<const std::byte> bytes) noexcept;
+
+        /**
+         * @brief Gets the number of objects of the image.
+         * @return The number of objects.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return count; }
+        /**
+         * @brief Gets the index in `TypeList` of the type of an object.
+         * @param index The index of the object, which must be less than `size()`.
+         * @return The index of its type, or `TypeList`'s size if it is empty or corrupted.
+         */
+        [[nodiscard]] std::size_t index(std::size_t index) const noexcept;
+        /**
+         * @brief Gets the contents of an object, if it holds a `T`.
+         * @tparam T The expected type of the contents.
+         * @param index The index of the object, which must be less than `size()`.
+         * @return A pointer into the image, or `nullptr` if the object does not hold a `T`.
+         */
+        template<class T>
+        [[nodiscard]] const T* get(std::size_t index) const noexcept;
+        /**
+         * @brief Copies an object out of the image.
+         * @tparam N The size of the buffer of the copy.
+         * @tparam Dispatch The dispatch policy of the copy.
+         * @param index The index of the object, which must be less than `size()`.
+         * @return A copy of the object, which is empty if the object is empty or corrupted.
+         */
+        template<std::size_t N, class Dispatch = default_dispatch>
+        [[nodiscard]] sized_any<N, Dispatch> load(std::size_t index) const;
+
+    private:
+        using list = details::sized_any_image::image_list<TypeList>;
+        using record = details::sized_any_image::record;
+
+        sized_any_image(std::span<const std::byte> bytes, std::size_t types, const record* records, std::size_t count) noexcept
+            : bytes(bytes), types(types), records(records), count(count)
+        {}
+        const void* Contents(std::size_t index) const noexcept;
+
+    // Member variables
+        std::span<const std::byte> bytes;
+        std::size_t types; // the number of types the image was made with, which may be less than `TypeList`'s
+        const record* records;
+        std::size_t count;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class TypeList, std::forward_iterator It>
+requires(kmillet::details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+inline std::optional<std::vector<std::byte>> kmillet::make_sized_any_image(It first, It last)
+{
+    namespace image = kmillet::details::sized_any_image;
+    using list = image::image_list<TypeList>;
+    using traits = kmillet::details::sized_any_visit::list_traits<TypeList>;
+    const auto count = static_cast<std::size_t>(std::distance(first, last));
+
+    // The first pass only computes the layout, so that the image is allocated once.
+    std::vector<image::record> records(count, image::record{0, image::empty, {}});
+    const std::size_t recordsOffset = image::align_up(sizeof(image::header) + list::types.size() * sizeof(image::type_entry), alignof(image::record));
+    std::size_t size = recordsOffset + count * sizeof(image::record);
+    std::size_t i = 0;
+    for (It it = first; it != last; ++it, ++i)
+    {
+        const std::size_t index = traits::index(*it);
+        if (index >= traits::size)
+        {
+            if (it->has_value()) return std::nullopt;
+            continue;
+        }
+        size = image::align_up(size, list::types[index].alignment);
+        records[i] = {size, static_cast<std::uint16_t>(index), {}};
+        size += list::types[index].size;
+    }
+
+    std::vector<std::byte> bytes(size);
+    const image::header h{image::magic, image::format, static_cast<std::uint16_t>(list::types.size()), count, recordsOffset, size};
+    std::memcpy(bytes.data(), &h, sizeof(h));
+    std::memcpy(bytes.data() + sizeof(h), list::types.data(), list::types.size() * sizeof(image::type_entry));
+    std::memcpy(bytes.data() + recordsOffset, records.data(), count * sizeof(image::record));
+    i = 0;
+    for (It it = first; it != last; ++it, ++i)
+    {
+        if (records[i].tag == image::empty) continue;
+        std::memcpy(bytes.data() + records[i].offset, list::address(*it, records[i].tag), list::types[records[i].tag].size);
+    }
+    return bytes;
+}
+
+template <class TypeList>
+inline std::optional<kmillet::sized_any_image<TypeList>> kmillet::sized_any_image<TypeList>::open(std::span<const std::byte> bytes) noexcept
+{
+    namespace image = kmillet::details::sized_any_image;
+    if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignment != 0 || bytes.size() < sizeof(image::header)) return std::nullopt;
+    image::header h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if (h.magic != image::magic || h.format != image::format || h.size != bytes.size() || h.types > list::types.size()) return std::nullopt;
+    if (sizeof(h) + h.types * sizeof(image::type_entry) > h.records || h.records % alignof(record) != 0) return std::nullopt;
+    if (h.records > h.size || h.count > (h.size - h.records) / sizeof(record)) return std::nullopt;
+    for (std::size_t i = 0; i < h.types; ++i)
+    {
+        image::type_entry t;
+        std::memcpy(&t, bytes.data() + sizeof(h) + i * sizeof(t), sizeof(t));
+        if (t.id != list::types[i].id || t.size != list::types[i].size || t.alignment != list::types[i].alignment) return std::nullopt;
+    }
+    return sized_any_image(bytes, h.types, reinterpret_cast<const record*>(bytes.data() + h.records), static_cast<std::size_t>(h.count));
+}
+
+template <class TypeList>
+inline std::size_t kmillet::sized_any_image<TypeList>::index(std::size_t index) const noexcept
+{
+    return Contents(index) ? records[index].tag : list::types.size();
+}
+
+template <class TypeList>
+template <class T>
+inline const T* kmillet::sized_any_image<TypeList>::get(std::size_t index) const noexcept
+{
+    constexpr std::size_t tag = list::template index_of<T>;
+    static_assert(tag < list::types.size(), "T is not in TypeList.");
+    if (records[index].tag != tag) return nullptr;
+    return static_cast<const T*>(Contents(index));
+}
+
+template <class TypeList>
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any<N, Dispatch> kmillet::sized_any_image<TypeList>::load(std::size_t index) const
+{
+    const void* contents = Contents(index);
+    if (!contents) return {};
+    return list::template load<N, Dispatch>(records[index].tag, contents);
+}
+
+template <class TypeList>
+inline const void* kmillet::sized_any_image<TypeList>::Contents(std::size_t index) const noexcept
+{
+    // Records are checked when they are accessed rather than when the image is opened, so that opening takes constant time.
+    const record& r = records[index];
+    // Tags past the types of the image are corrupted, even if `TypeList` has more types.
+    if (r.tag >= types) return nullptr;
+    const auto& type = list::types[r.tag];
+    if (r.offset % type.alignment != 0 || r.offset > bytes.size() || bytes.size() - r.offset < type.size) return nullptr;
+    return bytes.data() + r.offset;
+}
@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_iovec.hpp
+ * @author Kenan Millet
+ * @brief Scatter/gather I/O of trivially copyable contents of `kmillet::sized_any<N>` ranges, without intermediate copies.
+ *
+ * This header provides the `kmillet::sized_any_gather<TypeList>` and `kmillet::sized_any_scatter<TypeList>` class templates.
+ * - `kmillet::sized_any_gather` builds an array of `iovec` over a block of type tags followed by the contents of a range of
+ *   `kmillet::sized_any<N>`, wherever they are stored (in-place or on the heap), ready to be passed to `writev` or an io_uring submission.
+ * - `kmillet::sized_any_scatter` is its mirror: once the type tags have been read, it constructs the tagged types in a range of
+ *   `kmillet::sized_any<N>` slots and builds an array of `iovec` over their contents, ready to be passed to `readv`.
+ * - Type tags are the indices of the types in a `kmillet::type_list`, stored as `kmillet::sized_any_io_tag`. An empty object is
+ *   tagged `kmillet::sized_any_io_empty` and has no contents. Tags and contents are in the byte order of the host, and contents are
+ *   not padded, so both ends must agree on the list of types and run on the same ABI.
+ * - Contents that happen to be adjacent in memory share a single `iovec`.
+ *
+ * On platforms without `<sys/uio.h>`, `kmillet::sized_any_iovec` is a structure with the same members as `iovec`.
+ *
+ * @section Usage
+ * @code
+ * using telemetry = kmillet::type_list<std::int64_t, double, sample>;
+ * kmillet::sized_any_gather<telemetry> out;
+ * if (out.assign(values.begin(), values.end())) writev(fd, out.buffers().data(), static_cast<int>(out.buffers().size()));
+ *
+ * kmillet::sized_any_scatter<telemetry> in;
+ * readv(fd, &in.header(slots.size()), 1);
+ * if (in.assign(slots.begin(), slots.end())) readv(fd, in.buffers().data(), static_cast<int>(in.buffers().size()));
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+#include <kmillet/sized_any/sized_any_visit.hpp> // for type_list
+
+#include <array>
+#include <cstdint>     // for uint16_t
+#include <iterator>    // for forward_iterator, iter_value_t, distance
+#include <span>
+#include <type_traits> // for is_trivially_copyable_v
+#include <vector>
+#include <cstddef>     // for size_t, byte
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>   // for iovec
+#endif
+
+namespace kmillet
+{
+#if __has_include(<sys/uio.h>)
+    /**
+     * @brief The buffer descriptor of scatter/gather I/O.
+     */
+    using sized_any_iovec = ::iovec;
+#else
+    /**
+     * @brief The buffer descriptor of scatter/gather I/O, with the same members as the POSIX `iovec`.
+     */
+    struct sized_any_iovec
+    {
+        void* iov_base;
+        std::size_t iov_len;
+    };
+#endif
+
+    /**
+     * @brief The type of the tags that precede the contents in scatter/gather I/O.
+     */
+    using sized_any_io_tag = std::uint16_t;
+    /**
+     * @brief The tag of an empty object.
+     */
+    inline constexpr sized_any_io_tag sized_any_io_empty = 0xFFFF;
+}
+
+// Private utilities for kmillet::sized_any_gather and kmillet::sized_any_scatter
+namespace kmillet::details::sized_any_iovec
+{
+    template<class TypeList> struct io_list;
+    template<class... Ts>
+    struct io_list<::kmillet::type_list<Ts...>>
+    {
+        static_assert((std::is_trivially_copyable_v<Ts> && ...), "Only trivially copyable contents can be written and read as bytes.");
+        static_assert(sizeof...(Ts) < ::kmillet::sized_any_io_empty, "Too many types to be tagged by kmillet::sized_any_io_tag.");
+
+        static constexpr std::array<std::size_t, sizeof...(Ts)> sizes{sizeof(Ts)...};
+
+        template<class T, std::size_t N, class Dispatch>
+        static void* Address(::kmillet::sized_any<N, Dispatch>& operand) noexcept { return &sized_any::access::unchecked<T>(operand); }
+        template<class T, std::size_t N, class Dispatch>
+        static void Emplace(::kmillet::sized_any<N, Dispatch>& operand)
+        {
+            if (sized_any::access::info(operand) != &(sized_any::info<T, Dispatch>)) operand.template emplace<T>();
+        }
+
+        // Gets the address of the contents of `operand`, whose contained type is the one at `index` in the list.
+        template<std::size_t N, class Dispatch>
+        static void* address(::kmillet::sized_any<N, Dispatch>& operand, std::size_t index) noexcept
+        {
+            static constexpr std::array<void* (*)(::kmillet::sized_any<N, Dispatch>&) noexcept, sizeof...(Ts)> table{&Address<Ts, N, Dispatch>...};
+            return table[index](operand);
+        }
+        // Makes `operand` hold the type at `index` in the list, reusing its contents if it already does.
+        template<std::size_t N, class Dispatch>
+        static void emplace(::kmillet::sized_any<N, Dispatch>& operand, std::size_t index)
+        {
+            static constexpr std::array<void (*)(::kmillet::sized_any<N, Dispatch>&), sizeof...(Ts)> table{&Emplace<Ts, N, Dispatch>...};
+            table[index](operand);
+        }
+    };
+
+    // Appends a buffer to `iov`, extending the last one instead if they are adjacent.
+    inline void append(std::vector<::kmillet::sized_any_iovec>& iov, void* base, std::size_t size)
+    {
+        if (size == 0) return;
+        if (!iov.empty() && static_cast<std::byte*>(iov.back().iov_base) + iov.back().iov_len == base) iov.back().iov_len += size;
+        else iov.push_back({base, size});
+    }
+}
+
+namespace kmillet
+{
+    /**
+     * @brief Builds the buffers that write the contents of a range of `kmillet::sized_any<N>` objects in a single gathering write.
+     * @tparam TypeList A `kmillet::type_list` of the trivially copyable types that may be written.
+     */
+    template<class TypeList>
+    class sized_any_gather
+    {
+    public:
+        /**
+         * @brief Replaces the buffers by those of the objects in `[first, last)`: a block of tags, followed by their contents.
+         * @tparam It A forward iterator whose value type is a specialization of `kmillet::sized_any`.
+         * @param first The beginning of the range.
+         * @param last The end of the range.
+         * @return `true` on success, or `false` if an object holds a type that is not in `TypeList`, in which case there are no buffers.
+         * @details The buffers refer to the contents of the objects, which must be neither modified nor destroyed until the write completes.
+         */
+        template<std::forward_iterator It>
+        requires(details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+        bool assign(It first, It last);
+
+        /**
+         * @brief Gets the buffers.
+         * @return The buffers, which remain valid until the next call to `assign`. There may be more of them than `IOV_MAX`,
+         * in which case they must be written in several calls.
+         */
+        [[nodiscard]] std::span<const sized_any_iovec> buffers() const noexcept { return iov; }
+        /**
+         * @brief Gets the total size of the buffers.
+         * @return The number of bytes to be written.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return bytes; }
+
+    private:
+    // Member variables
+        std::vector<sized_any_io_tag> tags;
+        std::vector<sized_any_iovec> iov;
+        std::size_t bytes = 0;
+    };
+
+    /**
+     * @brief Builds the buffers that read the contents of a range of `kmillet::sized_any<N>` slots in a single scattering read.
+     * @tparam TypeList A `kmillet::type_list` of the trivially copyable types that may be read, which must match the one of the writer.
+     */
+    template<class TypeList>
+    class sized_any_scatter
+    {
+    public:
+        /**
+         * @brief Prepares to read the tags of `count` objects.
+         * @param count The number of objects that were written.
+         * @return The buffer into which the tags must be read before calling `assign`.
+         */
+        sized_any_iovec& header(std::size_t count);
+
+        /**
+         * @brief Constructs the tagged types in the slots of `[first, last)` and replaces the buffers by those of their contents.
+         * @tparam It A forward iterator whose value type is a specialization of `kmillet::sized_any`.
+         * @param first The beginning of the range.
+         * @param last The end of the range.
+         * @return `true` on success, or `false` if the number of slots differs from the number of tags or if a tag is invalid,
+         * in which case there are no buffers.
+         * @details A slot that already holds the tagged type keeps it, other slots are reset or hold a value-initialized object of that type.
+         * The buffers refer to the contents of the slots, which must be neither modified nor destroyed until the read completes.
+         */
+        template<std::forward_iterator It>
+        requires(details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+        bool assign(It first, It last);
+
+        /**
+         * @brief Gets the buffers.
+         * @return The buffers, which remain valid until the next call to `assign`. There may be more of them than `IOV_MAX`,
+         * in which case they must be read in several calls.
+         */
+        [[nodiscard]] std::span<const sized_any_iovec> buffers() const noexcept { return iov; }
+        /**
+         * @brief Gets the total size of the buffers.
+         * @return The number of bytes to be read.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return bytes; }
+
+    private:
+    // Member variables
+        std::vector<sized_any_io_tag> tags;
+        sized_any_iovec tagBuffer{};
+        std::vector<sized_any_iovec> iov;
+        std::size_t bytes = 0;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class TypeList>
+template <std::forward_iterator It>
+requires(kmillet::details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+inline bool kmillet::sized_any_gather<TypeList>::assign(It first, It last)
+{
+    using io = kmillet::details::sized_any_iovec::io_list<TypeList>;
+    using list = kmillet::details::sized_any_visit::list_traits<TypeList>;
+    tags.clear();
+    iov.clear();
+    bytes = 0;
+    tags.reserve(static_cast<std::size_t>(std::distance(first, last)));
+    for (It it = first; it != last; ++it)
+    {
+        const std::size_t index = list::index(*it);
+        if (index < list::size) tags.push_back(static_cast<kmillet::sized_any_io_tag>(index));
+        else if (it->has_value())
+        {
+            tags.clear();
+            return false;
+        }
+        else tags.push_back(kmillet::sized_any_io_empty);
+    }
+    kmillet::details::sized_any_iovec::append(iov, tags.data(), tags.size() * sizeof(kmillet::sized_any_io_tag));
+    std::size_t i = 0;
+    for (It it = first; it != last; ++it, ++i)
+    {
+        if (tags[i] == kmillet::sized_any_io_empty) continue;
+        // The buffers are only read from by the write, so the contents of a const range are never modified.
+        auto& operand = const_cast<std::remove_const_t<std::remove_reference_t<decltype(*it)>>&>(*it);
+        kmillet::details::sized_any_iovec::append(iov, io::address(operand, tags[i]), io::sizes[tags[i]]);
+    }
+    for (const auto& buffer : iov) bytes += buffer.iov_len;
+    return true;
+}
+
+template <class TypeList>
+inline kmillet::sized_any_iovec& kmillet::sized_any_scatter<TypeList>::header(std::size_t count)
+{
+    tags.assign(count, kmillet::sized_any_io_empty);
+    iov.clear();
+    bytes = 0;
+    tagBuffer = {tags.data(), count * sizeof(kmillet::sized_any_io_tag)};
+    return tagBuffer;
+}
+
+template <class TypeList>
+template <std::forward_iterator It>
+requires(kmillet::details::sized_any::is_sized_any<std::iter_value_t<It>>::value)
+inline bool kmillet::sized_any_scatter<TypeList>::assign(It first, It last)
+{
+    using io = kmillet::details::sized_any_iovec::io_list<TypeList>;
+    iov.clear();
+    bytes = 0;
+    if (static_cast<std::size_t>(std::distance(first, last)) != tags.size()) return false;
+    for (const kmillet::sized_any_io_tag tag : tags)
+    {
+        if (tag != kmillet::sized_any_io_empty && tag >= io::sizes.size()) return false;
+    }
+    std::size_t i = 0;
+    for (It it = first; it != last; ++it, ++i)
+    {
+        if (tags[i] == kmillet::sized_any_io_empty)
+        {
+            it->reset();
+            continue;
+        }
+        io::emplace(*it, tags[i]);
+        kmillet::details::sized_any_iovec::append(iov, io::address(*it, tags[i]), io::sizes[tags[i]]);
+    }
+    for (const auto& buffer : iov) bytes += buffer.iov_len;
+    return true;
+}
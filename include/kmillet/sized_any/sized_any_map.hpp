@@ -0,0 +1,432 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_map.hpp
+ * @author Kenan Millet
+ * @brief A concurrent, sharded hash map from keys to `kmillet::sized_any<N>` values.
+ *
+ * This header provides the `kmillet::sized_any_map<Key, N>` class template, for maps that are read far more often than they are written.
+ * - Keys are distributed over a power-of-two number of shards, each padded to its own cache line.
+ * - Each shard publishes an open-addressed table through an atomic pointer. Each bucket of the table points to an immutable entry,
+ *   which holds the key and the `kmillet::sized_any` value inline. Readers enter an epoch (see `kmillet/sized_any/epoch.hpp`), load the
+ *   current table and probe it. They take no lock and write only to a cache line of their own thread, so they never wait for writers
+ *   or for each other, and reads scale with the number of cores.
+ * - Writers of the same shard are serialized by a mutex, and change the table in place: a write makes a single entry and swaps it into its bucket.
+ *   The replaced entry is destroyed once the readers that loaded it are done with it. Erased buckets are marked rather than emptied,
+ *   so that concurrent probes never skip over an entry.
+ * - A table is only replaced when it fills up with entries and erased buckets. The new one takes over the pointers to the entries,
+ *   so neither keys nor values are copied.
+ * - Typed access through `get<T>` and `update<T>` checks the contained type without throwing.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any_map<std::string, 32> sessions;
+ * sessions.insert_or_assign("alice", 42);
+ * std::optional<int> value = sessions.get<int>("alice");         // holds 42
+ * sessions.update<int>("alice", [](int& value) { ++value; });    // now 43
+ * std::optional<double> other = sessions.get<double>("alice");   // empty, since the contained type is int
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+#include <kmillet/sized_any/epoch.hpp>
+
+#include <atomic>        // for atomic
+#include <bit>           // for bit_ceil, countr_zero
+#include <concepts>      // for invocable
+#include <functional>    // for hash, equal_to, invoke
+#include <limits>        // for numeric_limits
+#include <memory>        // for unique_ptr, make_unique
+#include <mutex>         // for mutex, lock_guard
+#include <optional>
+#include <thread>        // for thread::hardware_concurrency
+#include <utility>       // for forward, move
+#include <vector>
+#include <cstddef>       // for size_t, byte
+
+namespace kmillet
+{
+    /**
+     * @brief A concurrent hash map from `Key` to `kmillet::sized_any<N, Dispatch>`, sharded, with reads that take no lock.
+     * @tparam Key The type of the keys, which must be copy-constructible.
+     * @tparam N The size of the buffer of each `kmillet::sized_any` value.
+     * @tparam Dispatch The dispatch policy of the `kmillet::sized_any` values.
+     * @tparam Hash The hash function used for both shard selection and lookup within a shard.
+     * @tparam KeyEqual The equality comparison of the keys.
+     */
+    template<class Key, std::size_t N, class Dispatch = default_dispatch, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+    class sized_any_map
+    {
+    public:
+        /**
+         * @brief The type of the keys.
+         */
+        using key_type = Key;
+        /**
+         * @brief The type of the values.
+         */
+        using value_type = sized_any<N, Dispatch>;
+
+        /**
+         * @brief Constructs an empty map.
+         * @param shards The minimum number of shards, rounded up to a power of two.
+         * Defaults to four times the number of hardware threads.
+         */
+        explicit sized_any_map(std::size_t shards = 4 * std::thread::hardware_concurrency());
+        /**
+         * @brief Destroys the map, which must not be accessed concurrently.
+         */
+        ~sized_any_map();
+        sized_any_map(const sized_any_map&) = delete;
+        sized_any_map& operator=(const sized_any_map&) = delete;
+
+        /**
+         * @brief Inserts `value` under `key`, replacing the existing value if there is one.
+         * @param key The key.
+         * @param value The value to be stored.
+         * @return `true` if a new entry was inserted, or `false` if an existing value was replaced.
+         * @details Copies `key` and moves `value` into a new entry.
+         */
+        bool insert_or_assign(const key_type& key, value_type value);
+        /**
+         * @brief Removes the entry under `key`.
+         * @param key The key.
+         * @return `true` if an entry was removed, otherwise `false`.
+         */
+        bool erase(const key_type& key);
+
+        /**
+         * @brief Copies the value under `key`, if it holds a `T`.
+         * @tparam T The expected type of the value.
+         * @param key The key.
+         * @return A copy of the value, or an empty `std::optional` if there is no entry under `key` or it does not hold a `T`.
+         * @details Takes no lock.
+         */
+        template<class T>
+        [[nodiscard]] std::optional<T> get(const key_type& key) const;
+        /**
+         * @brief Replaces the value under `key`, if it holds a `T`, with a copy that `f` is invoked on.
+         * @tparam T The expected type of the value.
+         * @tparam F The type of the callable.
+         * @param key The key.
+         * @param f The callable, invoked with a `T&` to the copy while the shard's write mutex is held.
+         * @return `true` if `f` was invoked, otherwise `false`.
+         * @details Readers see either the old value or the updated one. If `f` throws, nothing is changed.
+         * Copies the entry, both key and value, once. `f` must not modify the map.
+         */
+        template<class T, class F>
+        requires(std::invocable<F, T&>)
+        bool update(const key_type& key, F&& f);
+        /**
+         * @brief Invokes `f` with a const reference to the value under `key`, whatever its type.
+         * @tparam F The type of the callable.
+         * @param key The key.
+         * @param f The callable, invoked with a `const value_type&` without any lock held.
+         * @return `true` if `f` was invoked, otherwise `false`.
+         * @details The value stays valid during the call even if the entry is concurrently replaced or erased.
+         * Values that the map no longer holds are not destroyed until `f` returns, so `f` should not block for long.
+         */
+        template<class F>
+        requires(std::invocable<F, const value_type&>)
+        bool visit(const key_type& key, F&& f) const;
+
+        /**
+         * @brief Checks whether there is an entry under `key`.
+         * @param key The key.
+         * @return `true` if and only if there is an entry under `key`.
+         */
+        [[nodiscard]] bool contains(const key_type& key) const;
+        /**
+         * @brief Counts the entries of the map.
+         * @return The number of entries.
+         * @details The shards are counted one at a time, so the result may be stale under concurrent modification.
+         */
+        [[nodiscard]] std::size_t size() const;
+        /**
+         * @brief Gets the number of shards.
+         * @return The number of shards, which is a power of two.
+         */
+        [[nodiscard]] std::size_t shard_count() const noexcept { return mask + 1; }
+
+    private:
+        struct entry
+        {
+            std::size_t hash;
+            Key key;
+            value_type value;
+        };
+        // An open-addressed table with linear probing. Buckets go from empty to holding an entry, and from holding an entry to another one
+        // or to erased, but never back to empty, and at most half of them are taken, so that every probe reaches an empty bucket.
+        struct table
+        {
+            explicit table(std::size_t slots) : buckets(slots) {}
+
+            std::vector<std::atomic<const entry*>> buckets; // only loaded inside an epoch
+            std::size_t used = 0;                           // buckets that are not empty, only accessed by writers
+        };
+        // Padded to its own cache line so that writing one shard does not invalidate its neighbours.
+        struct alignas(64) shard
+        {
+            std::atomic<table*> current{nullptr}; // only loaded inside an epoch
+            std::atomic<std::size_t> count{0};    // entries, only written by writers
+            std::mutex writeMutex;
+            kmillet::details::epoch::retired_list retired; // guarded by writeMutex
+        };
+
+        static constexpr std::size_t initialSlots = 8;
+
+        std::size_t HashOf(const key_type& key) const;
+        shard& Shard(std::size_t hash) const noexcept;
+        std::size_t Probe(const table& t, std::size_t hash, const key_type& key) const;
+        const entry* Find(const table& t, std::size_t hash, const key_type& key) const;
+        static table* Grow(shard& s);
+        static std::size_t Home(std::size_t hash, std::size_t slots) noexcept;
+        static const entry* Erased() noexcept;
+        static bool Live(const entry* e) noexcept;
+        static table* Load(const shard& s) noexcept;
+        static void Replace(shard& s, std::atomic<const entry*>& bucket, const entry* with) noexcept;
+
+    // Member variables
+        std::unique_ptr<shard[]> shards;
+        std::size_t mask;
+        int shift;
+        [[no_unique_address]] Hash hasher;
+        [[no_unique_address]] KeyEqual equal;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::sized_any_map(std::size_t shards)
+    : shards(std::make_unique<shard[]>(std::bit_ceil(shards ? shards : 1)))
+    , mask(std::bit_ceil(shards ? shards : 1) - 1)
+    // The shard is selected by the top bits of the hash, and the bucket within its table by the others.
+    , shift(mask ? std::numeric_limits<std::size_t>::digits - std::countr_zero(mask + 1) : 0)
+{
+    for (std::size_t i = 0; i <= mask; ++i) this->shards[i].current.store(new table(initialSlots), std::memory_order_relaxed);
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::~sized_any_map()
+{
+    if (!shards) return;
+    for (std::size_t i = 0; i <= mask; ++i)
+    {
+        // Retired tables do not own their entries: the entries are either in the current table or retired on their own.
+        table* t = shards[i].current.load(std::memory_order_relaxed);
+        for (const auto& bucket : t->buckets)
+        {
+            const entry* e = bucket.load(std::memory_order_relaxed);
+            if (Live(e)) delete e;
+        }
+        delete t;
+    }
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline bool kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::insert_or_assign(const key_type& key, value_type value)
+{
+    const std::size_t hash = HashOf(key);
+    auto fresh = std::make_unique<const entry>(hash, key, std::move(value));
+    shard& s = Shard(hash);
+    std::lock_guard lock(s.writeMutex);
+    s.retired.reserve();
+    table* t = Load(s);
+    std::size_t index = Probe(*t, hash, key);
+    const entry* old = t->buckets[index].load(std::memory_order_relaxed);
+    if (Live(old))
+    {
+        Replace(s, t->buckets[index], fresh.release());
+        return false;
+    }
+    if (!old && (t->used + 1) * 2 > t->buckets.size())
+    {
+        t = Grow(s);
+        index = Probe(*t, hash, key);
+        old = nullptr;
+    }
+    if (!old) ++t->used;
+    t->buckets[index].store(fresh.release());
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline bool kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::erase(const key_type& key)
+{
+    const std::size_t hash = HashOf(key);
+    shard& s = Shard(hash);
+    std::lock_guard lock(s.writeMutex);
+    table* t = Load(s);
+    const std::size_t index = Probe(*t, hash, key);
+    if (!Live(t->buckets[index].load(std::memory_order_relaxed))) return false;
+    s.retired.reserve();
+    Replace(s, t->buckets[index], Erased());
+    s.count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+template <class T>
+inline std::optional<T> kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::get(const key_type& key) const
+{
+    const std::size_t hash = HashOf(key);
+    kmillet::details::epoch::guard pin;
+    const entry* found = Find(*Load(Shard(hash)), hash, key);
+    if (!found) return std::nullopt;
+    if (const T* value = kmillet::any_cast<T>(&found->value)) return *value;
+    return std::nullopt;
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+template <class T, class F>
+requires(std::invocable<F, T&>)
+inline bool kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::update(const key_type& key, F&& f)
+{
+    const std::size_t hash = HashOf(key);
+    shard& s = Shard(hash);
+    std::lock_guard lock(s.writeMutex);
+    table* t = Load(s);
+    const std::size_t index = Probe(*t, hash, key);
+    const entry* old = t->buckets[index].load(std::memory_order_relaxed);
+    if (!Live(old) || !kmillet::any_cast<T>(&old->value)) return false;
+    auto updated = std::make_unique<entry>(*old);
+    std::invoke(std::forward<F>(f), *kmillet::any_cast<T>(&updated->value));
+    s.retired.reserve();
+    Replace(s, t->buckets[index], updated.release());
+    return true;
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+template <class F>
+requires(std::invocable<F, const typename kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::value_type&>)
+inline bool kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::visit(const key_type& key, F&& f) const
+{
+    const std::size_t hash = HashOf(key);
+    kmillet::details::epoch::guard pin;
+    const entry* found = Find(*Load(Shard(hash)), hash, key);
+    if (!found) return false;
+    std::invoke(std::forward<F>(f), found->value);
+    return true;
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline bool kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::contains(const key_type& key) const
+{
+    const std::size_t hash = HashOf(key);
+    kmillet::details::epoch::guard pin;
+    return Find(*Load(Shard(hash)), hash, key) != nullptr;
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline std::size_t kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::size() const
+{
+    std::size_t total = 0;
+    for (std::size_t i = 0; i <= mask; ++i) total += shards[i].count.load(std::memory_order_relaxed);
+    return total;
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline std::size_t kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::HashOf(const key_type& key) const
+{
+    // Fibonacci hashing spreads the bits of weak hashes, such as the identity hash of integers, into the top bits that select the shard.
+    return static_cast<std::size_t>(hasher(key)) * static_cast<std::size_t>(0x9E3779B97F4A7C15ull);
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline typename kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::shard& kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Shard(std::size_t hash) const noexcept
+{
+    return shards[(hash >> shift) & mask];
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline std::size_t kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Home(std::size_t hash, std::size_t slots) noexcept
+{
+    return (hash ^ (hash >> (sizeof(std::size_t) * 4))) & (slots - 1);
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline const typename kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::entry* kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Erased() noexcept
+{
+    // Only ever compared against, never dereferenced.
+    alignas(entry) static constexpr std::byte marker{};
+    return reinterpret_cast<const entry*>(&marker);
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline bool kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Live(const entry* e) noexcept
+{
+    return e && e != Erased();
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline std::size_t kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Probe(const table& t, std::size_t hash, const key_type& key) const
+{
+    // Returns the bucket holding `key`, or else the first erased bucket of its probe sequence, or else the empty bucket that ends it.
+    // Only called by writers, which are the only ones to store to the buckets.
+    const std::size_t slotMask = t.buckets.size() - 1;
+    std::size_t vacant = t.buckets.size();
+    for (std::size_t i = Home(hash, t.buckets.size());; i = (i + 1) & slotMask)
+    {
+        const entry* e = t.buckets[i].load(std::memory_order_relaxed);
+        if (!e) return vacant != t.buckets.size() ? vacant : i;
+        if (e == Erased())
+        {
+            if (vacant == t.buckets.size()) vacant = i;
+        }
+        else if (e->hash == hash && equal(e->key, key)) return i;
+    }
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline const typename kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::entry*
+kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Find(const table& t, std::size_t hash, const key_type& key) const
+{
+    // Sequentially consistent, as the epoch protocol requires of the loads it protects.
+    const std::size_t slotMask = t.buckets.size() - 1;
+    for (std::size_t i = Home(hash, t.buckets.size());; i = (i + 1) & slotMask)
+    {
+        const entry* e = t.buckets[i].load();
+        if (!e) return nullptr;
+        if (e != Erased() && e->hash == hash && equal(e->key, key)) return e;
+    }
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline typename kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::table* kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Grow(shard& s)
+{
+    // Must be called with the shard's write mutex held, after reserving room for the retired table.
+    // Doubles the table if its entries fill more than a quarter of it, and otherwise only clears its erased buckets.
+    const table* current = Load(s);
+    const std::size_t count = s.count.load(std::memory_order_relaxed);
+    const std::size_t slots = (count + 1) * 4 > current->buckets.size() ? current->buckets.size() * 2 : current->buckets.size();
+    auto next = std::make_unique<table>(slots);
+    for (const auto& bucket : current->buckets)
+    {
+        const entry* e = bucket.load(std::memory_order_relaxed);
+        if (!Live(e)) continue;
+        // Keys are unique, so each entry goes in the first empty bucket from its home without comparing keys.
+        std::size_t i = Home(e->hash, slots);
+        while (next->buckets[i].load(std::memory_order_relaxed)) i = (i + 1) & (slots - 1);
+        next->buckets[i].store(e, std::memory_order_relaxed);
+    }
+    next->used = count;
+    // Nothing can throw once the new table is published.
+    table* published = next.release();
+    s.retired.retire(s.current.exchange(published));
+    s.retired.reclaim();
+    return published;
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline typename kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::table*
+kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Load(const shard& s) noexcept
+{
+    // Sequentially consistent, as the epoch protocol requires of the loads it protects.
+    return s.current.load();
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline void kmillet::sized_any_map<Key, N, Dispatch, Hash, KeyEqual>::Replace(shard& s, std::atomic<const entry*>& bucket, const entry* with) noexcept
+{
+    // Must be called with the shard's write mutex held, after reserving room for the retired entry.
+    s.retired.retire(bucket.exchange(with));
+    s.retired.reclaim();
+}
@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_recycler.hpp
+ * @author Kenan Millet
+ * @brief Batched return of `kmillet::sized_any<N>` values to the thread that allocated their heap storage, to be freed or reused there.
+ *
+ * This header provides the `kmillet::sized_any_recycler<N>` class template, for pipelines where values made by one thread are
+ * destroyed by another, which defeats the per-thread caches of most allocators.
+ * - A consumer hands values back through a `kmillet::sized_any_recycler<N>::sender` instead of destroying them. Values are moved,
+ *   so their heap storage, if any, travels with them and is not freed.
+ * - A sender buffers values and pushes them to the recycler a batch at a time, with a single compare-and-swap on a lock-free list.
+ * - The owning thread collects the returned batches, keeps values whose contents are on the heap in a bounded pool, and destroys the rest.
+ *   The emptied batches are handed back to the senders through a second lock-free list, so batches are only allocated when none is free,
+ *   and only freed with the recycler: returning values frees no memory across threads.
+ *   `make` then builds new values in pooled ones, which reuses their heap storage whenever the sizes of the types match.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any_recycler<16> recycler;                            // owned by the producer thread
+ * // on the producer thread:
+ * recycler.collect();
+ * queue.push(recycler.make<order>(id, price));                         // reuses the storage of a returned order, if any
+ * // on a consumer thread:
+ * kmillet::sized_any_recycler<16>::sender returns(recycler);
+ * returns.release(queue.pop());                                        // instead of letting the value be destroyed
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <atomic>      // for atomic, memory_order
+#include <concepts>    // for copy_constructible, constructible_from
+#include <memory>      // for make_unique
+#include <type_traits> // for decay_t
+#include <utility>     // for forward, move, exchange
+#include <vector>
+#include <cstddef>     // for size_t
+
+namespace kmillet
+{
+    /**
+     * @brief Returns `kmillet::sized_any<N, Dispatch>` values from consumer threads to an owning thread, which frees or reuses their heap storage.
+     * @tparam N The size of the buffer of the values.
+     * @tparam Dispatch The dispatch policy of the values.
+     * @details `collect`, `make`, `pooled` and `trim`, as well as the destructor, must only be called by the owning thread.
+     * Senders may be used concurrently, from any thread, but must be destroyed before the recycler.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch>
+    class sized_any_recycler
+    {
+    private:
+        struct batch
+        {
+            std::vector<sized_any<N, Dispatch>> values;
+            batch* next = nullptr;
+        };
+
+    public:
+        /**
+         * @brief The type of the recycled values.
+         */
+        using value_type = sized_any<N, Dispatch>;
+
+        /**
+         * @brief Buffers values released by a consumer thread and returns them to a recycler in batches.
+         * @details A sender is not thread-safe, so each consumer thread should use its own.
+         */
+        class sender
+        {
+        public:
+            /**
+             * @brief Constructs a sender without buffered values.
+             * @param owner The recycler that values are returned to.
+             */
+            explicit sender(sized_any_recycler& owner) : owner(owner) {}
+            sender(const sender&) = delete;
+            sender& operator=(const sender&) = delete;
+            /**
+             * @brief Returns the buffered values.
+             */
+            ~sender() { flush(); }
+
+            /**
+             * @brief Buffers `value`, and returns the buffered values if there are as many of them as the batch size of the recycler.
+             * @param value The value, which is moved from. Empty values are ignored.
+             */
+            void release(value_type&& value);
+            /**
+             * @brief Returns the buffered values now.
+             */
+            void flush();
+
+        private:
+        // Member variables
+            sized_any_recycler& owner;
+            batch* pending = nullptr;
+        };
+
+        /**
+         * @brief Constructs a recycler with an empty pool.
+         * @param capacity The maximum number of values kept in the pool.
+         * @param batchSize The number of values that senders buffer before they return them.
+         */
+        explicit sized_any_recycler(std::size_t capacity = 64, std::size_t batchSize = 64)
+            : capacity(capacity), batchSize(batchSize ? batchSize : 1)
+        {}
+        sized_any_recycler(const sized_any_recycler&) = delete;
+        sized_any_recycler& operator=(const sized_any_recycler&) = delete;
+        /**
+         * @brief Destroys the pool, every returned value and every batch.
+         */
+        ~sized_any_recycler();
+
+        /**
+         * @brief Takes every batch returned since the last call, pools the values whose contents are on the heap while there is room, and destroys the others.
+         * @return The number of values taken.
+         */
+        std::size_t collect();
+        /**
+         * @brief Makes a value holding a `std::decay_t<ValueType>` constructed from `args...`, in a pooled value if there is one whose contents have the same size.
+         * @tparam ValueType The type of the contents.
+         * @tparam Args The types of the arguments to be forwarded to the constructor of `std::decay_t<ValueType>`.
+         * @param args The arguments.
+         * @return The value, whose contents reuse the heap storage of the pooled value if there was one.
+         */
+        template<class ValueType, class... Args>
+        requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
+        [[nodiscard]] value_type make(Args&&... args);
+
+        /**
+         * @brief Counts the pooled values.
+         * @return The number of pooled values.
+         */
+        [[nodiscard]] std::size_t pooled() const noexcept { return pool.size(); }
+        /**
+         * @brief Destroys every pooled value, freeing its heap storage.
+         */
+        void trim() noexcept { pool.clear(); }
+
+    private:
+        // Pushes the batches linked from `first` to `last` onto `list`.
+        static void Push(std::atomic<batch*>& list, batch* first, batch* last) noexcept;
+        // Takes an emptied batch, or allocates one if none is free.
+        batch* Take();
+
+    // Member variables
+        std::atomic<batch*> returned{nullptr};
+        std::atomic<batch*> spare{nullptr}; // emptied batches, which keep the capacity of their buffers
+        std::vector<value_type> pool;
+        std::size_t capacity;
+        std::size_t batchSize;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_recycler<N, Dispatch>::sender::release(value_type&& value)
+{
+    if (!value.has_value()) return;
+    if (!pending) pending = owner.Take();
+    // Batches are reserved for the batch size of the recycler, so this does not allocate.
+    pending->values.push_back(std::move(value));
+    if (pending->values.size() >= owner.batchSize) flush();
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_recycler<N, Dispatch>::sender::flush()
+{
+    if (!pending) return;
+    Push(owner.returned, pending, pending);
+    pending = nullptr;
+}
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_any_recycler<N, Dispatch>::~sized_any_recycler()
+{
+    for (std::atomic<batch*>* list : {&returned, &spare})
+    {
+        for (batch* b = list->exchange(nullptr, std::memory_order_acquire); b;)
+        {
+            delete std::exchange(b, b->next);
+        }
+    }
+}
+
+template <std::size_t N, class Dispatch>
+inline std::size_t kmillet::sized_any_recycler<N, Dispatch>::collect()
+{
+    batch* first = returned.exchange(nullptr, std::memory_order_acquire);
+    if (!first) return 0;
+    std::size_t taken = 0;
+    for (batch* b = first;; b = b->next)
+    {
+        for (value_type& value : b->values)
+        {
+            // Only contents on the heap have storage worth keeping; the others are destroyed here, by the owning thread.
+            if (pool.size() < capacity && kmillet::details::sized_any::access::info(value)->needsAlloc(N)) pool.push_back(std::move(value));
+        }
+        taken += b->values.size();
+        b->values.clear();
+        if (!b->next)
+        {
+            Push(spare, first, b);
+            return taken;
+        }
+    }
+}
+
+template <std::size_t N, class Dispatch>
+template <class ValueType, class... Args>
+requires(std::copy_constructible<std::decay_t<ValueType>> && std::constructible_from<std::decay_t<ValueType>, Args...>)
+inline typename kmillet::sized_any_recycler<N, Dispatch>::value_type kmillet::sized_any_recycler<N, Dispatch>::make(Args&&... args)
+{
+    if constexpr (kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::NeedsAlloc(N))
+    {
+        constexpr std::size_t size = kmillet::details::sized_any::TypeInfo<std::decay_t<ValueType>>::Size();
+        for (std::size_t i = pool.size(); i-- > 0;)
+        {
+            if (kmillet::details::sized_any::access::info(pool[i])->size() != size) continue;
+            value_type value = std::move(pool[i]);
+            if (i + 1 != pool.size()) pool[i] = std::move(pool.back());
+            pool.pop_back();
+            // Emplacing a type of the same size reuses the heap storage of the previous contents.
+            value.template emplace<ValueType>(std::forward<Args>(args)...);
+            return value;
+        }
+    }
+    return value_type(std::in_place_type<ValueType>, std::forward<Args>(args)...);
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_any_recycler<N, Dispatch>::Push(std::atomic<batch*>& list, batch* first, batch* last) noexcept
+{
+    last->next = list.load(std::memory_order_relaxed);
+    while (!list.compare_exchange_weak(last->next, first, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_any_recycler<N, Dispatch>::batch* kmillet::sized_any_recycler<N, Dispatch>::Take()
+{
+    // The whole list is taken at once, since popping a single batch while other senders pop and push it again could suffer from ABA.
+    batch* b = spare.exchange(nullptr, std::memory_order_acquire);
+    if (!b)
+    {
+        auto fresh = std::make_unique<batch>();
+        fresh->values.reserve(batchSize);
+        return fresh.release();
+    }
+    if (batch* rest = std::exchange(b->next, nullptr))
+    {
+        batch* last = rest;
+        while (last->next) last = last->next;
+        Push(spare, rest, last);
+    }
+    return b;
+}
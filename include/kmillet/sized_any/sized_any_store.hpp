@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_store.hpp
+ * @author Kenan Millet
+ * @brief A multi-version key-value store of `kmillet::sized_any<N>` values, read through immutable snapshots.
+ *
+ * This header provides the `kmillet::sized_any_store<Key, N>` class template, for data that is read often and consistently, and updated in batches.
+ * - Readers pin an immutable version of the whole store, then read from it without locking or copying. Pinning enters an epoch
+ *   (see `kmillet/sized_any/epoch.hpp`), loads the published version with a single atomic load and takes a reference to it, so readers
+ *   never take a lock and never wait, neither for a batch being applied nor for each other.
+ * - Writers apply a `batch` of assignments and erasures atomically by publishing a new version. Versions share structure:
+ *   the entries are split into buckets, and a new version copies only the buckets that the batch modifies, while the values
+ *   themselves are shared by every version that contains them and are never copied.
+ * - Applying a batch therefore costs O(b) to copy the list of buckets, plus O(n / b) for each bucket it modifies, where `b` is the number
+ *   of buckets and `n` the number of entries. It copies the keys of those buckets and one `std::shared_ptr` per entry. Stores that grow
+ *   large, or whose batches are small and frequent, should be given enough buckets to keep each one small.
+ * - A version is reclaimed once it has been replaced and the last snapshot pinning it is released.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any_store<std::string, 32> settings;
+ * kmillet::sized_any_store<std::string, 32>::batch changes;
+ * changes.assign("timeout", 30).assign("host", std::string("example.org"));
+ * settings.apply(std::move(changes));
+ * auto snapshot = settings.load();                          // consistent until released
+ * const int* timeout = snapshot.get<int>("timeout");        // points to 30
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+#include <kmillet/sized_any/epoch.hpp>
+
+#include <atomic>        // for atomic, memory_order
+#include <bit>           // for bit_ceil
+#include <concepts>      // for constructible_from
+#include <cstdint>       // for uint64_t
+#include <functional>    // for hash, equal_to
+#include <memory>        // for shared_ptr, make_shared, make_unique
+#include <mutex>         // for mutex, lock_guard
+#include <type_traits>   // for decay_t
+#include <unordered_map>
+#include <utility>       // for forward, move, pair
+#include <vector>
+#include <cstddef>       // for size_t
+
+namespace kmillet
+{
+    /**
+     * @brief A multi-version map from keys to `kmillet::sized_any<N, Dispatch>` values, read through immutable snapshots.
+     * @tparam Key The type of the keys.
+     * @tparam N The size of the buffer of the values.
+     * @tparam Dispatch The dispatch policy of the values.
+     * @tparam Hash The hash function used for both bucket selection and lookup within a bucket.
+     * @tparam KeyEqual The key equality predicate.
+     */
+    template<class Key, std::size_t N, class Dispatch = default_dispatch, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+    class sized_any_store
+    {
+    private:
+        using entry = std::shared_ptr<const sized_any<N, Dispatch>>;
+        using bucket = std::unordered_map<Key, entry, Hash, KeyEqual>;
+        struct version
+        {
+            std::vector<std::shared_ptr<const bucket>> buckets;
+            std::size_t size = 0;
+            std::uint64_t number = 0;
+            [[no_unique_address]] Hash hasher; // the store's, so that snapshots select the buckets that `apply` filled
+        };
+        using published = std::shared_ptr<const version>;
+
+    public:
+        using key_type = Key;
+        using value_type = sized_any<N, Dispatch>;
+
+        /**
+         * @brief An immutable version of the store, which stays valid and unchanged however the store is updated.
+         * @details A snapshot may be read by several threads at once. A default-constructed snapshot is empty.
+         */
+        class snapshot
+        {
+        public:
+            snapshot() = default;
+
+            /**
+             * @brief Gets the value under `key`, whatever its type.
+             * @param key The key.
+             * @return A pointer to the value, or `nullptr` if there is no entry under `key`. It is valid as long as the snapshot or a copy of it lives.
+             */
+            [[nodiscard]] const value_type* find(const key_type& key) const;
+            /**
+             * @brief Gets the contents of the value under `key`, if it holds a `T`.
+             * @tparam T The expected type of the contents.
+             * @param key The key.
+             * @return A pointer to the contents, or `nullptr` if there is no entry under `key` or it does not hold a `T`.
+             * It is valid as long as the snapshot or a copy of it lives.
+             */
+            template<class T>
+            [[nodiscard]] const T* get(const key_type& key) const;
+            /**
+             * @brief Checks whether there is an entry under `key`.
+             * @param key The key.
+             * @return `true` if and only if there is an entry under `key`.
+             */
+            [[nodiscard]] bool contains(const key_type& key) const { return find(key) != nullptr; }
+            /**
+             * @brief Counts the entries of the snapshot.
+             * @return The number of entries.
+             */
+            [[nodiscard]] std::size_t size() const noexcept { return current ? current->size : 0; }
+            /**
+             * @brief Gets the version number of the snapshot.
+             * @return The number of batches applied to the store before this version was published.
+             */
+            [[nodiscard]] std::uint64_t version() const noexcept { return current ? current->number : 0; }
+
+        private:
+            friend class sized_any_store;
+            explicit snapshot(std::shared_ptr<const typename sized_any_store::version> current) noexcept : current(std::move(current)) {}
+
+        // Member variables
+            std::shared_ptr<const typename sized_any_store::version> current;
+        };
+
+        /**
+         * @brief A sequence of assignments and erasures, applied to the store atomically by `kmillet::sized_any_store::apply`.
+         * @details Later operations on a key override earlier ones.
+         */
+        class batch
+        {
+        public:
+            /**
+             * @brief Assigns `value` to `key`.
+             * @param key The key.
+             * @param value The value, which is moved into shared storage.
+             * @return A reference to `*this`.
+             */
+            batch& assign(key_type key, value_type value);
+            /**
+             * @brief Assigns a value holding a `T` constructed from `args...` to `key`.
+             * @tparam T The type of the contents.
+             * @tparam Args The types of the arguments of the constructor of `T`.
+             * @param key The key.
+             * @param args The arguments.
+             * @return A reference to `*this`.
+             */
+            template<class T, class... Args>
+            requires(std::constructible_from<std::decay_t<T>, Args...>)
+            batch& emplace(key_type key, Args&&... args);
+            /**
+             * @brief Erases the entry under `key`, if any.
+             * @param key The key.
+             * @return A reference to `*this`.
+             */
+            batch& erase(key_type key);
+
+            /**
+             * @brief Checks whether the batch has no operations.
+             * @return `true` if and only if the batch has no operations.
+             */
+            [[nodiscard]] bool empty() const noexcept { return operations.empty(); }
+
+        private:
+            friend class sized_any_store;
+
+        // Member variables
+            std::vector<std::pair<Key, entry>> operations;  // a null entry erases
+        };
+
+        /**
+         * @brief Constructs an empty store.
+         * @param buckets The number of buckets of each version, rounded up to a power of two. A batch copies every bucket it modifies,
+         * so more buckets make applying small batches cheaper, up to about one bucket per entry.
+         * @param hash The hash function, which every version and snapshot of the store uses.
+         */
+        explicit sized_any_store(std::size_t buckets = 64, const Hash& hash = Hash());
+        /**
+         * @brief Destroys the store, which must not be accessed concurrently. Snapshots may outlive it.
+         */
+        ~sized_any_store();
+        sized_any_store(const sized_any_store&) = delete;
+        sized_any_store& operator=(const sized_any_store&) = delete;
+
+        /**
+         * @brief Pins the current version of the store.
+         * @return A snapshot of the current version.
+         * @details Takes no lock and never waits. May allocate the first time the calling thread reads from any container of this library,
+         * to register it with the epochs.
+         */
+        [[nodiscard]] snapshot load() const;
+        /**
+         * @brief Applies every operation of `changes` and publishes the result as the new current version.
+         * @param changes The operations to be applied.
+         * @return The number of the published version.
+         * @details Writers are serialized with each other. Readers keep loading the previous version until the new one is published.
+         * Snapshots taken before the call do not observe the changes. Costs O(b + k * n / b) for `k` modified buckets out of `b`, with `n` entries.
+         */
+        std::uint64_t apply(batch changes);
+
+    private:
+        void Store(std::shared_ptr<const version> updated);
+
+    // Member variables
+        // Points to the store's reference to the current version, which is retired with the version it refers to when it is replaced.
+        std::atomic<const published*> current; // only loaded inside an epoch
+        std::mutex writeMutex;
+        kmillet::details::epoch::retired_list retired; // guarded by writeMutex
+        [[no_unique_address]] Hash hasher;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline const typename kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::value_type*
+kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::snapshot::find(const key_type& key) const
+{
+    if (!current) return nullptr;
+    const bucket& b = *current->buckets[current->hasher(key) & (current->buckets.size() - 1)];
+    auto it = b.find(key);
+    return it == b.end() ? nullptr : it->second.get();
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+template <class T>
+inline const T* kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::snapshot::get(const key_type& key) const
+{
+    return kmillet::any_cast<T>(find(key));
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline typename kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::batch&
+kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::batch::assign(key_type key, value_type value)
+{
+    operations.emplace_back(std::move(key), std::make_shared<const value_type>(std::move(value)));
+    return *this;
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+template <class T, class... Args>
+requires(std::constructible_from<std::decay_t<T>, Args...>)
+inline typename kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::batch&
+kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::batch::emplace(key_type key, Args&&... args)
+{
+    operations.emplace_back(std::move(key), std::make_shared<const value_type>(std::in_place_type<T>, std::forward<Args>(args)...));
+    return *this;
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline typename kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::batch&
+kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::batch::erase(key_type key)
+{
+    operations.emplace_back(std::move(key), nullptr);
+    return *this;
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::sized_any_store(std::size_t buckets, const Hash& hash)
+    : hasher(hash)
+{
+    auto initial = std::make_shared<version>(version{{}, 0, 0, hasher});
+    initial->buckets.assign(std::bit_ceil(buckets ? buckets : 1), std::make_shared<const bucket>(0, hasher));
+    current.store(new published(std::move(initial)), std::memory_order_relaxed);
+}
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::~sized_any_store()
+{
+    delete current.load(std::memory_order_relaxed);
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline typename kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::snapshot
+kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::load() const
+{
+    // The store's reference cannot be released while the epoch is pinned, so copying it is safe.
+    kmillet::details::epoch::guard pin;
+    return snapshot(*current.load());
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline std::uint64_t kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::apply(batch changes)
+{
+    std::lock_guard lock(writeMutex);
+    const std::shared_ptr<const version> previous = *current.load(std::memory_order_relaxed);
+    auto next = std::make_shared<version>(*previous);  // shares every bucket of the previous version
+    next->number = previous->number + 1;
+    const std::size_t mask = next->buckets.size() - 1;
+    // Each bucket is copied once, the first time the batch touches it; the copy shares the values of the previous version.
+    std::vector<bucket*> copied(next->buckets.size(), nullptr);
+    for (auto& [key, value] : changes.operations)
+    {
+        const std::size_t i = hasher(key) & mask;
+        if (!copied[i])
+        {
+            auto copy = std::make_shared<bucket>(*next->buckets[i]);
+            copied[i] = copy.get();
+            next->buckets[i] = std::move(copy);
+        }
+        bucket& b = *copied[i];
+        next->size -= b.erase(key);
+        if (value)
+        {
+            b.emplace(std::move(key), std::move(value));
+            ++next->size;
+        }
+    }
+    Store(std::move(next));
+    return previous->number + 1;
+}
+
+template <class Key, std::size_t N, class Dispatch, class Hash, class KeyEqual>
+inline void kmillet::sized_any_store<Key, N, Dispatch, Hash, KeyEqual>::Store(std::shared_ptr<const version> updated)
+{
+    // Must be called with the write mutex held. Nothing can throw once the new version is published.
+    auto reference = std::make_unique<const published>(std::move(updated));
+    retired.reserve();
+    retired.retire(current.exchange(reference.release()));
+    retired.reclaim();
+}
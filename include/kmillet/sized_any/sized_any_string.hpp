@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_string.hpp
+ * @author Kenan Millet
+ * @brief Inline storage of short strings in `kmillet::sized_any<N>`, readable as `std::string_view`.
+ *
+ * This header provides the `kmillet::inline_string<Capacity>` class template, `kmillet::make_sized_any_string` and `kmillet::string_view_cast`.
+ * - `std::string` is at least as large as the buffer of `kmillet::any` on common ABIs, so storing one usually allocates.
+ *   `kmillet::make_sized_any_string<N>` instead stores the characters of strings that fit directly in the buffer, as a
+ *   `kmillet::sized_any_string<N>`, and only falls back to `std::string` for longer ones.
+ * - `kmillet::string_view_cast` reads the contents of a `kmillet::sized_any<N>` as a `std::string_view`, whether it holds a
+ *   `kmillet::inline_string` of any capacity, a `std::string` or a `std::string_view`, so strings made for one buffer size can be read
+ *   after being moved into a `kmillet::sized_any` of another. A `std::string` is only materialized if the caller asks for one.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any<32> a = kmillet::make_sized_any_string<32>("log.level"); // stored in-place, no allocation
+ * std::optional<std::string_view> level = kmillet::string_view_cast(a);        // "log.level"
+ * std::string copy(*level);                                                   // materialized on demand
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <algorithm>   // for copy_n
+#include <array>
+#include <cassert>
+#include <cstdint>     // for uint8_t
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits> // for is_standard_layout_v
+#include <cstddef>     // for size_t
+
+// Private utilities for kmillet::inline_string and kmillet::string_view_cast
+namespace kmillet::details::sized_any_string
+{
+    // The marker shared by the type information of every specialization of `kmillet::inline_string`.
+    inline constexpr char marker = 0;
+
+    // Reads the contents of `operand` if it holds a `kmillet::inline_string` of any capacity.
+    template<std::size_t N, class Dispatch>
+    std::optional<std::string_view> inline_view(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept;
+}
+
+namespace kmillet
+{
+    /**
+     * @brief A string of up to `Capacity` characters stored entirely within the object.
+     *
+     * Trivially copyable and exactly `Capacity + 1` bytes in size, so it is stored in-place by any `kmillet::sized_any<N>` with `N > Capacity`.
+     * @tparam Capacity The maximum number of characters, which must be less than 256.
+     */
+    template<std::size_t Capacity>
+    class inline_string
+    {
+        static_assert(Capacity < 256, "The length of kmillet::inline_string is stored in a single byte.");
+
+    public:
+        /**
+         * @brief Constructs an empty string.
+         */
+        constexpr inline_string() noexcept = default;
+        /**
+         * @brief Constructs a string holding a copy of the characters of `str`.
+         * @param str The characters to be copied. The behavior is undefined if `str.size() > Capacity`.
+         */
+        constexpr explicit inline_string(std::string_view str) noexcept;
+
+        /**
+         * @brief Gets the characters of the string.
+         * @return A view of the characters, which remains valid for as long as `*this` is neither modified nor destroyed.
+         */
+        [[nodiscard]] constexpr std::string_view view() const noexcept { return {chars.data(), length}; }
+        /**
+         * @brief Equivalent to `view()`.
+         */
+        [[nodiscard]] constexpr operator std::string_view() const noexcept { return view(); }
+        /**
+         * @brief Gets the number of characters of the string.
+         * @return The number of characters.
+         */
+        [[nodiscard]] constexpr std::size_t size() const noexcept { return length; }
+        /**
+         * @brief Gets the maximum number of characters of the string.
+         * @return `Capacity`.
+         */
+        [[nodiscard]] static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+        friend constexpr bool operator==(const inline_string& lhs, const inline_string& rhs) noexcept { return lhs.view() == rhs.view(); }
+
+        /**
+         * @brief Identifies every specialization of `kmillet::inline_string` in the type information of a `kmillet::sized_any`,
+         * so that `kmillet::string_view_cast` reads them whatever their capacity.
+         */
+        static constexpr const void* sized_any_marker = &details::sized_any_string::marker;
+
+    private:
+    // Member variables
+        std::array<char, Capacity> chars{};
+        std::uint8_t length = 0;
+    };
+
+    /**
+     * @brief The `kmillet::inline_string` that uses the whole buffer of a `kmillet::sized_any<N>`.
+     * @tparam N The size of the buffer.
+     */
+    template<std::size_t N>
+    using sized_any_string = inline_string<(N > 256 ? 255 : N - 1)>;
+
+    /**
+     * @brief Constructs a `kmillet::sized_any<N, Dispatch>` holding the characters of `str`.
+     * @tparam N The size of the buffer used for in-place storage.
+     * @tparam Dispatch The dispatch policy of the constructed `kmillet::sized_any`.
+     * @param str The characters to be stored.
+     * @return A `kmillet::sized_any<N, Dispatch>` holding a `kmillet::sized_any_string<N>` if `str` fits in it, in which case no dynamic allocation
+     * occurs, or a `std::string` otherwise.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch>
+    requires(N >= sizeof(void*))
+    sized_any<N, Dispatch> make_sized_any_string(std::string_view str);
+
+    /**
+     * @brief Reads the contents of `operand` as a string.
+     * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The `kmillet::sized_any<N>` to be read.
+     * @return A view of the characters of the contents of `operand` if it holds a `kmillet::inline_string` of any capacity, a `std::string`
+     * or a `std::string_view`, otherwise an empty `std::optional`.
+     * @details The view remains valid for as long as the contents of `operand` are neither modified nor destroyed.
+     * Unlike `kmillet::any_cast`, a type mismatch is not reported by an exception.
+     */
+    template<std::size_t N, class Dispatch>
+    std::optional<std::string_view> string_view_cast(const sized_any<N, Dispatch>& operand) noexcept;
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t Capacity>
+inline constexpr kmillet::inline_string<Capacity>::inline_string(std::string_view str) noexcept
+    : length(static_cast<std::uint8_t>(str.size()))
+{
+    // kmillet::details::sized_any_string::inline_view relies on this layout to read a string without knowing its capacity.
+    static_assert(sizeof(inline_string) == Capacity + 1 && std::is_standard_layout_v<inline_string>);
+    assert(str.size() <= Capacity);
+    std::copy_n(str.data(), str.size(), chars.begin());
+}
+
+template <std::size_t N, class Dispatch>
+inline std::optional<std::string_view> kmillet::details::sized_any_string::inline_view(const ::kmillet::sized_any<N, Dispatch>& operand) noexcept
+{
+    const auto* info = kmillet::details::sized_any::access::info(operand);
+    if (info->marker() != &marker) return std::nullopt;
+    // The characters of a kmillet::inline_string<Capacity> are its first Capacity bytes, and its length is the last one.
+    const std::size_t capacity = info->size() - 1;
+    const char* str = static_cast<const char*>(kmillet::details::sized_any::access::data(operand));
+    return std::string_view(str, static_cast<std::uint8_t>(str[capacity]));
+}
+
+template <std::size_t N, class Dispatch>
+requires(N >= sizeof(void*))
+inline kmillet::sized_any<N, Dispatch> kmillet::make_sized_any_string(std::string_view str)
+{
+    using inline_type = kmillet::sized_any_string<N>;
+    if (str.size() <= inline_type::capacity()) return kmillet::sized_any<N, Dispatch>(std::in_place_type<inline_type>, str);
+    return kmillet::sized_any<N, Dispatch>(std::in_place_type<std::string>, str);
+}
+
+template <std::size_t N, class Dispatch>
+inline std::optional<std::string_view> kmillet::string_view_cast(const kmillet::sized_any<N, Dispatch>& operand) noexcept
+{
+    if (auto str = kmillet::details::sized_any_string::inline_view(operand)) return str;
+    if (const auto* str = kmillet::any_cast<std::string>(&operand)) return std::string_view(*str);
+    if (const auto* str = kmillet::any_cast<std::string_view>(&operand)) return *str;
+    return std::nullopt;
+}
@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_trace.hpp
+ * @author Kenan Millet
+ * @brief Recording of `kmillet::sized_any` operations into a compact binary trace, for offline replay.
+ *
+ * This header provides the `kmillet::sized_any_trace_record` trace format, `kmillet::write_sized_any_trace` and
+ * `kmillet::read_sized_any_trace` to store and load traces, and, if `KMILLET_SIZED_ANY_TRACE()` is enabled,
+ * the `kmillet::sized_any_trace_recorder` class, which records the operations of every `kmillet::sized_any` in the program.
+ * - Objects are identified by slots rather than addresses: the first object seen at an address is given the next free slot.
+ * - Types are identified by their size, alignment and whether they are nothrow move constructible, which is what determines
+ *   whether a `kmillet::sized_any<N>` allocates.
+ * - Each record takes 14 bytes once written.
+ *
+ * The `sized_any_trace` benchmark replays such a trace against several capacities and dispatch policies.
+ * It reads the trace named by the `KMILLET_SIZED_ANY_TRACE_FILE` environment variable, if set.
+ *
+ * @section Usage
+ * @code
+ * // in a program where every translation unit is compiled with KMILLET_SIZED_ANY_TRACE() defined to 1:
+ * std::vector<kmillet::sized_any_trace_record> trace;
+ * {
+ *     kmillet::sized_any_trace_recorder recorder;
+ *     run_workload();
+ *     trace = recorder.records();
+ * }
+ * std::ofstream out("workload.trace", std::ios::binary);
+ * kmillet::write_sized_any_trace(out, trace);
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <array>
+#include <bit>           // for countr_zero
+#include <cstdint>       // for uint8_t, uint32_t
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <utility>       // for exchange
+#include <vector>
+#include <cstddef>       // for size_t
+
+#if KMILLET_SIZED_ANY_TRACE()
+#include <mutex>         // for mutex, lock_guard
+#include <unordered_map>
+#endif
+
+namespace kmillet
+{
+    /**
+     * @brief A single operation of a recorded trace.
+     */
+    struct sized_any_trace_record
+    {
+        /**
+         * @brief The value of `other` for operations that involve a single object.
+         */
+        static constexpr std::uint32_t no_slot = 0xFFFFFFFF;
+        /**
+         * @brief The bits of `flags` that hold the base-2 logarithm of the alignment of the type.
+         */
+        static constexpr std::uint8_t alignment_bits = 0x3F;
+        /**
+         * @brief The bit of `flags` that is set if the type is nothrow move constructible.
+         */
+        static constexpr std::uint8_t nothrow_movable = 0x80;
+
+        /**
+         * @brief Makes the flags of a type.
+         * @param alignment The alignment of the type, which must be a power of two.
+         * @param nothrowMovable Whether the type is nothrow move constructible.
+         * @return The flags.
+         */
+        static constexpr std::uint8_t make_flags(std::size_t alignment, bool nothrowMovable) noexcept
+        {
+            return static_cast<std::uint8_t>(std::countr_zero(alignment)) | (nothrowMovable ? nothrow_movable : 0);
+        }
+        /**
+         * @brief Gets the alignment of the type.
+         * @return The alignment held in `flags`.
+         */
+        [[nodiscard]] constexpr std::size_t alignment() const noexcept { return std::size_t{1} << (flags & alignment_bits); }
+        /**
+         * @brief Tells whether the type is nothrow move constructible.
+         * @return Whether `flags` has `nothrow_movable` set.
+         */
+        [[nodiscard]] constexpr bool is_nothrow_movable() const noexcept { return (flags & nothrow_movable) != 0; }
+
+        sized_any_trace_event event;
+        std::uint32_t self;
+        std::uint32_t other = no_slot;
+        std::uint32_t size = 0;
+        std::uint8_t flags = make_flags(1, true);
+
+        friend bool operator==(const sized_any_trace_record&, const sized_any_trace_record&) = default;
+    };
+
+    /**
+     * @brief Writes `trace` to `out` in the binary trace format.
+     * @param out The stream to write to, which should be opened in binary mode.
+     * @param trace The records to be written.
+     * @return `true` if and only if `out` is still good after writing.
+     */
+    bool write_sized_any_trace(std::ostream& out, std::span<const sized_any_trace_record> trace);
+    /**
+     * @brief Reads a trace written by `kmillet::write_sized_any_trace`.
+     * @param in The stream to read from, which should be opened in binary mode.
+     * @return The records of the trace, or an empty `std::optional` if `in` does not hold a well-formed trace.
+     */
+    std::optional<std::vector<sized_any_trace_record>> read_sized_any_trace(std::istream& in);
+
+#if KMILLET_SIZED_ANY_TRACE()
+    /**
+     * @brief Records the operations of every `kmillet::sized_any` of the program for as long as it exists.
+     * @details Installs its own trace hook on construction and restores the previous one on destruction, so recorders must be
+     * destroyed in the reverse order of their construction. Recording is thread-safe, and a recorder may be destroyed while other threads
+     * are still reporting operations: its destructor waits for the operation being recorded, if any, and later ones go to the previous recorder.
+     */
+    class sized_any_trace_recorder
+    {
+    public:
+        sized_any_trace_recorder();
+        sized_any_trace_recorder(const sized_any_trace_recorder&) = delete;
+        sized_any_trace_recorder& operator=(const sized_any_trace_recorder&) = delete;
+        ~sized_any_trace_recorder();
+
+        /**
+         * @brief Gets the records so far.
+         * @return A copy of the records, in the order in which the operations were reported.
+         */
+        [[nodiscard]] std::vector<sized_any_trace_record> records() const;
+
+    private:
+        static void Record(sized_any_trace_event event, const void* self, const void* other, std::size_t size, std::size_t alignment, bool nothrowMovable) noexcept;
+        std::uint32_t Slot(const void* object);
+
+    // Member variables
+        // Shared by every recorder, so that `active` cannot be replaced and destroyed while an operation is being recorded into it.
+        static inline std::mutex mutex;
+        static inline sized_any_trace_recorder* active = nullptr; // guarded by mutex
+        sized_any_trace_recorder* previous;
+        sized_any_trace_hook previousHook;
+        std::unordered_map<const void*, std::uint32_t> slots;
+        std::vector<sized_any_trace_record> log;
+    };
+#endif
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+// Private utilities for the binary trace format
+namespace kmillet::details::sized_any_trace
+{
+    inline constexpr std::array<char, 5> header{'K', 'S', 'A', 'T', 2}; // magic number followed by the format version
+    inline constexpr std::size_t record_size = 14;
+    inline constexpr std::uint8_t last_event = static_cast<std::uint8_t>(::kmillet::sized_any_trace_event::destroy);
+
+    inline void put(char*& out, std::uint32_t value) noexcept
+    {
+        for (int i = 0; i < 4; ++i) *out++ = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+    inline std::uint32_t get(const char*& in) noexcept
+    {
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value |= static_cast<std::uint32_t>(static_cast<unsigned char>(*in++)) << (8 * i);
+        return value;
+    }
+}
+
+inline bool kmillet::write_sized_any_trace(std::ostream& out, std::span<const kmillet::sized_any_trace_record> trace)
+{
+    using namespace kmillet::details::sized_any_trace;
+    out.write(header.data(), header.size());
+    for (const auto& record : trace)
+    {
+        std::array<char, record_size> bytes;
+        char* it = bytes.data();
+        *it++ = static_cast<char>(record.event);
+        put(it, record.self);
+        put(it, record.other);
+        put(it, record.size);
+        *it++ = static_cast<char>(record.flags);
+        out.write(bytes.data(), bytes.size());
+    }
+    return out.good();
+}
+inline std::optional<std::vector<kmillet::sized_any_trace_record>> kmillet::read_sized_any_trace(std::istream& in)
+{
+    using namespace kmillet::details::sized_any_trace;
+    std::array<char, header.size()> magic;
+    if (!in.read(magic.data(), magic.size()) || magic != header) return std::nullopt;
+    std::vector<kmillet::sized_any_trace_record> trace;
+    std::array<char, record_size> bytes;
+    while (in.read(bytes.data(), bytes.size()))
+    {
+        const char* it = bytes.data();
+        const auto event = static_cast<std::uint8_t>(*it++);
+        if (event > last_event) return std::nullopt;
+        kmillet::sized_any_trace_record& record = trace.emplace_back();
+        record.event = static_cast<kmillet::sized_any_trace_event>(event);
+        record.self = get(it);
+        record.other = get(it);
+        record.size = get(it);
+        record.flags = static_cast<std::uint8_t>(*it++);
+        // The bit between the alignment and `nothrow_movable` is reserved.
+        if ((record.flags & ~(kmillet::sized_any_trace_record::alignment_bits | kmillet::sized_any_trace_record::nothrow_movable)) != 0) return std::nullopt;
+    }
+    // A partial record means that the trace was truncated.
+    if (in.gcount() != 0) return std::nullopt;
+    return trace;
+}
+
+#if KMILLET_SIZED_ANY_TRACE()
+inline kmillet::sized_any_trace_recorder::sized_any_trace_recorder()
+{
+    std::lock_guard lock(mutex);
+    previous = std::exchange(active, this);
+    previousHook = kmillet::set_sized_any_trace_hook(&Record);
+}
+inline kmillet::sized_any_trace_recorder::~sized_any_trace_recorder()
+{
+    // Threads that loaded the hook before it is restored may still call `Record`, which then records into `previous`.
+    std::lock_guard lock(mutex);
+    kmillet::set_sized_any_trace_hook(previousHook);
+    active = previous;
+}
+
+inline std::vector<kmillet::sized_any_trace_record> kmillet::sized_any_trace_recorder::records() const
+{
+    std::lock_guard lock(mutex);
+    return log;
+}
+
+inline void kmillet::sized_any_trace_recorder::Record(kmillet::sized_any_trace_event event, const void* self, const void* other,
+                                                      std::size_t size, std::size_t alignment, bool nothrowMovable) noexcept
+{
+    std::lock_guard lock(mutex);
+    sized_any_trace_recorder* recorder = active;
+    if (!recorder) return;
+#if defined(__cpp_exceptions)
+    try
+    {
+#endif
+        sized_any_trace_record record{event, recorder->Slot(self)};
+        if (other) record.other = recorder->Slot(other);
+        record.size = static_cast<std::uint32_t>(size);
+        record.flags = kmillet::sized_any_trace_record::make_flags(alignment, nothrowMovable);
+        recorder->log.push_back(record);
+#if defined(__cpp_exceptions)
+    }
+    catch (...)
+    {
+        // Running out of memory while recording drops the record rather than disturbing the traced program.
+    }
+#endif
+}
+inline std::uint32_t kmillet::sized_any_trace_recorder::Slot(const void* object)
+{
+    return slots.try_emplace(object, static_cast<std::uint32_t>(slots.size())).first->second;
+}
+#endif
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_variant.hpp
+ * @author Kenan Millet
+ * @brief Conversions between `kmillet::sized_any<N>` and `std::variant`.
+ *
+ * This header provides `kmillet::to_variant` and `kmillet::from_variant`.
+ * - `kmillet::to_variant<std::variant<Ts...>>` finds the alternative that matches the contained type through a hash table of
+ *   type information pointers, in constant time however many alternatives there are, then converts through a table of converters
+ *   indexed by that alternative. No `kmillet::any_cast` is attempted per alternative.
+ * - Like `kmillet::sized_any` itself, the alternatives other than `std::monostate` must be copy constructible. Variants with a move-only
+ *   alternative, such as `std::unique_ptr`, are rejected at compile time.
+ * - Payloads are moved (or copied) directly between the `kmillet::sized_any` buffer and the variant, without intermediate objects.
+ * - A contained type that is not an alternative of the variant is reported by an empty `std::optional`, not by an exception.
+ * - An empty `kmillet::sized_any` corresponds to the `std::monostate` alternative, if the variant has one.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_any<32> a = 42;
+ * std::optional<std::variant<int, double>> v = kmillet::to_variant<std::variant<int, double>>(std::move(a)); // holds int 42, a is now empty
+ * kmillet::sized_any<32> b = kmillet::from_variant<32>(std::variant<int, double>(1.5)); // holds double 1.5
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <array>
+#include <concepts>    // for copy_constructible
+#include <optional>
+#include <type_traits> // for decay_t, remove_cvref_t, is_same_v, bool_constant
+#include <utility>     // for forward, move, index_sequence
+#include <variant>
+#include <cstddef>     // for size_t
+
+// Private utilities for kmillet::to_variant and kmillet::from_variant
+namespace kmillet::details::sized_any_variant
+{
+    // Satisfied if every alternative of `Variant` other than `std::monostate` can be held by a `kmillet::sized_any`, which requires copy construction.
+    template<class Variant> struct storable : std::false_type {};
+    template<class... Ts>
+    struct storable<std::variant<Ts...>> : std::bool_constant<((std::is_same_v<Ts, std::monostate> || std::copy_constructible<Ts>) && ...)> {};
+
+    // Type information of each alternative of `Variant`, in alternative order.
+    // `std::monostate` is mapped to the type information of an empty `kmillet::sized_any`.
+    template<class Variant, class Dispatch, class Indices = std::make_index_sequence<std::variant_size_v<Variant>>>
+    struct alternatives;
+    template<class Variant, class Dispatch, std::size_t... I>
+    struct alternatives<Variant, Dispatch, std::index_sequence<I...>>
+    {
+        template<class T>
+        using stored = std::conditional_t<std::is_same_v<T, std::monostate>, void, T>;
+
+        // Finds the first alternative whose type information matches, or returns `sizeof...(I)` if there is none.
+        using index = sized_any::info_index<Dispatch, stored<std::variant_alternative_t<I, Variant>>...>;
+
+        template<std::size_t Index, class Operand>
+        static Variant convert(Operand& operand)
+        {
+            using T = std::variant_alternative_t<Index, Variant>;
+            if constexpr (std::is_same_v<T, std::monostate>) return Variant(std::in_place_index<Index>);
+            else if constexpr (std::is_const_v<Operand>) return Variant(std::in_place_index<Index>, sized_any::access::unchecked<T>(operand));
+            else return Variant(std::in_place_index<Index>, std::move(sized_any::access::unchecked<T>(operand)));
+        }
+
+        template<class Operand>
+        static constexpr std::array<Variant (*)(Operand&), sizeof...(I)> converters{&convert<I, Operand>...};
+    };
+}
+
+namespace kmillet
+{
+    /**
+     * @brief Moves the contained object of `operand` into a `Variant`.
+     * @tparam Variant A specialization of `std::variant` whose alternatives, other than `std::monostate`, are copy constructible.
+     * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The `kmillet::sized_any<N>` whose contained object is moved.
+     * @return A `Variant` holding the first alternative whose type matches the contained type of `operand`,
+     * or an empty `std::optional` if no alternative matches, in which case `operand` is left untouched.
+     * @details On success, `operand` is left empty. If `operand` is empty, the `std::monostate` alternative is selected, if there is one.
+     */
+    template<class Variant, std::size_t N, class Dispatch>
+    requires(details::sized_any_variant::storable<Variant>::value)
+    std::optional<Variant> to_variant(sized_any<N, Dispatch>&& operand);
+    /**
+     * @brief Copies the contained object of `operand` into a `Variant`.
+     * @tparam Variant A specialization of `std::variant` whose alternatives, other than `std::monostate`, are copy constructible.
+     * @tparam N The size of the buffer used by `operand`.
+     * @tparam Dispatch The dispatch policy used by `operand`.
+     * @param operand The `kmillet::sized_any<N>` whose contained object is copied.
+     * @return A `Variant` holding the first alternative whose type matches the contained type of `operand`,
+     * or an empty `std::optional` if no alternative matches.
+     * @details If `operand` is empty, the `std::monostate` alternative is selected, if there is one.
+     */
+    template<class Variant, std::size_t N, class Dispatch>
+    requires(details::sized_any_variant::storable<Variant>::value)
+    std::optional<Variant> to_variant(const sized_any<N, Dispatch>& operand);
+
+    /**
+     * @brief Constructs a `kmillet::sized_any<N, Dispatch>` holding the active alternative of `variant`.
+     * @tparam N The size of the buffer used for in-place storage.
+     * @tparam Dispatch The dispatch policy of the constructed `kmillet::sized_any`.
+     * @tparam Variant A specialization of `std::variant`, possibly cv- and reference-qualified, whose alternatives, other than `std::monostate`, are copy constructible.
+     * @param variant The variant whose active alternative is moved or copied, depending on the value category of `variant`.
+     * @return A `kmillet::sized_any<N, Dispatch>` holding the active alternative of `variant`. The result is empty if `variant` holds
+     * `std::monostate` or is valueless by exception.
+     * @details No dynamic allocation will occur if the active alternative satisfies `kmillet::sized_any_optimized<N>`.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch, class Variant>
+    requires(N >= sizeof(void*) && details::sized_any_variant::storable<std::remove_cvref_t<Variant>>::value)
+    sized_any<N, Dispatch> from_variant(Variant&& variant);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class Variant, std::size_t N, class Dispatch>
+requires(kmillet::details::sized_any_variant::storable<Variant>::value)
+inline std::optional<Variant> kmillet::to_variant(kmillet::sized_any<N, Dispatch>&& operand)
+{
+    using alternatives = kmillet::details::sized_any_variant::alternatives<Variant, Dispatch>;
+    const std::size_t index = alternatives::index::find(kmillet::details::sized_any::access::info(operand));
+    if (index == alternatives::index::size) return std::nullopt;
+    std::optional<Variant> result(alternatives::template converters<kmillet::sized_any<N, Dispatch>>[index](operand));
+    operand.reset();
+    return result;
+}
+template <class Variant, std::size_t N, class Dispatch>
+requires(kmillet::details::sized_any_variant::storable<Variant>::value)
+inline std::optional<Variant> kmillet::to_variant(const kmillet::sized_any<N, Dispatch>& operand)
+{
+    using alternatives = kmillet::details::sized_any_variant::alternatives<Variant, Dispatch>;
+    const std::size_t index = alternatives::index::find(kmillet::details::sized_any::access::info(operand));
+    if (index == alternatives::index::size) return std::nullopt;
+    return alternatives::template converters<const kmillet::sized_any<N, Dispatch>>[index](operand);
+}
+
+template <std::size_t N, class Dispatch, class Variant>
+requires(N >= sizeof(void*) && kmillet::details::sized_any_variant::storable<std::remove_cvref_t<Variant>>::value)
+inline kmillet::sized_any<N, Dispatch> kmillet::from_variant(Variant&& variant)
+{
+    if (variant.valueless_by_exception()) return {};
+    return std::visit([](auto&& alternative) -> kmillet::sized_any<N, Dispatch>
+    {
+        using T = std::decay_t<decltype(alternative)>;
+        if constexpr (std::is_same_v<T, std::monostate>) return {};
+        else return kmillet::sized_any<N, Dispatch>(std::in_place_type<T>, std::forward<decltype(alternative)>(alternative));
+    }, std::forward<Variant>(variant));
+}
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_any_visit.hpp
+ * @author Kenan Millet
+ * @brief Double dispatch over the contents of two `kmillet::sized_any<N>` objects through a two-dimensional jump table.
+ *
+ * This header provides `kmillet::visit2` and `kmillet::visit2_symmetric`.
+ * - The contained type of each operand is mapped to its index in a `kmillet::type_list` through a hash table of type information
+ *   pointers, in constant time however long the list is, without `kmillet::any_cast` or `std::type_info` comparisons.
+ * - The pair of indices selects an entry of a table of function pointers generated at compile time, so a visit costs
+ *   one indirect call however many pairs of types are supported.
+ * - Pairs of types that the visitor does not accept, and contained types that are not in the list, are routed to a fallback.
+ * - `kmillet::visit2_symmetric` additionally folds a pair `(A, B)` that the visitor only accepts as `(B, A)` onto that order.
+ *
+ * @section Usage
+ * @code
+ * using shapes = kmillet::type_list<circle, square>;
+ * auto collide = kmillet::overloaded{
+ *     [](const circle&, const circle&) { return true; },
+ *     [](const circle&, const square&) { return false; },
+ * };
+ * bool hit = kmillet::visit2_symmetric<shapes>(collide, [](auto&, auto&) { return false; }, a, b); // square/circle is folded onto circle/square
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <array>
+#include <concepts>    // for invocable
+#include <functional>  // for invoke
+#include <tuple>       // for tuple, tuple_element_t
+#include <type_traits> // for conditional_t, invoke_result_t, is_const_v, remove_const_t
+#include <utility>     // for index_sequence
+#include <cstddef>     // for size_t
+
+namespace kmillet
+{
+    /**
+     * @brief A list of types, used to name the types that a visit supports.
+     * @tparam Ts The types.
+     */
+    template<class... Ts> struct type_list {};
+
+    /**
+     * @brief Combines several callables into one overload set.
+     * @tparam Fs The types of the callables.
+     */
+    template<class... Fs> struct overloaded : Fs... { using Fs::operator()...; };
+    template<class... Fs> overloaded(Fs...) -> overloaded<Fs...>;
+}
+
+// Private utilities for kmillet::visit2
+namespace kmillet::details::sized_any_visit
+{
+    template<class Any> struct any_traits;
+    template<std::size_t N, class Dispatch> struct any_traits<::kmillet::sized_any<N, Dispatch>> { using dispatch = Dispatch; };
+    template<std::size_t N, class Dispatch> struct any_traits<const ::kmillet::sized_any<N, Dispatch>> { using dispatch = Dispatch; };
+
+    template<class Any>
+    concept sized_any_lvalue = requires { typename any_traits<Any>::dispatch; };
+
+    template<class TypeList> struct list_traits;
+    template<class... Ts>
+    struct list_traits<::kmillet::type_list<Ts...>>
+    {
+        static constexpr std::size_t size = sizeof...(Ts);
+        template<std::size_t I> using at = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+        // Returns the index of the first type of the list that `operand` contains, or `size` if there is none, in constant time.
+        template<class Any>
+        static std::size_t index(const Any& operand) noexcept
+        {
+            return sized_any::info_index<typename any_traits<Any>::dispatch, Ts...>::find(sized_any::access::info(operand));
+        }
+    };
+
+    template<class Any, class T>
+    using element = std::conditional_t<std::is_const_v<Any>, const T, T>;
+
+    // The table has one more row and column than there are types, for operands whose contained type is not in the list.
+    template<class TypeList, bool Symmetric, class R, class F, class Fallback, class A, class B>
+    struct table
+    {
+        using list = list_traits<TypeList>;
+        static constexpr std::size_t width = list::size + 1;
+
+        template<std::size_t I, std::size_t J>
+        static R Entry(F& f, Fallback& fallback, A& a, B& b)
+        {
+            if constexpr (I == list::size || J == list::size) return static_cast<R>(std::invoke(fallback, a, b));
+            else
+            {
+                using TA = element<A, typename list::template at<I>>;
+                using TB = element<B, typename list::template at<J>>;
+                if constexpr (std::invocable<F&, TA&, TB&>)
+                {
+                    return static_cast<R>(std::invoke(f, sized_any::access::unchecked<typename list::template at<I>>(a), sized_any::access::unchecked<typename list::template at<J>>(b)));
+                }
+                else if constexpr (Symmetric && std::invocable<F&, TB&, TA&>)
+                {
+                    return static_cast<R>(std::invoke(f, sized_any::access::unchecked<typename list::template at<J>>(b), sized_any::access::unchecked<typename list::template at<I>>(a)));
+                }
+                else return static_cast<R>(std::invoke(fallback, a, b));
+            }
+        }
+
+        template<std::size_t... K>
+        static constexpr std::array<R (*)(F&, Fallback&, A&, B&), sizeof...(K)> Make(std::index_sequence<K...>) noexcept
+        {
+            return {&Entry<K / width, K % width>...};
+        }
+
+        static constexpr auto entries = Make(std::make_index_sequence<width * width>{});
+    };
+}
+
+namespace kmillet
+{
+    /**
+     * @brief Invokes `f` with references to the contents of `a` and `b`, dispatching on both contained types through a jump table.
+     * @tparam TypeList A `kmillet::type_list` of the types that `f` may be invoked with.
+     * @tparam F The type of the visitor.
+     * @tparam Fallback The type of the fallback.
+     * @tparam A A specialization of `kmillet::sized_any`, possibly const.
+     * @tparam B A specialization of `kmillet::sized_any`, possibly const.
+     * @param f The visitor, invoked as `f(x, y)` where `x` and `y` are the contents of `a` and `b`, if it accepts them.
+     * @param fallback Invoked as `fallback(a, b)` if a contained type is not in `TypeList` (including if an operand is empty)
+     * or if `f` does not accept the pair of contents.
+     * @param a The first operand.
+     * @param b The second operand.
+     * @return The result of the invocation, converted to the result type of `fallback`.
+     */
+    template<class TypeList, class F, class Fallback, class A, class B>
+    requires(details::sized_any_visit::sized_any_lvalue<A> && details::sized_any_visit::sized_any_lvalue<B> && std::invocable<Fallback&, A&, B&>)
+    std::invoke_result_t<Fallback&, A&, B&> visit2(F&& f, Fallback&& fallback, A& a, B& b);
+    /**
+     * @brief Like `kmillet::visit2`, but if `f` does not accept the contents of `a` and `b` in that order, they are passed in reverse order if `f` accepts that.
+     * @tparam TypeList A `kmillet::type_list` of the types that `f` may be invoked with.
+     * @tparam F The type of the visitor.
+     * @tparam Fallback The type of the fallback.
+     * @tparam A A specialization of `kmillet::sized_any`, possibly const.
+     * @tparam B A specialization of `kmillet::sized_any`, possibly const.
+     * @param f The visitor, which should implement a symmetric operation.
+     * @param fallback Invoked as `fallback(a, b)` if a contained type is not in `TypeList` or if `f` accepts the pair of contents in neither order.
+     * @param a The first operand.
+     * @param b The second operand.
+     * @return The result of the invocation, converted to the result type of `fallback`.
+     */
+    template<class TypeList, class F, class Fallback, class A, class B>
+    requires(details::sized_any_visit::sized_any_lvalue<A> && details::sized_any_visit::sized_any_lvalue<B> && std::invocable<Fallback&, A&, B&>)
+    std::invoke_result_t<Fallback&, A&, B&> visit2_symmetric(F&& f, Fallback&& fallback, A& a, B& b);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <class TypeList, class F, class Fallback, class A, class B>
+requires(kmillet::details::sized_any_visit::sized_any_lvalue<A> && kmillet::details::sized_any_visit::sized_any_lvalue<B> && std::invocable<Fallback&, A&, B&>)
+inline std::invoke_result_t<Fallback&, A&, B&> kmillet::visit2(F&& f, Fallback&& fallback, A& a, B& b)
+{
+    using list = kmillet::details::sized_any_visit::list_traits<TypeList>;
+    using table = kmillet::details::sized_any_visit::table<TypeList, false, std::invoke_result_t<Fallback&, A&, B&>, std::remove_reference_t<F>, std::remove_reference_t<Fallback>, A, B>;
+    return table::entries[list::index(a) * table::width + list::index(b)](f, fallback, a, b);
+}
+template <class TypeList, class F, class Fallback, class A, class B>
+requires(kmillet::details::sized_any_visit::sized_any_lvalue<A> && kmillet::details::sized_any_visit::sized_any_lvalue<B> && std::invocable<Fallback&, A&, B&>)
+inline std::invoke_result_t<Fallback&, A&, B&> kmillet::visit2_symmetric(F&& f, Fallback&& fallback, A& a, B& b)
+{
+    using list = kmillet::details::sized_any_visit::list_traits<TypeList>;
+    using table = kmillet::details::sized_any_visit::table<TypeList, true, std::invoke_result_t<Fallback&, A&, B&>, std::remove_reference_t<F>, std::remove_reference_t<Fallback>, A, B>;
+    return table::entries[list::index(a) * table::width + list::index(b)](f, fallback, a, b);
+}
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_task.hpp
+ * @author Kenan Millet
+ * @brief A type-erased `void()` callable that stores its target in a `kmillet::sized_any<N>` buffer.
+ *
+ * This header provides the `kmillet::sized_task<N>` class template, an alternative to `std::function<void()>` for task queues.
+ * - Callables up to `N` bytes in size that are noexcept-movable are stored in-place, so queuing them does not allocate.
+ * - Larger or non-noexcept-movable callables spill to the heap exactly as they would in a `kmillet::sized_any<N>`.
+ * - Moving a `kmillet::sized_task<N>` never allocates, which makes it suitable as the slot type of a lock-free or work-stealing deque.
+ *
+ * @section Usage
+ * @code
+ * std::vector<kmillet::sized_task<32>> tasks;
+ * tasks.emplace_back([&counter] { ++counter; }); // stored in-place since the lambda only captures a reference
+ * for (auto& task : tasks) task(); // invokes the stored lambda
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_any.hpp>
+
+#include <concepts>    // for invocable, copy_constructible
+#include <type_traits> // for decay_t, is_nothrow_constructible_v
+#include <utility>     // for exchange, forward, move
+#include <cstddef>     // for size_t
+
+// Forward declaration of kmillet::sized_task
+namespace kmillet
+{
+    template <std::size_t N, class Dispatch = default_dispatch> class sized_task;
+}
+
+// Private utilities for kmillet::sized_task
+namespace kmillet::details::sized_task
+{
+    // Used to exclude the callable constructor of `kmillet::sized_task<N>`
+    // from overload resolution when the argument is a specialization of `kmillet::sized_task`.
+    template<class T> struct is_sized_task : std::false_type {};
+    template<std::size_t N, class Dispatch> struct is_sized_task<::kmillet::sized_task<N, Dispatch>> : std::true_type {};
+}
+
+namespace kmillet
+{
+    /**
+     * @brief A type-erased `void()` callable whose target is stored in a `kmillet::sized_any<N, Dispatch>`.
+     *
+     * Intended as the task type of thread pools and schedulers that would otherwise store `std::function<void()>`.
+     * - No heap allocation for callables up to `N` bytes in size that are noexcept-movable; otherwise, heap allocation is used.
+     * - Moving never allocates and leaves the source empty.
+     * @tparam N The size of the buffer used for in-place storage of the callable.
+     * @tparam Dispatch The dispatch policy of the underlying `kmillet::sized_any`.
+     */
+    template<std::size_t N, class Dispatch>
+    class sized_task
+    {
+    public:
+        /**
+         * @brief Constructs an empty task.
+         */
+        constexpr sized_task() noexcept = default;
+        /**
+         * @brief Copies the callable of `other` into a new instance.
+         * @param other The `kmillet::sized_task<N>` to copy.
+         */
+        sized_task(const sized_task& other) = default;
+        /**
+         * @brief Moves the callable of `other` into a new instance.
+         * @param other The `kmillet::sized_task<N>` to move.
+         * @details Leaves `other` empty. No dynamic allocation will occur.
+         */
+        sized_task(sized_task&& other) noexcept;
+        /**
+         * @brief Constructs a task whose target is `std::decay_t<F>`, direct-initialized from `std::forward<F>(f)`.
+         * @tparam F The type of the callable.
+         * @param f The callable to be stored.
+         * @details Requires that `std::decay_t<F>` is not a specialization of `kmillet::sized_task`, is copy-constructible and is invocable as an lvalue.
+         * Noexcept so long as constructing `std::decay_t<F>` from `std::forward<F>(f)` is noexcept and `kmillet::sized_any_optimized<F, N>` is satisfied.
+         */
+        template<class F>
+        requires(!details::sized_task::is_sized_task<std::decay_t<F>>::value && std::copy_constructible<std::decay_t<F>> && std::invocable<std::decay_t<F>&>)
+        sized_task(F&& f) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F> && sized_any_optimized<F, N>);
+
+        /**
+         * @brief Assigns by copying the callable of `rhs`.
+         * @param rhs The `kmillet::sized_task<N>` to copy.
+         * @return A reference to `*this`.
+         */
+        sized_task& operator=(const sized_task& rhs) = default;
+        /**
+         * @brief Assigns by moving the callable of `rhs`.
+         * @param rhs The `kmillet::sized_task<N>` to move.
+         * @return A reference to `*this`.
+         * @details Leaves `rhs` empty. No dynamic allocation will occur.
+         */
+        sized_task& operator=(sized_task&& rhs) noexcept;
+
+        /**
+         * @brief Invokes the stored callable.
+         * @details The behavior is undefined if `*this` is empty.
+         */
+        void operator()();
+
+        /**
+         * @brief Destroys the stored callable, if any.
+         */
+        void reset() noexcept;
+        /**
+         * @brief Gets the in-place storage capacity of the `kmillet::sized_task<N>` instance.
+         * @return The size of the buffer (in bytes) used to hold the callable, which is `N`.
+         */
+        [[nodiscard]] static constexpr std::size_t capacity() noexcept { return N; }
+        /**
+         * @brief Checks whether the task holds a callable.
+         * @returns `true` if and only if the task is non-empty, otherwise returns `false`.
+         */
+        [[nodiscard]] explicit operator bool() const noexcept { return invoker != nullptr; }
+
+    private:
+        template<class F>
+        static void Invoke(sized_any<N, Dispatch>& callable);
+
+    // Member variables
+        sized_any<N, Dispatch> callable;
+        void (*invoker)(sized_any<N, Dispatch>&) = nullptr;
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_task<N, Dispatch>::sized_task(kmillet::sized_task<N, Dispatch>&& other) noexcept
+    : callable(std::move(other.callable))
+    , invoker(std::exchange(other.invoker, nullptr))
+{}
+template <std::size_t N, class Dispatch>
+template <class F>
+requires(!kmillet::details::sized_task::is_sized_task<std::decay_t<F>>::value && std::copy_constructible<std::decay_t<F>> && std::invocable<std::decay_t<F>&>)
+inline kmillet::sized_task<N, Dispatch>::sized_task(F&& f) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F> && kmillet::sized_any_optimized<F, N>)
+    : callable(std::in_place_type<std::decay_t<F>>, std::forward<F>(f))
+    , invoker(&Invoke<std::decay_t<F>>)
+{}
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_task<N, Dispatch>& kmillet::sized_task<N, Dispatch>::operator=(kmillet::sized_task<N, Dispatch>&& rhs) noexcept
+{
+    if (&rhs == this) return *this;
+    callable = std::move(rhs.callable);
+    invoker = std::exchange(rhs.invoker, nullptr);
+    return *this;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task<N, Dispatch>::operator()()
+{
+    invoker(callable);
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task<N, Dispatch>::reset() noexcept
+{
+    callable.reset();
+    invoker = nullptr;
+}
+
+template <std::size_t N, class Dispatch>
+template <class F>
+inline void kmillet::sized_task<N, Dispatch>::Invoke(kmillet::sized_any<N, Dispatch>& callable)
+{
+    kmillet::details::sized_any::access::unchecked<F>(callable)();
+}
@@ -0,0 +1,501 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/**
+ * @file sized_task_scheduler.hpp
+ * @author Kenan Millet
+ * @brief A work-stealing thread pool that runs `kmillet::sized_task<N>` tasks without allocating for each of them.
+ *
+ * This header provides the `kmillet::sized_task_scheduler<N>` class template, an alternative to a thread pool with a locked queue of `std::function<void()>`.
+ * - Each worker owns a Chase-Lev deque. Tasks submitted by a task go to the bottom of its worker's deque, which that worker pops without locking.
+ * - A worker whose deque is empty takes a batch of tasks from the queue of tasks submitted from other threads, or steals a batch
+ *   of up to half of the tasks of another worker, so that it does not come back to them for every task.
+ * - Workers that find no work spin briefly, then park until a task is submitted. Submitting only wakes a worker if one is parked.
+ * - Tasks live in nodes that are recycled through a pool owned by the worker that ran them, and callables are stored in-place
+ *   in the node's `kmillet::sized_task<N>`, so that in the steady state submitting a task from a task does not allocate,
+ *   unless its callable is larger than `N` bytes.
+ *
+ * @section Usage
+ * @code
+ * kmillet::sized_task_scheduler<32> scheduler;                   // one worker per hardware thread
+ * std::atomic<int> sum = 0;
+ * scheduler.submit([&] {
+ *     for (int i = 0; i < 1000; ++i) scheduler.submit([&sum, i] { sum += i; }); // pushed to this worker's deque
+ * });
+ * scheduler.wait();                                              // returns once every task, including those submitted by tasks, has run
+ * @endcode
+ *
+ * @section License
+ * Licensed under the Apache License, Version 2.0 with LLVM Exceptions.
+ * See the LICENSE file in the root of this repository for complete details.
+ */
+
+#pragma once
+
+#include <kmillet/sized_any/sized_task.hpp>
+
+#include <algorithm>   // for max, min
+#include <atomic>      // for atomic, atomic_thread_fence, memory_order
+#include <concepts>    // for constructible_from
+#include <cstdint>     // for int64_t, uint32_t, uint64_t
+#include <deque>
+#include <memory>      // for unique_ptr, make_unique
+#include <mutex>       // for mutex, lock_guard
+#include <thread>      // for thread, this_thread
+#include <utility>     // for forward, move
+#include <vector>
+#include <cstddef>     // for size_t
+
+// Private utilities for kmillet::sized_task_scheduler
+namespace kmillet::details::sized_task_scheduler
+{
+    // A circular array of pointers, replaced by one twice as large when the deque that owns it is full.
+    template<class T>
+    struct ring
+    {
+        explicit ring(std::size_t capacity) : mask(capacity - 1), slots(std::make_unique<std::atomic<T*>[]>(capacity)) {}
+        std::size_t capacity() const noexcept { return mask + 1; }
+        T* get(std::int64_t i) const noexcept { return slots[static_cast<std::size_t>(i) & mask].load(std::memory_order_relaxed); }
+        void put(std::int64_t i, T* item) noexcept { slots[static_cast<std::size_t>(i) & mask].store(item, std::memory_order_relaxed); }
+
+        std::size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> slots;
+    };
+
+    // The Chase-Lev work-stealing deque, with the memory orderings of Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+    // Only the owner may call reserve, push, pop and room; any thread may call steal and size.
+    // Replaced rings are kept until the deque is destroyed, since a thief may still be reading from one.
+    template<class T>
+    class deque
+    {
+    public:
+        explicit deque(std::size_t capacity = 256) { rings.push_back(std::make_unique<ring<T>>(capacity)); array.store(rings.back().get(), std::memory_order_relaxed); }
+
+        // Makes room for one more item, so that the next push cannot fail.
+        void reserve()
+        {
+            const std::int64_t b = bottom.load(std::memory_order_relaxed);
+            const std::int64_t t = top.load(std::memory_order_acquire);
+            ring<T>* a = array.load(std::memory_order_relaxed);
+            if (b - t < static_cast<std::int64_t>(a->capacity())) return;
+            rings.reserve(rings.size() + 1);
+            auto grown = std::make_unique<ring<T>>(a->capacity() * 2);
+            for (std::int64_t i = t; i != b; ++i) grown->put(i, a->get(i));
+            array.store(grown.get(), std::memory_order_release);
+            rings.push_back(std::move(grown));
+        }
+        // Requires room, from reserve or room.
+        void push(T* item) noexcept
+        {
+            const std::int64_t b = bottom.load(std::memory_order_relaxed);
+            array.load(std::memory_order_relaxed)->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        T* pop() noexcept
+        {
+            const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            ring<T>* a = array.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = top.load(std::memory_order_relaxed);
+            T* item = nullptr;
+            if (t <= b)
+            {
+                item = a->get(b);
+                if (t != b) return item;
+                // The last item may be stolen at the same time, so it goes to whoever advances the top first.
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return item;
+        }
+        // Returns nullptr if the deque is empty or another thief took the top item first.
+        T* steal() noexcept
+        {
+            std::int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return nullptr;
+            T* item = array.load(std::memory_order_acquire)->get(t);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+            return item;
+        }
+        // The number of items that can be pushed without reserving.
+        std::size_t room() const noexcept
+        {
+            return array.load(std::memory_order_relaxed)->capacity() - size();
+        }
+        std::size_t size() const noexcept
+        {
+            const std::int64_t b = bottom.load(std::memory_order_relaxed);
+            const std::int64_t t = top.load(std::memory_order_relaxed);
+            return b > t ? static_cast<std::size_t>(b - t) : 0;
+        }
+
+    private:
+        alignas(64) std::atomic<std::int64_t> top{0};
+        alignas(64) std::atomic<std::int64_t> bottom{0};
+        std::atomic<ring<T>*> array{nullptr};
+        std::vector<std::unique_ptr<ring<T>>> rings;
+    };
+}
+
+namespace kmillet
+{
+    /**
+     * @brief A fixed set of worker threads that run `kmillet::sized_task<N, Dispatch>` tasks, balancing them by work stealing.
+     * @tparam N The size of the buffer used for in-place storage of each task's callable.
+     * @tparam Dispatch The dispatch policy of each task.
+     * @details `submit` may be called concurrently from any thread, including from tasks. Tasks must not throw:
+     * an exception that escapes a task terminates the program, as it would from a `std::thread`.
+     */
+    template<std::size_t N, class Dispatch = default_dispatch>
+    class sized_task_scheduler
+    {
+    public:
+        /**
+         * @brief The type of the tasks.
+         */
+        using task_type = sized_task<N, Dispatch>;
+
+        /**
+         * @brief Starts the workers.
+         * @param workers The number of worker threads, at least `1`.
+         * @param poolCapacity The maximum number of task nodes that each worker keeps for reuse.
+         */
+        explicit sized_task_scheduler(std::size_t workers = std::thread::hardware_concurrency(), std::size_t poolCapacity = 4096);
+        sized_task_scheduler(const sized_task_scheduler&) = delete;
+        sized_task_scheduler& operator=(const sized_task_scheduler&) = delete;
+        /**
+         * @brief Waits for every submitted task to run, then stops and joins the workers.
+         */
+        ~sized_task_scheduler();
+
+        /**
+         * @brief Submits a task, whose callable is constructed from `std::forward<F>(f)`.
+         * @tparam F The type of the callable.
+         * @param f The callable.
+         * @details From a task running on one of this scheduler's workers, the task is pushed to that worker's deque and, once the worker's pool
+         * has nodes to reuse, does not allocate unless the callable is larger than `N` bytes. From any other thread, the task is appended
+         * to a locked queue that idle workers take batches from.
+         */
+        template<class F>
+        requires(std::constructible_from<task_type, F>)
+        void submit(F&& f);
+        /**
+         * @brief Blocks until every submitted task, including those submitted by tasks while waiting, has run.
+         * @details Must not be called from a task, since the task itself would never finish.
+         */
+        void wait() const noexcept;
+
+        /**
+         * @brief Gets the number of workers.
+         * @return The number of worker threads.
+         */
+        [[nodiscard]] std::size_t size() const noexcept { return workerCount; }
+
+    private:
+        struct node
+        {
+            task_type task;
+            node* next = nullptr;
+        };
+        struct alignas(64) worker
+        {
+            details::sized_task_scheduler::deque<node> tasks;
+            node* pool = nullptr;       // recycled nodes, only used by this worker
+            std::size_t pooled = 0;
+            std::uint64_t random = 0;   // the xorshift state used to pick victims
+            sized_task_scheduler* owner = nullptr;
+        };
+
+        // The number of tasks taken at once from another worker or from the submission queue.
+        static constexpr std::size_t stealBatch = 32;
+        // The number of unsuccessful searches for work before a worker parks.
+        static constexpr unsigned idleSpins = 64;
+
+        void Run(worker& self);
+        node* Find(worker& self);
+        node* Steal(worker& self) noexcept;
+        node* TakeSubmitted(worker& self);
+        void Execute(worker& self, node* n) noexcept;
+        void Park() noexcept;
+        [[nodiscard]] bool HasWork() const noexcept;
+        void Wake() noexcept;
+        void Stop() noexcept;
+        node* Acquire(worker& self);
+        void Recycle(worker& self, node* n) noexcept;
+
+        static inline thread_local worker* current = nullptr;
+
+    // Member variables
+        std::unique_ptr<worker[]> workers;
+        std::size_t workerCount;
+        std::size_t poolCapacity;
+        std::vector<std::thread> threads;
+        std::mutex submittedMutex;
+        std::deque<node*> submitted;   // tasks submitted from outside the workers, guarded by submittedMutex
+        std::atomic<std::size_t> submittedCount{0};
+        alignas(64) std::atomic<std::size_t> pending{0};
+        alignas(64) std::atomic<std::uint32_t> epoch{0};
+        std::atomic<std::uint32_t> sleepers{0};
+        std::atomic<bool> stopping{false};
+    };
+}
+
+
+
+// ----------------------------------------------------------------------------
+// Implementation details below this point.
+// ----------------------------------------------------------------------------
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_task_scheduler<N, Dispatch>::sized_task_scheduler(std::size_t workers, std::size_t poolCapacity)
+    : workers(std::make_unique<worker[]>(std::max<std::size_t>(workers, 1)))
+    , workerCount(std::max<std::size_t>(workers, 1))
+    , poolCapacity(poolCapacity)
+{
+    for (std::size_t i = 0; i < workerCount; ++i)
+    {
+        this->workers[i].random = 0x9E3779B97F4A7C15ull * (i + 1);
+        this->workers[i].owner = this;
+    }
+    threads.reserve(workerCount);
+#if defined(__cpp_exceptions)
+    try
+    {
+#endif
+        for (std::size_t i = 0; i < workerCount; ++i) threads.emplace_back([this, i] { Run(this->workers[i]); });
+#if defined(__cpp_exceptions)
+    }
+    catch (...)
+    {
+        Stop();
+        for (std::thread& thread : threads) thread.join();
+        throw;
+    }
+#endif
+}
+
+template <std::size_t N, class Dispatch>
+inline kmillet::sized_task_scheduler<N, Dispatch>::~sized_task_scheduler()
+{
+    wait();
+    Stop();
+    for (std::thread& thread : threads) thread.join();
+    for (std::size_t i = 0; i < workerCount; ++i)
+    {
+        while (node* n = workers[i].pool) delete std::exchange(workers[i].pool, n->next);
+    }
+}
+
+template <std::size_t N, class Dispatch>
+template <class F>
+requires(std::constructible_from<typename kmillet::sized_task_scheduler<N, Dispatch>::task_type, F>)
+inline void kmillet::sized_task_scheduler<N, Dispatch>::submit(F&& f)
+{
+    if (worker* self = current; self && self->owner == this)
+    {
+        node* n = Acquire(*self);
+#if defined(__cpp_exceptions)
+        try
+        {
+#endif
+            n->task = task_type(std::forward<F>(f));
+            self->tasks.reserve();
+#if defined(__cpp_exceptions)
+        }
+        catch (...)
+        {
+            Recycle(*self, n);
+            throw;
+        }
+#endif
+        pending.fetch_add(1, std::memory_order_relaxed);
+        self->tasks.push(n);
+    }
+    else
+    {
+        auto n = std::make_unique<node>();
+        n->task = task_type(std::forward<F>(f));
+        {
+            std::lock_guard lock(submittedMutex);
+            submitted.push_back(n.get());
+            submittedCount.store(submitted.size(), std::memory_order_relaxed);
+            pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        n.release();
+    }
+    Wake();
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task_scheduler<N, Dispatch>::wait() const noexcept
+{
+    for (std::size_t count = pending.load(std::memory_order_acquire); count != 0; count = pending.load(std::memory_order_acquire))
+    {
+        pending.wait(count, std::memory_order_acquire);
+    }
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task_scheduler<N, Dispatch>::Run(worker& self)
+{
+    current = &self;
+    unsigned idle = 0;
+    while (true)
+    {
+        if (node* n = Find(self))
+        {
+            Execute(self, n);
+            idle = 0;
+        }
+        else if (stopping.load(std::memory_order_acquire))
+        {
+            break;
+        }
+        else if (++idle < idleSpins)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            Park();
+            idle = 0;
+        }
+    }
+    current = nullptr;
+}
+
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_task_scheduler<N, Dispatch>::node* kmillet::sized_task_scheduler<N, Dispatch>::Find(worker& self)
+{
+    if (node* n = self.tasks.pop()) return n;
+    if (node* n = TakeSubmitted(self)) return n;
+    return Steal(self);
+}
+
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_task_scheduler<N, Dispatch>::node* kmillet::sized_task_scheduler<N, Dispatch>::Steal(worker& self) noexcept
+{
+    if (workerCount == 1) return nullptr;
+    self.random ^= self.random << 13;
+    self.random ^= self.random >> 7;
+    self.random ^= self.random << 17;
+    const std::size_t start = static_cast<std::size_t>(self.random % workerCount);
+    for (std::size_t i = 0; i < workerCount; ++i)
+    {
+        worker& victim = workers[(start + i) % workerCount];
+        if (&victim == &self) continue;
+        node* first = victim.tasks.steal();
+        if (!first) continue;
+        // Take up to half of what is left, into this worker's deque, without growing it.
+        std::size_t extra = std::min({victim.tasks.size() / 2, stealBatch - 1, self.tasks.room()});
+        std::size_t moved = 0;
+        for (; moved < extra; ++moved)
+        {
+            node* n = victim.tasks.steal();
+            if (!n) break;
+            self.tasks.push(n);
+        }
+        if (moved) Wake();
+        return first;
+    }
+    return nullptr;
+}
+
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_task_scheduler<N, Dispatch>::node* kmillet::sized_task_scheduler<N, Dispatch>::TakeSubmitted(worker& self)
+{
+    if (submittedCount.load(std::memory_order_relaxed) == 0) return nullptr;
+    node* first = nullptr;
+    std::size_t moved = 0;
+    {
+        std::lock_guard lock(submittedMutex);
+        if (submitted.empty()) return nullptr;
+        first = submitted.front();
+        submitted.pop_front();
+        for (std::size_t extra = std::min({submitted.size(), stealBatch - 1, self.tasks.room()}); moved < extra; ++moved)
+        {
+            self.tasks.push(submitted.front());
+            submitted.pop_front();
+        }
+        submittedCount.store(submitted.size(), std::memory_order_relaxed);
+    }
+    if (moved) Wake();
+    return first;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task_scheduler<N, Dispatch>::Execute(worker& self, node* n) noexcept
+{
+    n->task();
+    Recycle(self, n);
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) pending.notify_all();
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task_scheduler<N, Dispatch>::Park() noexcept
+{
+    // The epoch is read before announcing the sleep, so that a wake-up that sees this worker as a sleeper also changes the epoch it waits on.
+    const std::uint32_t seen = epoch.load(std::memory_order_seq_cst);
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!stopping.load(std::memory_order_relaxed) && !HasWork()) epoch.wait(seen, std::memory_order_seq_cst);
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template <std::size_t N, class Dispatch>
+inline bool kmillet::sized_task_scheduler<N, Dispatch>::HasWork() const noexcept
+{
+    if (submittedCount.load(std::memory_order_relaxed) != 0) return true;
+    for (std::size_t i = 0; i < workerCount; ++i)
+    {
+        if (workers[i].tasks.size() != 0) return true;
+    }
+    return false;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task_scheduler<N, Dispatch>::Wake() noexcept
+{
+    // Pairs with the fence in Park: either the parking worker sees the new task, or this sees the worker and changes the epoch.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) == 0) return;
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+    epoch.notify_one();
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task_scheduler<N, Dispatch>::Stop() noexcept
+{
+    stopping.store(true, std::memory_order_seq_cst);
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+    epoch.notify_all();
+}
+
+template <std::size_t N, class Dispatch>
+inline typename kmillet::sized_task_scheduler<N, Dispatch>::node* kmillet::sized_task_scheduler<N, Dispatch>::Acquire(worker& self)
+{
+    if (node* n = self.pool)
+    {
+        self.pool = n->next;
+        --self.pooled;
+        return n;
+    }
+    return new node;
+}
+
+template <std::size_t N, class Dispatch>
+inline void kmillet::sized_task_scheduler<N, Dispatch>::Recycle(worker& self, node* n) noexcept
+{
+    n->task.reset();
+    if (self.pooled >= poolCapacity)
+    {
+        delete n;
+        return;
+    }
+    n->next = self.pool;
+    self.pool = n;
+    ++self.pooled;
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/basic_sized_any.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+using kmillet::basic_sized_any;
+using kmillet::external_storage;
+using kmillet::sized_any;
+using kmillet::table_dispatch;
+
+namespace
+{
+    int liveObjects = 0;
+
+    struct counted
+    {
+        counted(int v) : value(v) { ++liveObjects; }
+        counted(const counted& other) : value(other.value) { ++liveObjects; }
+        counted(counted&& other) noexcept : value(other.value) { ++liveObjects; }
+        ~counted() { --liveObjects; }
+        int value;
+    };
+
+    // A storage adaptor with its own fixed-size, aligned buffer.
+    template<std::size_t N>
+    struct fixed_storage
+    {
+        std::byte* data() noexcept { return bytes.data(); }
+        std::size_t size() const noexcept { return N; }
+        alignas(std::max_align_t) std::array<std::byte, N> bytes;
+    };
+}
+
+TEST(BasicSizedAnyTest, ConstructsInExternalStorage)
+{
+    alignas(std::max_align_t) std::array<std::byte, 64> frame{};
+    {
+        basic_sized_any<external_storage> slot{external_storage(frame.data() + 16, 16)};
+        EXPECT_FALSE(slot.has_value());
+        counted& c = slot.emplace<counted>(7);
+        EXPECT_EQ(static_cast<void*>(&c), static_cast<void*>(frame.data() + 16));
+        EXPECT_EQ(slot.type(), typeid(counted));
+        EXPECT_EQ(kmillet::any_cast<counted&>(slot).value, 7);
+        EXPECT_EQ(kmillet::any_cast<int>(&slot), nullptr);
+        EXPECT_THROW(kmillet::any_cast<int>(slot), std::bad_any_cast);
+        EXPECT_EQ(liveObjects, 1);
+    }
+    EXPECT_EQ(liveObjects, 0);
+}
+
+TEST(BasicSizedAnyTest, FallsBackToHeap)
+{
+    alignas(std::max_align_t) std::array<std::byte, 8> frame{};
+    basic_sized_any<external_storage> slot(external_storage(frame), std::in_place_type<std::array<int, 8>>, std::array<int, 8>{1, 2, 3});
+    const auto* value = kmillet::any_cast<std::array<int, 8>>(&slot);
+    ASSERT_NE(value, nullptr);
+    EXPECT_NE(static_cast<const void*>(value), static_cast<void*>(frame.data()));
+    EXPECT_EQ((*value)[2], 3);
+}
+
+TEST(BasicSizedAnyTest, MisalignedStorageFallsBackToHeap)
+{
+    struct alignas(16) wide { double first, second; };
+    alignas(64) std::array<std::byte, 64> frame{};
+    basic_sized_any<external_storage> aligned(external_storage(frame.data() + 16, 32), std::in_place_type<wide>, wide{1.0, 2.0});
+    EXPECT_EQ(static_cast<const void*>(kmillet::any_cast<wide>(&aligned)), static_cast<void*>(frame.data() + 16));
+
+    basic_sized_any<external_storage> misaligned(external_storage(frame.data() + 8, 8), std::in_place_type<wide>, wide{3.0, 4.0});
+    const wide* value = kmillet::any_cast<wide>(&misaligned);
+    ASSERT_NE(value, nullptr);
+    EXPECT_NE(static_cast<const void*>(value), static_cast<void*>(frame.data() + 8));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(value) % alignof(wide), 0u);
+    EXPECT_EQ(value->second, 4.0);
+
+    // Copies and moves in and out follow the same placement, whatever the placement in the other object.
+    misaligned = aligned;
+    EXPECT_EQ(kmillet::any_cast<wide>(misaligned).first, 1.0);
+    sized_any<8> local = wide{5.0, 6.0};
+    misaligned = local;
+    EXPECT_EQ(kmillet::any_cast<wide>(misaligned).first, 5.0);
+    misaligned = std::move(local);
+    EXPECT_EQ(kmillet::any_cast<wide>(misaligned).second, 6.0);
+    sized_any<8> back = misaligned.take<8>();
+    EXPECT_EQ(kmillet::any_cast<wide>(back).second, 6.0);
+    aligned = std::move(back);
+    EXPECT_EQ(static_cast<const void*>(kmillet::any_cast<wide>(&aligned)), static_cast<void*>(frame.data() + 16));
+}
+
+TEST(BasicSizedAnyTest, MovesFromAndToSizedAny)
+{
+    alignas(std::max_align_t) std::array<std::byte, 32> frame{};
+    basic_sized_any<external_storage> slot{external_storage(frame)};
+    sized_any<16> small = std::string("a string long enough to be allocated by std::string itself");
+    slot = std::move(small);
+    EXPECT_FALSE(small.has_value());
+    EXPECT_EQ(kmillet::any_cast<const std::string&>(slot), "a string long enough to be allocated by std::string itself");
+
+    sized_any<64, table_dispatch> large = slot.take<64, table_dispatch>();
+    EXPECT_FALSE(slot.has_value());
+    EXPECT_EQ(kmillet::any_cast<const std::string&>(large), "a string long enough to be allocated by std::string itself");
+
+    slot = large;
+    EXPECT_TRUE(large.has_value());
+    EXPECT_EQ(kmillet::any_cast<std::string>(slot), kmillet::any_cast<std::string>(large));
+}
+
+TEST(BasicSizedAnyTest, CopiesBetweenStorages)
+{
+    basic_sized_any<fixed_storage<16>> a(fixed_storage<16>{}, std::in_place_type<counted>, 3);
+    basic_sized_any<fixed_storage<16>> b(fixed_storage<16>{});
+    b = a;
+    EXPECT_EQ(liveObjects, 2);
+    EXPECT_EQ(kmillet::any_cast<counted&>(b).value, 3);
+    a.reset();
+    b.reset();
+    EXPECT_EQ(liveObjects, 0);
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/command_buffer.hpp>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using kmillet::command_buffer;
+using kmillet::table_dispatch;
+
+namespace
+{
+    struct draw { int mesh; };
+    struct label { std::string text; };
+
+    int liveCommands = 0;
+
+    // Not noexcept-movable, so it is stored on the heap.
+    struct tracked
+    {
+        tracked() { ++liveCommands; }
+        tracked(const tracked&) { ++liveCommands; }
+        tracked(tracked&&) noexcept(false) { ++liveCommands; }
+        ~tracked() { --liveCommands; }
+    };
+}
+
+TEST(CommandBufferTest, ExecutesInRecordedOrder)
+{
+    command_buffer<> commands;
+    std::vector<std::string> log;
+    commands.handle<draw>([&](draw& d) { log.push_back("draw " + std::to_string(d.mesh)); });
+    commands.handle<label>([&](label& l) { log.push_back("label " + l.text); });
+    commands.record<draw>(1);
+    commands.record<label>("a string long enough to be allocated by std::string itself");
+    commands.record<draw>(2);
+    EXPECT_EQ(commands.size(), 3u);
+    EXPECT_EQ(commands.execute(), 3u);
+    EXPECT_TRUE(commands.empty());
+    EXPECT_EQ(log, (std::vector<std::string>{"draw 1", "label a string long enough to be allocated by std::string itself", "draw 2"}));
+}
+
+TEST(CommandBufferTest, ExecutesGroupedByType)
+{
+    command_buffer<table_dispatch> commands;
+    std::vector<std::string> log;
+    commands.handle<draw>([&](draw& d) { log.push_back("draw " + std::to_string(d.mesh)); });
+    commands.handle<label>([&](label& l) { log.push_back("label " + l.text); });
+    for (int i = 0; i < 20; ++i)
+    {
+        commands.record<label>(std::to_string(i));
+        commands.record<draw>(i);
+    }
+    EXPECT_EQ(commands.execute_grouped(), 40u);
+    ASSERT_EQ(log.size(), 40u);
+    EXPECT_EQ(log[0], "draw 0");
+    EXPECT_EQ(log[19], "draw 19");
+    EXPECT_EQ(log[20], "label 0");
+    EXPECT_EQ(log[39], "label 19");
+}
+
+TEST(CommandBufferTest, DiscardsUnhandledCommands)
+{
+    command_buffer<> commands;
+    int handled = 0;
+    commands.handle<draw>([&](draw&) { ++handled; });
+    commands.record<tracked>();
+    commands.record<draw>(0);
+    EXPECT_EQ(liveCommands, 1);
+    EXPECT_EQ(commands.execute(), 1u);
+    EXPECT_EQ(handled, 1);
+    EXPECT_EQ(liveCommands, 0);
+}
+
+TEST(CommandBufferTest, DestroysCommands)
+{
+    {
+        command_buffer<> commands;
+        commands.handle<tracked>([](tracked&) {});
+        for (int i = 0; i < 100; ++i) commands.record<tracked>();
+        EXPECT_EQ(liveCommands, 100);
+        commands.clear();
+        EXPECT_EQ(liveCommands, 0);
+        for (int i = 0; i < 10; ++i) commands.record<tracked>();
+    }
+    EXPECT_EQ(liveCommands, 0);
+}
+
+TEST(CommandBufferTest, HandlersMayRecord)
+{
+    command_buffer<> commands;
+    int draws = 0;
+    commands.handle<draw>([&](draw& d) {
+        ++draws;
+        if (d.mesh > 0) commands.record<draw>(d.mesh - 1);
+    });
+    commands.record<draw>(3);
+    EXPECT_EQ(commands.execute(), 1u);
+    EXPECT_EQ(commands.size(), 1u);
+    while (!commands.empty()) commands.execute();
+    EXPECT_EQ(draws, 4);
+}
+
+TEST(CommandBufferTest, ThrowingHandlerDiscardsBatch)
+{
+    command_buffer<> commands;
+    commands.handle<tracked>([](tracked&) { throw std::runtime_error("failed"); });
+    commands.record<tracked>();
+    commands.record<tracked>();
+    EXPECT_THROW(commands.execute(), std::runtime_error);
+    EXPECT_TRUE(commands.empty());
+    EXPECT_EQ(liveCommands, 0);
+}
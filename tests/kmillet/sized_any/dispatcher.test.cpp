@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/dispatcher.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using kmillet::dispatcher;
+using kmillet::sized_any;
+using kmillet::table_dispatch;
+
+namespace
+{
+    template<int I> struct tag { int value = I; };
+}
+
+TEST(DispatcherTest, DispatchesByType)
+{
+    dispatcher<32, std::string> describe([](const sized_any<32>& a) { return a.has_value() ? std::string("other") : std::string("empty"); });
+    describe.on<int>([](const int& i) { return "int " + std::to_string(i); })
+            .on<std::string>([](const std::string& s) { return "string " + s; });
+    EXPECT_EQ(describe.size(), 2u);
+    EXPECT_EQ(describe(sized_any<32>(3)), "int 3");
+    EXPECT_EQ(describe(sized_any<32>(std::string("x"))), "string x");
+    EXPECT_EQ(describe(sized_any<32>(1.5)), "other");
+    EXPECT_EQ(describe(sized_any<32>()), "empty");
+}
+
+TEST(DispatcherTest, InlineCache)
+{
+    dispatcher<16, int, table_dispatch> value;
+    value.on<tag<0>>([](const tag<0>& t) { return t.value; })
+         .on<tag<1>>([](const tag<1>& t) { return t.value; })
+         .on<tag<2>>([](const tag<2>& t) { return t.value; })
+         .on<tag<3>>([](const tag<3>& t) { return t.value; })
+         .on<tag<4>>([](const tag<4>& t) { return t.value; })
+         .on<tag<5>>([](const tag<5>& t) { return t.value; });
+    const std::vector<sized_any<16, table_dispatch>> values{tag<0>{}, tag<1>{}, tag<2>{}, tag<3>{}, tag<4>{}, tag<5>{}, 1.0};
+    dispatcher<16, int, table_dispatch>::site cache;
+    for (int round = 0; round < 3; ++round)
+    {
+        // More types than the cache remembers, so some of them always miss.
+        for (int i = 0; i < 6; ++i) EXPECT_EQ(value(cache, values[i]), i);
+        EXPECT_EQ(value(cache, values[6]), 0);
+    }
+}
+
+TEST(DispatcherTest, ReplacingAHandlerInvalidatesCaches)
+{
+    dispatcher<16, int> value;
+    value.on<int>([](const int& i) { return i; });
+    dispatcher<16, int>::site cache;
+    const sized_any<16> seven = 7;
+    EXPECT_EQ(value(cache, seven), 7);
+    EXPECT_EQ(value(cache, seven), 7);
+    value.on<int>([](const int& i) { return -i; });
+    EXPECT_EQ(value.size(), 1u);
+    EXPECT_EQ(value(cache, seven), -7);
+
+    dispatcher<16, int> other;
+    other.on<int>([](const int& i) { return i * 10; });
+    EXPECT_EQ(other(cache, seven), 70);
+    EXPECT_EQ(value(cache, seven), -7);
+}
+
+TEST(DispatcherTest, SiteOutlivesDispatchers)
+{
+    // Each dispatcher is likely constructed at the same address, with as many handlers as the previous one,
+    // so the site must not mistake its entries for those of the new dispatcher.
+    static thread_local dispatcher<16, int>::site cache;
+    const sized_any<16> seven = 7;
+    for (int round = 0; round < 4; ++round)
+    {
+        dispatcher<16, int> value;
+        value.on<int>([round](const int& i) { return i + round; });
+        EXPECT_EQ(value(cache, seven), 7 + round);
+    }
+}
+
+TEST(DispatcherTest, VoidResult)
+{
+    int sum = 0;
+    dispatcher<16> add;
+    add.on<int>([&](const int& i) { sum += i; });
+    for (int i = 1; i <= 4; ++i) add(sized_any<16>(i));
+    add(sized_any<16>(1.0));
+    EXPECT_EQ(sum, 10);
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/dynamic_record.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using kmillet::dynamic_record;
+using kmillet::record_schema;
+
+namespace
+{
+    int throwAfter = -1;
+
+    struct Fragile
+    {
+        Fragile()
+        {
+            if (throwAfter == 0) throw std::runtime_error("construction failed");
+            if (throwAfter > 0) --throwAfter;
+        }
+        Fragile(const Fragile&) : Fragile() {}
+    };
+
+    int liveTrackers = 0;
+
+    struct Tracker
+    {
+        Tracker() { ++liveTrackers; }
+        Tracker(const Tracker&) { ++liveTrackers; }
+        ~Tracker() { --liveTrackers; }
+    };
+}
+
+TEST(DynamicRecordTest, PackedLayout)
+{
+    record_schema schema;
+    EXPECT_EQ(schema.add<char>(), 0u);
+    EXPECT_EQ(schema.add<double>(), 1u);
+    EXPECT_EQ(schema.add<char>(), 2u);
+    EXPECT_EQ(schema.size(), 3u);
+    EXPECT_EQ(schema.record_size(), sizeof(double) * 2 + 1);
+    EXPECT_EQ(schema.record_alignment(), alignof(double));
+    EXPECT_EQ(schema.type(1), typeid(double));
+}
+
+TEST(DynamicRecordTest, GetAndSet)
+{
+    record_schema schema;
+    const std::size_t id = schema.add<int>();
+    const std::size_t name = schema.add<std::string>();
+    auto shared = std::make_shared<const record_schema>(std::move(schema));
+    dynamic_record row(shared);
+    EXPECT_EQ(row.get<int>(id), 0);
+    EXPECT_EQ(row.get<std::string>(name), "");
+    row.get<int>(id) = 7;
+    row.get<std::string>(name) = "seven";
+    const dynamic_record& view = row;
+    EXPECT_EQ(view.get<int>(id), 7);
+    EXPECT_EQ(view.get<std::string>(name), "seven");
+    EXPECT_EQ(row.get_if<double>(id), nullptr);
+    EXPECT_THROW(row.get<double>(id), std::bad_any_cast);
+}
+
+TEST(DynamicRecordTest, CopyAndMove)
+{
+    record_schema schema;
+    schema.add<std::string>();
+    schema.add<Tracker>();
+    auto shared = std::make_shared<const record_schema>(std::move(schema));
+    {
+        dynamic_record a(shared);
+        a.get<std::string>(0) = "a long string that does not fit any small buffer";
+        dynamic_record b = a;
+        EXPECT_EQ(b.get<std::string>(0), a.get<std::string>(0));
+        EXPECT_EQ(liveTrackers, 2);
+        dynamic_record c = std::move(a);
+        EXPECT_EQ(c.get<std::string>(0), b.get<std::string>(0));
+        EXPECT_EQ(liveTrackers, 2);
+        a = c;
+        EXPECT_EQ(a.get<std::string>(0), c.get<std::string>(0));
+        EXPECT_EQ(liveTrackers, 3);
+        b = std::move(c);
+        EXPECT_EQ(liveTrackers, 2);
+    }
+    EXPECT_EQ(liveTrackers, 0);
+}
+
+TEST(DynamicRecordTest, TrivialFieldsAreCopied)
+{
+    record_schema schema;
+    schema.add<int>();
+    schema.add<double>();
+    auto shared = std::make_shared<const record_schema>(std::move(schema));
+    dynamic_record a(shared);
+    a.get<int>(0) = 3;
+    a.get<double>(1) = 0.5;
+    dynamic_record b = a;
+    EXPECT_EQ(b.get<int>(0), 3);
+    EXPECT_EQ(b.get<double>(1), 0.5);
+}
+
+TEST(DynamicRecordTest, ConstructionFailureDestroysFields)
+{
+    record_schema schema;
+    schema.add<Tracker>();
+    schema.add<Fragile>();
+    schema.add<Tracker>();
+    auto shared = std::make_shared<const record_schema>(std::move(schema));
+    throwAfter = 0;
+    EXPECT_THROW(dynamic_record{shared}, std::runtime_error);
+    EXPECT_EQ(liveTrackers, 0);
+    throwAfter = -1;
+}
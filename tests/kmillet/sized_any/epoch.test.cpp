@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/epoch.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace epoch = kmillet::details::epoch;
+
+namespace
+{
+    struct tracked
+    {
+        static inline std::atomic<int> alive = 0;
+        tracked() { ++alive; }
+        ~tracked() { --alive; }
+    };
+}
+
+TEST(EpochTest, ReclaimsRightAwayWithoutReaders)
+{
+    epoch::retired_list retired;
+    retired.reserve();
+    retired.retire(new tracked);
+    EXPECT_EQ(tracked::alive.load(), 1);
+    retired.reclaim();
+    EXPECT_EQ(tracked::alive.load(), 0);
+}
+
+TEST(EpochTest, WaitsForReaders)
+{
+    epoch::retired_list retired;
+    std::atomic<bool> pinned = false, release = false;
+    std::thread reader([&] {
+        epoch::guard pin;
+        {
+            epoch::guard nested; // leaving a nested guard keeps the thread pinned
+        }
+        pinned = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!pinned) std::this_thread::yield();
+    retired.reserve();
+    retired.retire(new tracked);
+    retired.reclaim();
+    EXPECT_EQ(tracked::alive.load(), 1); // the reader may have loaded it before it was retired
+    release = true;
+    reader.join();
+    retired.reclaim();
+    EXPECT_EQ(tracked::alive.load(), 0);
+}
+
+TEST(EpochTest, DestroysTheRestWithTheList)
+{
+    {
+        epoch::retired_list retired;
+        epoch::guard pin; // keeps the objects from being reclaimed
+        for (int i = 0; i < 3; ++i)
+        {
+            retired.reserve();
+            retired.retire(new tracked);
+        }
+        retired.reclaim();
+        EXPECT_EQ(tracked::alive.load(), 3);
+    }
+    EXPECT_EQ(tracked::alive.load(), 0);
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/lazy_sized_any.hpp>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using kmillet::lazy_sized_any;
+using kmillet::any_cast;
+
+TEST(LazySizedAnyTest, Empty)
+{
+    lazy_sized_any<32> a;
+    EXPECT_FALSE(a.has_value());
+    EXPECT_TRUE(a.materialized());
+    EXPECT_EQ(a.type(), typeid(void));
+}
+
+TEST(LazySizedAnyTest, TypeDoesNotMaterialize)
+{
+    int calls = 0;
+    lazy_sized_any<32> a([&calls] { ++calls; return 42; });
+    EXPECT_TRUE(a.has_value());
+    EXPECT_FALSE(a.materialized());
+    EXPECT_EQ(a.type(), typeid(int));
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(LazySizedAnyTest, MaterializesOnce)
+{
+    int calls = 0;
+    lazy_sized_any<32> a([&calls] { ++calls; return 42; });
+    EXPECT_EQ(any_cast<int>(a), 42);
+    EXPECT_TRUE(a.materialized());
+    EXPECT_EQ(any_cast<int&>(a), 42);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(a.value().type(), typeid(int));
+}
+
+TEST(LazySizedAnyTest, TypeFollowsValueChanges)
+{
+    lazy_sized_any<32> a([] { return 42; });
+    a.value().emplace<double>(1.5);
+    EXPECT_EQ(a.type(), typeid(double));
+    EXPECT_EQ(any_cast<double>(a), 1.5);
+    a.value().reset();
+    EXPECT_EQ(a.type(), typeid(void));
+}
+
+TEST(LazySizedAnyTest, MismatchDoesNotMaterialize)
+{
+    int calls = 0;
+    lazy_sized_any<32> a([&calls] { ++calls; return 42; });
+    EXPECT_EQ(any_cast<double>(&a), nullptr);
+    EXPECT_THROW(any_cast<std::string>(a), std::bad_any_cast);
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(LazySizedAnyTest, DeclaredType)
+{
+    lazy_sized_any<64> a(std::in_place_type<std::string>, [] { return "declared"; });
+    EXPECT_EQ(a.type(), typeid(std::string));
+    EXPECT_FALSE(a.materialized());
+    EXPECT_EQ(any_cast<const std::string&>(a), "declared");
+}
+
+TEST(LazySizedAnyTest, HeapValue)
+{
+    lazy_sized_any<16> a([] { return std::vector<int>(100, 7); });
+    auto* v = any_cast<std::vector<int>>(&a);
+    ASSERT_NE(v, nullptr);
+    EXPECT_EQ(v->size(), 100);
+}
+
+TEST(LazySizedAnyTest, CopyAndMoveKeepFactory)
+{
+    int calls = 0;
+    lazy_sized_any<32> a([&calls] { ++calls; return 1; });
+    lazy_sized_any<32> b = a;
+    lazy_sized_any<32> c = std::move(a);
+    EXPECT_FALSE(a.has_value());
+    EXPECT_FALSE(b.materialized());
+    EXPECT_FALSE(c.materialized());
+    EXPECT_EQ(any_cast<int>(b) + any_cast<int>(c), 2);
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(LazySizedAnyTest, ThrowingFactoryIsKept)
+{
+    bool fail = true;
+    lazy_sized_any<32> a([&fail] { if (fail) throw std::runtime_error("not yet"); return 5; });
+    EXPECT_THROW(any_cast<int>(a), std::runtime_error);
+    EXPECT_FALSE(a.materialized());
+    fail = false;
+    EXPECT_EQ(any_cast<int>(a), 5);
+}
+
+TEST(LazySizedAnyTest, FactoryReturningReference)
+{
+    // The factory is destroyed only after the value has been copied out of its capture.
+    lazy_sized_any<64> a(std::in_place_type<std::string>, [s = std::string("owned by the factory's capture")]() -> const std::string& { return s; });
+    EXPECT_EQ(any_cast<const std::string&>(a), "owned by the factory's capture");
+}
+
+namespace
+{
+    struct fragile
+    {
+        explicit fragile(bool fail) { if (fail) throw std::runtime_error("construction failed"); }
+    };
+}
+
+TEST(LazySizedAnyTest, ThrowingConstructorKeepsFactory)
+{
+    bool fail = true;
+    lazy_sized_any<32> a(std::in_place_type<fragile>, [&fail] { return fail; });
+    EXPECT_THROW(a.value(), std::runtime_error);
+    EXPECT_FALSE(a.materialized());
+    fail = false;
+    EXPECT_NO_THROW(a.value());
+    EXPECT_TRUE(a.materialized());
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/per_core_any.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using kmillet::per_core_any;
+
+TEST(PerCoreAnyTest, SlotsArePadded)
+{
+    per_core_any<16> counters(3);
+    EXPECT_EQ(counters.size(), 3u);
+    EXPECT_EQ(per_core_any<16>(0).size(), 1u);
+}
+
+TEST(PerCoreAnyTest, ConcurrentUpdates)
+{
+    per_core_any<16> counters;
+    counters.emplace_all<std::uint64_t>(0u);
+    constexpr int threads = 8, increments = 10000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&] {
+            for (int i = 0; i < increments; ++i) counters.update<std::uint64_t>([](std::uint64_t& count) { ++count; });
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    EXPECT_EQ(counters.combine<std::uint64_t>(std::uint64_t{0}, std::plus<>{}), std::uint64_t{threads * increments});
+}
+
+TEST(PerCoreAnyTest, TypedAccess)
+{
+    per_core_any<32> values(2);
+    EXPECT_FALSE(values.update<int>([](int& value) { value = 5; })); // lock-free updates do not fill empty slots
+    values.emplace_all<int>(0);
+    EXPECT_TRUE(values.update<int>([](int& value) { value = 5; }));
+    EXPECT_FALSE(values.update<double>([](double&) {}));
+    EXPECT_EQ(values.combine<int>(0, [](int acc, const int& value) { return std::max(acc, value); }), 5);
+    EXPECT_EQ(values.combine<double>(0.0, std::plus<>{}), 0.0);
+    values.reset();
+    EXPECT_EQ(values.combine<int>(0, std::plus<>{}), 0);
+    values.emplace_all<std::string>("x");
+    EXPECT_EQ(values.combine<std::string>(std::string(), std::plus<>{}), "xx");
+}
+
+TEST(PerCoreAnyTest, LockedUpdates)
+{
+    per_core_any<32> values(2);
+    EXPECT_TRUE(values.update_locked<std::string>([](std::string& value) { value = "y"; })); // the empty slot is given a string first
+    EXPECT_FALSE(values.update_locked<std::vector<int>>([](std::vector<int>&) {}));
+    EXPECT_EQ(values.combine<std::string>(std::string(), std::plus<>{}), "y");
+}
+
+TEST(PerCoreAnyTest, ConcurrentLockedUpdates)
+{
+    per_core_any<32> lengths;
+    lengths.emplace_all<std::string>();
+    constexpr int threads = 8, appends = 1000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&] {
+            for (int i = 0; i < appends; ++i) lengths.update_locked<std::string>([](std::string& value) { value += 'x'; });
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    EXPECT_EQ(lengths.combine<std::string>(std::size_t{0}, [](std::size_t total, const std::string& value) { return total + value.size(); }),
+              std::size_t{threads * appends});
+}
@@ -4,9 +4,78 @@
 
 #include <benchmark/benchmark.h>
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#if defined(_WIN32)
+#include <malloc.h> // for _aligned_malloc, _aligned_free
+#endif
+
+// Counting replacements of the global allocation functions, so that every benchmark can report how often it allocates.
+// The sized deallocation functions are replaced too, since a library may implement them without forwarding to the unsized ones.
+// The array and nothrow forms are not replaced, since their default versions forward to these.
+namespace
+{
+    std::atomic<std::size_t> allocationCount{0};
+    std::atomic<std::size_t> allocatedBytes{0};
+
+    void* CountedAllocate(std::size_t size, std::size_t alignment)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        if (size == 0) size = 1;
+#if defined(_WIN32)
+        void* ptr = _aligned_malloc(size, alignment);
+#else
+        void* ptr = alignment <= alignof(std::max_align_t) ? std::malloc(size) : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+    void CountedDeallocate(void* ptr) noexcept
+    {
+#if defined(_WIN32)
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+
+    // Reports the allocations made between its construction and its destruction as per-iteration counters.
+    class AllocationCounter
+    {
+    public:
+        explicit AllocationCounter(benchmark::State& state)
+            : state(state)
+            , count(allocationCount.load(std::memory_order_relaxed))
+            , bytes(allocatedBytes.load(std::memory_order_relaxed))
+        {}
+        ~AllocationCounter()
+        {
+            const auto newCount = static_cast<double>(allocationCount.load(std::memory_order_relaxed) - count);
+            const auto newBytes = static_cast<double>(allocatedBytes.load(std::memory_order_relaxed) - bytes);
+            state.counters["allocs/iter"] = benchmark::Counter(newCount, benchmark::Counter::kAvgIterations);
+            state.counters["bytes/iter"] = benchmark::Counter(newBytes, benchmark::Counter::kAvgIterations);
+        }
+
+    private:
+        benchmark::State& state;
+        std::size_t count;
+        std::size_t bytes;
+    };
+}
+
+void* operator new(std::size_t size) { return CountedAllocate(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return CountedAllocate(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void* ptr) noexcept { CountedDeallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { CountedDeallocate(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { CountedDeallocate(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { CountedDeallocate(ptr); }
+
 template <class AnyT>
 static void BM_Any_Empty(benchmark::State& state)
 {
+    AllocationCounter counter(state);
     for (auto _ : state) {
         AnyT a;
         benchmark::DoNotOptimize(a);
@@ -16,6 +85,7 @@ static void BM_Any_Empty(benchmark::State& state)
 template <class T, class AnyT>
 static void BM_Any_Value(benchmark::State& state)
 {
+    AllocationCounter counter(state);
     for (auto _ : state) {
         AnyT a(std::in_place_type<T>);
         benchmark::DoNotOptimize(a);
@@ -26,6 +96,7 @@ template <class T, class AnyT>
 static void BM_Any_Copy(benchmark::State& state)
 {
     AnyT a = T{};
+    AllocationCounter counter(state);
     for (auto _ : state) {
         AnyT b(a);
         benchmark::DoNotOptimize(b);
@@ -37,6 +108,7 @@ static void BM_Any_Swap(benchmark::State& state)
 {
     AnyT a = T{};
     AnyT b = T{};
+    AllocationCounter counter(state);
     for (auto _ : state) {
         a.swap(b);
     }
@@ -48,6 +120,7 @@ template <class T, class AnyT>
 static void BM_Any_MoveAndSwap(benchmark::State& state)
 {
     AnyT a = T{};
+    AllocationCounter counter(state);
     for (auto _ : state) {
         AnyT b(std::move(a));
         a.reset();
@@ -61,6 +134,7 @@ static void BM_Any_Cast(benchmark::State& state)
 {
     using std::any_cast;
     AnyT a = 42;
+    AllocationCounter counter(state);
     for (auto _ : state) {
         int& ref = any_cast<int&>(a);
         benchmark::DoNotOptimize(ref);
@@ -77,8 +151,10 @@ struct Bytes
 #define COMPARE_BENCHMARKS(BenchMark, ...) \
 BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, std::any)->Unit(benchmark::kNanosecond); \
 BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::any)->Unit(benchmark::kNanosecond); \
-BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_any<32>)->Unit(benchmark::kNanosecond); \
-BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_any<64>)->Unit(benchmark::kNanosecond)
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_any<32, kmillet::virtual_dispatch>)->Unit(benchmark::kNanosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_any<32, kmillet::table_dispatch>)->Unit(benchmark::kNanosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_any<64, kmillet::virtual_dispatch>)->Unit(benchmark::kNanosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_any<64, kmillet::table_dispatch>)->Unit(benchmark::kNanosecond)
 
 
 COMPARE_BENCHMARKS(BM_Any_Empty);
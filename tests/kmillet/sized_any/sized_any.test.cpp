@@ -81,12 +81,43 @@ TEST(SizedAnyTest, Emplace)
     EXPECT_EQ(v[2], 3);
 }
 
+TEST(SizedAnyTest, EmplaceOrReuse)
+{
+    sized_any<64> a;
+    auto clear = [](std::vector<double>& v) { v.clear(); };
+    auto& v = a.emplace_or_reuse<std::vector<double>>(clear, 3, 1.5); // constructed, since a is empty
+    EXPECT_EQ(v.size(), 3);
+    v.resize(100);
+    const double* storage = v.data();
+    const auto capacity = v.capacity();
+
+    auto& reused = a.emplace_or_reuse<std::vector<double>>(clear, 3, 1.5); // cleared, keeping its capacity
+    EXPECT_EQ(&reused, &v);
+    EXPECT_TRUE(reused.empty());
+    EXPECT_EQ(reused.capacity(), capacity);
+    EXPECT_EQ(reused.data(), storage);
+
+    a = 42;
+    bool invoked = false;
+    auto& s = a.emplace_or_reuse<std::string>([&](std::string&) { invoked = true; }, "new");
+    EXPECT_FALSE(invoked);
+    EXPECT_EQ(s, "new");
+}
+
 TEST(SizedAnyTest, BadCast)
 {
     sized_any<32> a = 42;
     EXPECT_THROW(any_cast<std::string>(a), std::bad_any_cast);
 }
 
+TEST(SizedAnyTest, ConstPointerCastHeap)
+{
+    const sized_any<8> a = std::string("heap allocated");
+    const std::string* ptr = any_cast<std::string>(&a);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, "heap allocated");
+}
+
 TEST(SizedAnyTest, AnyAlias)
 {
     EXPECT_TRUE(sizeof(any) == sizeof(std::any));
@@ -109,4 +140,47 @@ TEST(SizedAnyTest, MakeSizedAnyToFit)
     auto b = kmillet::make_sized_any<MyStruct>();
     EXPECT_EQ(b.type(), typeid(MyStruct));
     EXPECT_EQ(b.capacity(), sizeof(MyStruct));
-}
\ No newline at end of file
+}
+
+TEST(SizedAnyTest, SwapDifferentTypes)
+{
+    sized_any<64> a = 1;
+    sized_any<64> b = std::string("hello world, this is long enough to allocate");
+    a.swap(b);
+    EXPECT_EQ(any_cast<const std::string&>(a), "hello world, this is long enough to allocate");
+    EXPECT_EQ(any_cast<int>(b), 1);
+}
+
+TEST(SizedAnyTest, TableDispatch)
+{
+    sized_any<32, kmillet::table_dispatch> a = 42;
+    EXPECT_TRUE(a.has_value());
+    EXPECT_EQ(a.type(), typeid(int));
+    EXPECT_EQ(any_cast<int>(a), 42);
+    a.emplace<std::vector<int>>({1, 2, 3});
+    EXPECT_EQ(any_cast<std::vector<int>&>(a).size(), 3);
+    a.reset();
+    EXPECT_FALSE(a.has_value());
+    EXPECT_EQ(a.type(), typeid(void));
+}
+
+TEST(SizedAnyTest, DispatchInterconversion)
+{
+    sized_any<32, kmillet::virtual_dispatch> a = std::string("virtual");
+    sized_any<64, kmillet::table_dispatch> b = a;
+    EXPECT_EQ(any_cast<const std::string&>(b), "virtual");
+
+    sized_any<32, kmillet::virtual_dispatch> c = std::move(b);
+    EXPECT_FALSE(b.has_value());
+    EXPECT_EQ(b.type(), typeid(void));
+    EXPECT_EQ(any_cast<const std::string&>(c), "virtual");
+
+    b = 7;
+    c.swap(b);
+    EXPECT_EQ(any_cast<int>(c), 7);
+    EXPECT_EQ(any_cast<const std::string&>(b), "virtual");
+
+    sized_any<32, kmillet::table_dispatch> d;
+    d = c;
+    EXPECT_EQ(any_cast<int>(d), 7);
+}
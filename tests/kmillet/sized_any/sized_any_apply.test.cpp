@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_apply.hpp>
+
+#include <gtest/gtest.h>
+
+#include <any>
+#include <array>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+using kmillet::apply_any;
+using kmillet::can_apply_any;
+using kmillet::sized_any;
+
+namespace
+{
+    int Add(int a, int b) { return a + b; }
+}
+
+TEST(SizedAnyApplyTest, Invoke)
+{
+    std::vector<sized_any<16>> args{1, 2};
+    EXPECT_TRUE(can_apply_any(&Add, args));
+    EXPECT_EQ(apply_any(&Add, args), 3);
+    EXPECT_EQ(apply_any(Add, std::span<sized_any<16>>(args)), 3);
+
+    auto describe = [](const std::string& name, double weight) { return name + ":" + std::to_string(static_cast<int>(weight)); };
+    std::array<sized_any<16>, 2> mixed{std::string("a name longer than the buffer"), 2.0};
+    EXPECT_EQ(apply_any(describe, mixed), "a name longer than the buffer:2");
+}
+
+TEST(SizedAnyApplyTest, Mismatch)
+{
+    std::vector<sized_any<16>> args{1, 2.0};
+    EXPECT_FALSE(can_apply_any(&Add, args));
+    EXPECT_THROW(apply_any(&Add, args), std::bad_any_cast);
+    std::vector<sized_any<16>> tooFew{1};
+    EXPECT_FALSE(can_apply_any(&Add, tooFew));
+    std::vector<sized_any<16>> empty{1, sized_any<16>{}};
+    EXPECT_FALSE(can_apply_any(&Add, empty));
+}
+
+TEST(SizedAnyApplyTest, ReferencesIntoBuffers)
+{
+    std::vector<sized_any<32>> args{std::vector<int>{1, 2}, 0};
+    apply_any([](std::vector<int>& values, int& count) { values.push_back(3); count = static_cast<int>(values.size()); }, args);
+    EXPECT_EQ(kmillet::any_cast<const std::vector<int>&>(args[0]).size(), 3u);
+    EXPECT_EQ(kmillet::any_cast<int>(args[1]), 3);
+
+    const std::vector<sized_any<32>> constant{std::string("read only")};
+    EXPECT_EQ(apply_any([](const std::string& s) { return s.size(); }, constant), 9u);
+}
+
+TEST(SizedAnyApplyTest, MovesFromOwningRvalues)
+{
+    auto take = [](std::string s) { return s; };
+    std::vector<sized_any<64>> args{std::string("a string long enough to own a heap buffer")};
+    EXPECT_EQ(apply_any(take, args), "a string long enough to own a heap buffer");
+    EXPECT_FALSE(kmillet::any_cast<const std::string&>(args[0]).empty()); // copied from an lvalue
+    EXPECT_EQ(apply_any(take, std::span<sized_any<64>>(args)), "a string long enough to own a heap buffer"); // a span does not own its elements
+    EXPECT_FALSE(kmillet::any_cast<const std::string&>(args[0]).empty());
+    EXPECT_EQ(apply_any(take, std::move(args)), "a string long enough to own a heap buffer");
+    EXPECT_TRUE(kmillet::any_cast<const std::string&>(args[0]).empty()); // the elements were moved from, not the vector itself
+}
+
+TEST(SizedAnyApplyTest, RvalueReferenceParameters)
+{
+    auto take = [](std::string&& s) { std::string taken = std::move(s); return taken; };
+    std::vector<sized_any<64>> args{std::string("a string long enough to own a heap buffer")};
+    EXPECT_EQ(apply_any(take, args), "a string long enough to own a heap buffer");
+    EXPECT_FALSE(kmillet::any_cast<const std::string&>(args[0]).empty()); // a copy was passed from an lvalue
+    const std::vector<sized_any<64>> constant{std::string("read only")};
+    EXPECT_EQ(apply_any(take, constant), "read only");
+    EXPECT_EQ(apply_any(take, std::move(args)), "a string long enough to own a heap buffer");
+    EXPECT_TRUE(kmillet::any_cast<const std::string&>(args[0]).empty());
+}
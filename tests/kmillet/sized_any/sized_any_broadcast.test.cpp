@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_broadcast.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+using kmillet::sized_any;
+using kmillet::sized_any_broadcast;
+
+namespace
+{
+    struct counted
+    {
+        static inline int copies = 0;
+        int value = 0;
+
+        counted(int value) : value(value) {}
+        counted(const counted& other) : value(other.value) { ++copies; }
+        counted(counted&& other) noexcept = default;
+        counted& operator=(const counted& other) { value = other.value; ++copies; return *this; }
+        counted& operator=(counted&&) noexcept = default;
+    };
+}
+
+TEST(SizedAnyBroadcastTest, EveryConsumerSeesEveryValue)
+{
+    sized_any_broadcast<32> ring(4, 2);
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_TRUE(ring.try_publish(1));
+    EXPECT_TRUE(ring.try_publish(std::string("two")));
+
+    std::vector<std::string> seen;
+    auto record = [&](const sized_any<32>& value) {
+        if (const int* i = kmillet::any_cast<int>(&value)) seen.push_back(std::to_string(*i));
+        else seen.push_back(kmillet::any_cast<const std::string&>(value));
+    };
+    EXPECT_EQ(ring.consume(0, record), 2u);
+    EXPECT_EQ(ring.consume(0, record), 0u);
+    EXPECT_EQ(ring.pending(1), 2u);
+    EXPECT_EQ(ring.consume(1, record), 2u);
+    EXPECT_EQ(seen, (std::vector<std::string>{"1", "two", "1", "two"}));
+}
+
+TEST(SizedAnyBroadcastTest, SlotsAreReusedOnlyAfterEveryConsumer)
+{
+    sized_any_broadcast<16> ring(4, 2);
+    EXPECT_EQ(ring.publish(8, [i = 0](sized_any<16>& slot) mutable { slot = i++; }), 4u);
+    EXPECT_FALSE(ring.try_publish(4));
+
+    int sum = 0;
+    auto add = [&](const sized_any<16>& value) { sum += kmillet::any_cast<int>(value); };
+    EXPECT_EQ(ring.consume(0, add), 4u);
+    EXPECT_FALSE(ring.try_publish(4)); // consumer 1 has not read anything yet
+    EXPECT_EQ(ring.consume(1, add, 3), 3u);
+    EXPECT_EQ(ring.publish(8, [](sized_any<16>& slot) { slot = 10; }), 3u);
+    EXPECT_EQ(ring.consume(1, add), 4u);
+    EXPECT_EQ(sum, 6 + 6 + 30);
+}
+
+TEST(SizedAnyBroadcastTest, ConsumersReadInPlace)
+{
+    sized_any_broadcast<16> ring(8, 3);
+    ring.publish(8, [i = 0](sized_any<16>& slot) mutable { slot.emplace<counted>(i++); });
+    counted::copies = 0;
+    int sum = 0;
+    for (std::size_t c = 0; c < ring.consumers(); ++c)
+    {
+        ring.consume(c, [&](const sized_any<16>& value) { sum += kmillet::any_cast<const counted&>(value).value; });
+    }
+    EXPECT_EQ(counted::copies, 0);
+    EXPECT_EQ(sum, 3 * 28);
+}
+
+TEST(SizedAnyBroadcastTest, ConcurrentConsumers)
+{
+    constexpr std::int64_t count = 20000;
+    sized_any_broadcast<16> ring(64, 3);
+    std::vector<std::int64_t> sums(ring.consumers(), 0);
+    std::vector<std::thread> consumers;
+    for (std::size_t c = 0; c < ring.consumers(); ++c)
+    {
+        consumers.emplace_back([&, c] {
+            std::int64_t read = 0;
+            while (read < count)
+            {
+                const std::size_t n = ring.consume(c, [&](const sized_any<16>& value) { sums[c] += kmillet::any_cast<std::int64_t>(value); });
+                if (n == 0) std::this_thread::yield();
+                read += static_cast<std::int64_t>(n);
+            }
+        });
+    }
+    for (std::int64_t next = 0; next < count;)
+    {
+        const std::size_t n = ring.publish(16, [&](sized_any<16>& slot) { slot = next++; });
+        if (n == 0) std::this_thread::yield();
+    }
+    for (auto& consumer : consumers) consumer.join();
+    for (const std::int64_t sum : sums) EXPECT_EQ(sum, count * (count - 1) / 2);
+}
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_channel.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+using kmillet::sized_any;
+using kmillet::sized_any_channel;
+using kmillet::any_cast;
+
+namespace
+{
+    // Minimal eagerly-started coroutine type that is destroyed when it finishes.
+    struct detached
+    {
+        struct promise_type
+        {
+            detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    detached produce(sized_any_channel<32>& channel, int first, int last, std::vector<bool>& results)
+    {
+        for (int i = first; i < last; ++i) results.push_back(co_await channel.send(i));
+    }
+
+    detached consume(sized_any_channel<32>& channel, std::vector<int>& received)
+    {
+        while (true)
+        {
+            sized_any<32> value = co_await channel.receive();
+            if (!value.has_value()) break;
+            received.push_back(any_cast<int>(value));
+        }
+    }
+}
+
+TEST(SizedAnyChannelTest, Buffered)
+{
+    sized_any_channel<32> channel(4);
+    std::vector<bool> sent;
+    produce(channel, 0, 4, sent);
+    EXPECT_EQ(sent.size(), 4);
+
+    std::vector<int> received;
+    consume(channel, received);
+    EXPECT_EQ(received, (std::vector<int>{0, 1, 2, 3}));
+    channel.close();
+    EXPECT_TRUE(channel.closed());
+}
+
+TEST(SizedAnyChannelTest, HandOffToWaitingReceiver)
+{
+    sized_any_channel<32> channel(0);
+    std::vector<int> received;
+    consume(channel, received);
+    EXPECT_TRUE(received.empty());
+
+    std::vector<bool> sent;
+    produce(channel, 0, 3, sent);
+    EXPECT_EQ(sent, (std::vector<bool>{true, true, true}));
+    EXPECT_EQ(received, (std::vector<int>{0, 1, 2}));
+    channel.close();
+}
+
+TEST(SizedAnyChannelTest, SenderWaitsWhenFull)
+{
+    sized_any_channel<32> channel(2);
+    std::vector<bool> sent;
+    produce(channel, 0, 5, sent);
+    EXPECT_EQ(sent.size(), 2);
+
+    std::vector<int> received;
+    consume(channel, received);
+    EXPECT_EQ(sent.size(), 5);
+    EXPECT_EQ(received, (std::vector<int>{0, 1, 2, 3, 4}));
+    channel.close();
+}
+
+TEST(SizedAnyChannelTest, CloseWakesSenders)
+{
+    sized_any_channel<32> channel(1);
+    std::vector<bool> sent;
+    produce(channel, 0, 3, sent);
+    EXPECT_EQ(sent.size(), 1);
+    channel.close();
+    EXPECT_EQ(sent, (std::vector<bool>{true, false, false}));
+
+    std::vector<int> received;
+    consume(channel, received);
+    EXPECT_EQ(received, (std::vector<int>{0}));
+}
+
+TEST(SizedAnyChannelTest, TryReceiveBatch)
+{
+    sized_any_channel<32> channel(3);
+    std::vector<bool> sent;
+    produce(channel, 0, 5, sent);
+
+    // The waiting sender refills the ring once, then sends its last value after it is resumed.
+    std::array<sized_any<32>, 8> batch;
+    ASSERT_EQ(channel.try_receive(batch), 4);
+    for (int i = 0; i < 4; ++i) EXPECT_EQ(any_cast<int>(batch[i]), i);
+    EXPECT_EQ(sent.size(), 5);
+    ASSERT_EQ(channel.try_receive(batch), 1);
+    EXPECT_EQ(any_cast<int>(batch[0]), 4);
+    EXPECT_EQ(channel.try_receive(batch), 0);
+}
+
+TEST(SizedAnyChannelTest, TrySend)
+{
+    sized_any_channel<32> channel(1);
+    sized_any<32> value = std::string("first");
+    EXPECT_TRUE(channel.try_send(value));
+    value = std::string("second");
+    EXPECT_FALSE(channel.try_send(value));
+    EXPECT_EQ(any_cast<const std::string&>(value), "second");
+
+    std::array<sized_any<32>, 1> batch;
+    EXPECT_EQ(channel.try_receive(batch), 1);
+    EXPECT_EQ(any_cast<const std::string&>(batch[0]), "first");
+}
+
+namespace
+{
+    // Receives a value and sends the next one through the same channel, unless it received `last`.
+    detached relay(sized_any_channel<32>& channel, int last, int& reached)
+    {
+        const int value = any_cast<int>(co_await channel.receive());
+        reached = value;
+        if (value < last) co_await channel.send(value + 1);
+    }
+}
+
+TEST(SizedAnyChannelTest, ChainsOfResumptionsDoNotNest)
+{
+    // Every relay resumes the next waiting one from within its own resumption. Resuming each of them on the stack
+    // of the previous one would overflow it long before the last relay.
+    constexpr int relays = 200'000;
+    sized_any_channel<32> channel(0);
+    int reached = -1;
+    for (int i = 0; i < relays; ++i) relay(channel, relays - 1, reached);
+    sized_any<32> first = 0;
+    EXPECT_TRUE(channel.try_send(first));
+    EXPECT_EQ(reached, relays - 1);
+}
+
+namespace
+{
+    // Sends `count` values and then counts itself as finished.
+    detached produce_counted(sized_any_channel<32>& channel, int count, std::atomic<int>& finished)
+    {
+        for (int i = 1; i <= count; ++i) co_await channel.send(i);
+        finished.fetch_add(1, std::memory_order_release);
+    }
+
+    // Receives until the channel is closed and drained, then counts itself as finished.
+    detached consume_counted(sized_any_channel<32>& channel, long long& sum, int& received, std::atomic<int>& finished)
+    {
+        while (true)
+        {
+            sized_any<32> value = co_await channel.receive();
+            if (!value.has_value()) break;
+            sum += any_cast<int>(value);
+            ++received;
+        }
+        finished.fetch_add(1, std::memory_order_release);
+    }
+
+    // Polls rather than waits, since a coroutine must not touch `finished` once it has counted itself, lest it outlive the test.
+    void wait_for(const std::atomic<int>& finished, int expected)
+    {
+        while (finished.load(std::memory_order_acquire) < expected) std::this_thread::yield();
+    }
+}
+
+TEST(SizedAnyChannelTest, SendAndReceiveFromManyThreads)
+{
+    // Coroutines are started on several threads and then resumed by whichever thread unblocks them.
+    constexpr int producers = 4, consumers = 3, count = 20'000;
+    sized_any_channel<32> channel(8);
+    std::array<long long, consumers> sums{};
+    std::array<int, consumers> received{};
+    std::atomic<int> produced = 0, consumed = 0;
+    std::vector<std::thread> threads;
+    for (int c = 0; c < consumers; ++c) threads.emplace_back([&, c] { consume_counted(channel, sums[c], received[c], consumed); });
+    for (int p = 0; p < producers; ++p) threads.emplace_back([&] { produce_counted(channel, count, produced); });
+    for (auto& thread : threads) thread.join();
+    wait_for(produced, producers);
+    channel.close();
+    wait_for(consumed, consumers);
+
+    long long sum = 0;
+    int total = 0;
+    for (int c = 0; c < consumers; ++c)
+    {
+        sum += sums[c];
+        total += received[c];
+    }
+    EXPECT_EQ(total, producers * count);
+    EXPECT_EQ(sum, static_cast<long long>(producers) * count * (count + 1) / 2);
+}
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_compaction.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <forward_list>
+#include <string>
+#include <vector>
+
+using kmillet::sized_any;
+using kmillet::any_cast;
+using kmillet::compact_heap_payloads;
+using kmillet::table_dispatch;
+
+namespace
+{
+    using big = std::array<int, 16>;
+
+    // Heap-allocated in any sized_any, since its move constructor may throw.
+    struct fragile
+    {
+        static inline int movesLeft = -1;
+
+        explicit fragile(int value) : value(value) {}
+        fragile(const fragile&) = default;
+        fragile(fragile&& other) : value(other.value)
+        {
+            if (movesLeft == 0) throw 0;
+            if (movesLeft > 0) --movesLeft;
+        }
+
+        int value;
+    };
+
+    // Allocated through its own allocation functions, which an arena would bypass.
+    struct pooled
+    {
+        static inline int allocations = 0;
+
+        static void* operator new(std::size_t size)
+        {
+            ++allocations;
+            return ::operator new(size);
+        }
+        static void* operator new(std::size_t, void* where) noexcept { return where; }
+        static void operator delete(void* p) noexcept
+        {
+            --allocations;
+            ::operator delete(p);
+        }
+
+        big values;
+    };
+}
+
+TEST(SizedAnyCompactionTest, RelocatesHeapPayloads)
+{
+    std::vector<sized_any<16>> values;
+    for (int i = 0; i < 8; ++i)
+    {
+        if (i % 2) values.emplace_back(i);
+        else values.emplace_back(big{i});
+    }
+    std::vector<const big*> before;
+    for (auto& value : values) before.push_back(any_cast<big>(&value));
+    EXPECT_EQ(compact_heap_payloads(values.begin(), values.end()), values.end());
+    for (int i = 0; i < 8; ++i)
+    {
+        if (i % 2)
+        {
+            EXPECT_EQ(any_cast<int>(values[i]), i);
+            continue;
+        }
+        EXPECT_NE(any_cast<big>(&values[i]), before[i]); // the old allocation was still live when the new one was made
+        EXPECT_EQ(any_cast<big>(values[i])[0], i);
+    }
+}
+
+TEST(SizedAnyCompactionTest, PlacesPayloadsContiguously)
+{
+    std::vector<sized_any<16>> values;
+    std::vector<sized_any<16>> interleaved; // scatters the original allocations
+    for (int i = 0; i < 8; ++i)
+    {
+        values.emplace_back(big{i});
+        interleaved.emplace_back(std::string(100, 'x'));
+    }
+    interleaved.clear();
+    EXPECT_EQ(compact_heap_payloads(values.begin(), values.end()), values.end());
+    // Each payload is preceded by the pointer to its arena.
+    constexpr std::size_t stride = (sizeof(void*) + sizeof(big) + alignof(void*) - 1) / alignof(void*) * alignof(void*);
+    for (int i = 1; i < 8; ++i)
+    {
+        auto previous = reinterpret_cast<std::uintptr_t>(any_cast<big>(&values[i - 1]));
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(any_cast<big>(&values[i])) - previous, stride);
+        EXPECT_EQ(any_cast<big>(values[i])[0], i);
+    }
+}
+
+TEST(SizedAnyCompactionTest, ArenaPayloadsBehaveLikeOthers)
+{
+    std::vector<sized_any<16>> values;
+    for (int i = 0; i < 4; ++i) values.emplace_back(std::string(64, static_cast<char>('a' + i)));
+    compact_heap_payloads(values.begin(), values.end());
+    // Compacting again moves the contents into a new arena and frees the old one once they have all left it.
+    compact_heap_payloads(values.begin(), values.end());
+    values[0].emplace<std::string>(32, 'z');  // reuses the slot in the arena
+    values[1].emplace<big>(big{7});           // leaves the arena
+    values[2] = 5;
+    sized_any<16> copy = values[3];
+    values.clear();
+    EXPECT_EQ(any_cast<std::string>(copy), std::string(64, 'd'));
+}
+
+TEST(SizedAnyCompactionTest, ThrowingMove)
+{
+    std::vector<sized_any<16>> values;
+    for (int i = 0; i < 4; ++i) values.emplace_back(fragile(i));
+    fragile::movesLeft = 2;
+    EXPECT_THROW(compact_heap_payloads(values.begin(), values.end()), int);
+    fragile::movesLeft = -1;
+    for (int i = 0; i < 4; ++i) EXPECT_EQ(any_cast<fragile&>(values[i]).value, i);
+    values.clear(); // frees the arena of the interrupted pass, which the first two contents still hold
+}
+
+TEST(SizedAnyCompactionTest, LeavesInPlacePayloads)
+{
+    std::vector<sized_any<16>> values(3, sized_any<16>(7));
+    const void* address = any_cast<int>(&values[1]);
+    EXPECT_EQ(compact_heap_payloads(values.begin(), values.end()), values.end());
+    EXPECT_EQ(any_cast<int>(&values[1]), address);
+    EXPECT_EQ(any_cast<int>(values[1]), 7);
+}
+
+TEST(SizedAnyCompactionTest, LeavesUnrelocatablePayloads)
+{
+    std::vector<sized_any<16>> values;
+    values.emplace_back(pooled{big{1}});
+    values.emplace_back(std::array<char, 64>{'c'});
+    EXPECT_EQ(pooled::allocations, 1);
+    const void* first = any_cast<pooled>(&values[0]);
+    const void* second = any_cast<std::array<char, 64>>(&values[1]);
+    EXPECT_EQ(compact_heap_payloads(values.begin(), values.end()), values.end());
+    EXPECT_EQ(any_cast<pooled>(&values[0]), first);
+    EXPECT_EQ((any_cast<std::array<char, 64>>(&values[1])), second);
+    EXPECT_EQ(any_cast<pooled>(values[0]).values[0], 1);
+    values.clear();
+    EXPECT_EQ(pooled::allocations, 0);
+}
+
+TEST(SizedAnyCompactionTest, Incremental)
+{
+    std::vector<sized_any<16, table_dispatch>> values;
+    for (int i = 0; i < 10; ++i) values.emplace_back(std::string(64, static_cast<char>('a' + i)));
+    values.emplace_back();
+    auto it = values.begin();
+    int passes = 0;
+    while (it != values.end())
+    {
+        it = compact_heap_payloads(it, values.end(), 3);
+        ++passes;
+    }
+    EXPECT_EQ(passes, 4);
+    for (int i = 0; i < 10; ++i) EXPECT_EQ(any_cast<std::string>(values[i]), std::string(64, static_cast<char>('a' + i)));
+    EXPECT_FALSE(values.back().has_value());
+}
+
+TEST(SizedAnyCompactionTest, ForwardIterators)
+{
+    std::forward_list<sized_any<16>> values;
+    for (int i = 0; i < 5; ++i) values.push_front(std::string(64, static_cast<char>('a' + i)));
+    auto it = values.begin();
+    int passes = 0;
+    while (it != values.end())
+    {
+        it = compact_heap_payloads(it, values.end(), 2);
+        ++passes;
+    }
+    EXPECT_EQ(passes, 3);
+    EXPECT_EQ(any_cast<std::string>(values.front()), std::string(64, 'e'));
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_event_bus.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using kmillet::sized_any;
+using kmillet::sized_any_event_bus;
+
+namespace
+{
+    // Changes its state when invoked, so several publishing threads could race on it.
+    struct counting_handler
+    {
+        void operator()(const int&) { ++count; }
+        int count = 0;
+    };
+
+    template<class F>
+    concept subscribable = requires(sized_any_event_bus<32>& bus, F handler) { bus.subscribe<int>(handler); };
+}
+
+TEST(SizedAnyEventBusTest, PublishToMatchingType)
+{
+    sized_any_event_bus<32> bus;
+    std::vector<int> ints;
+    std::vector<std::string> strings;
+    bus.subscribe<int>([&ints](const int& value) { ints.push_back(value); });
+    bus.subscribe<std::string>([&strings](const std::string& value) { strings.push_back(value); });
+
+    EXPECT_EQ(bus.publish(sized_any<32>(1)), 1);
+    EXPECT_EQ(bus.publish(sized_any<32>(std::string("two"))), 1);
+    EXPECT_EQ(bus.publish(3), 1);
+    EXPECT_EQ(bus.publish(sized_any<32>(4.0)), 0);
+    EXPECT_EQ(bus.publish(sized_any<32>()), 0);
+    EXPECT_EQ(ints, (std::vector<int>{1, 3}));
+    EXPECT_EQ(strings, (std::vector<std::string>{"two"}));
+}
+
+TEST(SizedAnyEventBusTest, HeapPayload)
+{
+    struct Large { char bytes[64]; int value; };
+    sized_any_event_bus<16> bus;
+    int received = 0;
+    bus.subscribe<Large>([&received](const Large& large) { received = large.value; });
+    sized_any<16> event = Large{{}, 99};
+    EXPECT_EQ(bus.publish(event), 1);
+    EXPECT_EQ(received, 99);
+}
+
+TEST(SizedAnyEventBusTest, Unsubscribe)
+{
+    sized_any_event_bus<32> bus;
+    int first = 0;
+    int second = 0;
+    auto a = bus.subscribe<int>([&first](const int&) { ++first; });
+    bus.subscribe<int>([&second](const int&) { ++second; });
+    EXPECT_EQ(bus.publish(0), 2);
+    EXPECT_TRUE(bus.unsubscribe(a));
+    EXPECT_FALSE(bus.unsubscribe(a));
+    EXPECT_EQ(bus.publish(0), 1);
+    EXPECT_EQ(first, 1);
+    EXPECT_EQ(second, 2);
+}
+
+TEST(SizedAnyEventBusTest, HandlersAreInvokedAsConst)
+{
+    static_assert(!subscribable<counting_handler>);
+    static_assert(subscribable<void (*)(const int&)>);
+}
+
+TEST(SizedAnyEventBusTest, SubscribeFromHandler)
+{
+    sized_any_event_bus<32> bus;
+    int inner = 0;
+    bus.subscribe<int>([&bus, &inner](const int& value) {
+        if (value == 0) bus.subscribe<int>([&inner](const int&) { ++inner; }); // publications never hold the write mutex
+    });
+    EXPECT_EQ(bus.publish(0), 1);
+    EXPECT_EQ(bus.publish(1), 2);
+    EXPECT_EQ(inner, 1);
+}
+
+TEST(SizedAnyEventBusTest, DeferredDelivery)
+{
+    sized_any_event_bus<32> bus;
+    std::vector<int> ints;
+    bus.subscribe<int>([&ints](const int& value) { ints.push_back(value); });
+    bus.post(1);
+    bus.post(2);
+    EXPECT_TRUE(ints.empty());
+    EXPECT_EQ(bus.flush(), 2);
+    EXPECT_EQ(ints, (std::vector<int>{1, 2}));
+    EXPECT_EQ(bus.flush(), 0);
+}
+
+TEST(SizedAnyEventBusTest, ConcurrentPublish)
+{
+    sized_any_event_bus<32> bus;
+    std::atomic<int> total = 0;
+    bus.subscribe<int>([&total](const int& value) { total += value; });
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < 4; ++t)
+    {
+        publishers.emplace_back([&bus] { for (int i = 0; i < 1000; ++i) bus.publish(1); });
+    }
+    for (int i = 0; i < 100; ++i) bus.unsubscribe(bus.subscribe<double>([](const double&) {}));
+    for (auto& publisher : publishers) publisher.join();
+    EXPECT_EQ(total, 4000);
+}
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_image.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <cstddef>
+
+using kmillet::make_sized_any_image;
+using kmillet::sized_any;
+using kmillet::sized_any_image;
+using kmillet::type_list;
+
+namespace
+{
+    struct limits
+    {
+        static constexpr std::uint64_t sized_any_image_id = 4;
+        std::int32_t id;
+        std::array<double, 4> bounds;
+    };
+
+    using settings = type_list<std::int64_t, double, limits>;
+
+    struct celsius
+    {
+        static constexpr std::uint64_t sized_any_image_id = 1;
+        double degrees;
+    };
+    struct fahrenheit
+    {
+        static constexpr std::uint64_t sized_any_image_id = 2;
+        double degrees;
+    };
+    struct kelvin
+    {
+        double degrees;
+    };
+
+    template<class T>
+    concept identified = requires { kmillet::sized_any_image_id<T>::value; };
+}
+
+template<> struct kmillet::sized_any_image_id<kelvin> : std::integral_constant<std::uint64_t, 3> {};
+
+TEST(SizedAnyImageTest, RoundTrip)
+{
+    // limits does not fit in 16 bytes, so it is heap-allocated, yet it is laid out like the in-place values.
+    std::vector<sized_any<16>> values{std::int64_t{-3}, 2.5, limits{7, {1, 2, 3, 4}}, sized_any<16>{}};
+    auto bytes = make_sized_any_image<settings>(values.begin(), values.end());
+    ASSERT_TRUE(bytes.has_value());
+
+    // The image holds no pointers, so it may be used from a copy at another address, as after mapping a file.
+    std::vector<std::byte> mapped(*bytes);
+    auto image = sized_any_image<settings>::open(mapped);
+    ASSERT_TRUE(image.has_value());
+    ASSERT_EQ(image->size(), 4u);
+    EXPECT_EQ(*image->get<std::int64_t>(0), -3);
+    EXPECT_EQ(image->get<double>(0), nullptr);
+    EXPECT_EQ(*image->get<double>(1), 2.5);
+    EXPECT_EQ(image->get<limits>(2)->id, 7);
+    EXPECT_EQ(image->get<limits>(2)->bounds[3], 4.0);
+    EXPECT_EQ(image->index(2), 2u);
+    EXPECT_EQ(image->index(3), 3u);
+
+    sized_any<16> loaded = image->load<16>(2);
+    EXPECT_EQ(kmillet::any_cast<limits>(loaded).bounds[1], 2.0);
+    EXPECT_FALSE(image->load<16>(3).has_value());
+}
+
+TEST(SizedAnyImageTest, UnknownType)
+{
+    std::vector<sized_any<32>> values{1.0, std::string("not trivially copyable")};
+    EXPECT_FALSE(make_sized_any_image<settings>(values.begin(), values.end()).has_value());
+}
+
+TEST(SizedAnyImageTest, AppendedTypes)
+{
+    std::vector<sized_any<16>> values{std::int64_t{5}, 0.5};
+    auto bytes = make_sized_any_image<type_list<std::int64_t, double>>(values.begin(), values.end());
+    ASSERT_TRUE(bytes.has_value());
+    EXPECT_TRUE(sized_any_image<settings>::open(*bytes).has_value());
+    EXPECT_FALSE((sized_any_image<type_list<std::int64_t, limits>>::open(*bytes).has_value()));
+}
+
+TEST(SizedAnyImageTest, RejectsCorruptImages)
+{
+    std::vector<sized_any<16>> values{std::int64_t{5}, 0.5};
+    auto bytes = make_sized_any_image<settings>(values.begin(), values.end());
+    ASSERT_TRUE(bytes.has_value());
+
+    std::vector<std::byte> truncated(bytes->begin(), bytes->end() - 1);
+    EXPECT_FALSE(sized_any_image<settings>::open(truncated).has_value());
+    std::vector<std::byte> wrongMagic(*bytes);
+    wrongMagic[0] = std::byte{0};
+    EXPECT_FALSE(sized_any_image<settings>::open(wrongMagic).has_value());
+    EXPECT_FALSE(sized_any_image<settings>::open(std::span<const std::byte>(*bytes).subspan(1)).has_value());
+
+    // A corrupted record makes only its own object inaccessible.
+    std::vector<std::byte> badRecord(*bytes);
+    std::uint64_t records;
+    std::memcpy(&records, badRecord.data() + 16, sizeof(records));
+    const std::uint64_t offset = badRecord.size();
+    std::memcpy(badRecord.data() + records, &offset, sizeof(offset));
+    auto image = sized_any_image<settings>::open(badRecord);
+    ASSERT_TRUE(image.has_value());
+    EXPECT_EQ(image->get<std::int64_t>(0), nullptr);
+    EXPECT_EQ(*image->get<double>(1), 0.5);
+}
+
+TEST(SizedAnyImageTest, RejectsTagsOfAppendedTypes)
+{
+    std::vector<sized_any<16>> values{std::int64_t{5}};
+    auto bytes = make_sized_any_image<type_list<std::int64_t>>(values.begin(), values.end());
+    ASSERT_TRUE(bytes.has_value());
+
+    // double is in the list that opens the image, but not in the one it was made with, so a record tagged with it is corrupted.
+    std::uint64_t records;
+    std::memcpy(&records, bytes->data() + 16, sizeof(records));
+    const std::uint16_t tag = 1;
+    std::memcpy(bytes->data() + records + sizeof(std::uint64_t), &tag, sizeof(tag));
+    auto image = sized_any_image<settings>::open(*bytes);
+    ASSERT_TRUE(image.has_value());
+    EXPECT_EQ(image->get<double>(0), nullptr);
+    EXPECT_EQ(image->index(0), 3u);
+    EXPECT_FALSE(image->load<16>(0).has_value());
+}
+
+TEST(SizedAnyImageTest, TypeIdentifiers)
+{
+    static_assert(kmillet::sized_any_image_id<celsius>::value == 1);
+    static_assert(kmillet::sized_any_image_id<kelvin>::value == 3);
+    static_assert(kmillet::sized_any_image_id<double>::value != kmillet::sized_any_image_id<std::int64_t>::value);
+    static_assert(kmillet::sized_any_image_id<std::int32_t>::value != kmillet::sized_any_image_id<std::uint32_t>::value);
+    static_assert(!identified<std::array<double, 4>>);
+
+    std::vector<sized_any<16>> values{celsius{21.5}};
+    auto bytes = make_sized_any_image<type_list<celsius>>(values.begin(), values.end());
+    ASSERT_TRUE(bytes.has_value());
+    auto image = sized_any_image<type_list<celsius, kelvin>>::open(*bytes);
+    ASSERT_TRUE(image.has_value());
+    EXPECT_EQ(image->get<celsius>(0)->degrees, 21.5);
+    // The layouts match, but the identifiers tell the types apart.
+    EXPECT_FALSE(sized_any_image<type_list<fahrenheit>>::open(*bytes).has_value());
+    EXPECT_FALSE(sized_any_image<type_list<kelvin>>::open(*bytes).has_value());
+    EXPECT_FALSE(sized_any_image<type_list<double>>::open(*bytes).has_value());
+
+    // Fundamental types have identifiers of their own, so reordering them is detected.
+    std::vector<sized_any<16>> numbers{std::int64_t{1}, 2.0};
+    auto numberBytes = make_sized_any_image<type_list<std::int64_t, double>>(numbers.begin(), numbers.end());
+    ASSERT_TRUE(numberBytes.has_value());
+    EXPECT_FALSE((sized_any_image<type_list<double, std::int64_t>>::open(*numberBytes).has_value()));
+}
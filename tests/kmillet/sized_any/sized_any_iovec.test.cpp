@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_iovec.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#endif
+
+using kmillet::sized_any;
+using kmillet::sized_any_gather;
+using kmillet::sized_any_scatter;
+using kmillet::type_list;
+
+namespace
+{
+    struct sample
+    {
+        std::int32_t sensor;
+        std::array<double, 4> readings;
+    };
+
+    using telemetry = type_list<std::int64_t, double, sample>;
+
+    // Concatenates buffers as a gathering write would.
+    std::vector<std::byte> Gather(std::span<const kmillet::sized_any_iovec> buffers)
+    {
+        std::vector<std::byte> bytes;
+        for (const auto& buffer : buffers)
+        {
+            const auto* base = static_cast<const std::byte*>(buffer.iov_base);
+            bytes.insert(bytes.end(), base, base + buffer.iov_len);
+        }
+        return bytes;
+    }
+    // Splits bytes into buffers as a scattering read would.
+    const std::byte* Scatter(const std::byte* bytes, std::span<const kmillet::sized_any_iovec> buffers)
+    {
+        for (const auto& buffer : buffers)
+        {
+            std::memcpy(buffer.iov_base, bytes, buffer.iov_len);
+            bytes += buffer.iov_len;
+        }
+        return bytes;
+    }
+}
+
+TEST(SizedAnyIovecTest, RoundTrip)
+{
+    // sample does not fit in 16 bytes, so it is heap-allocated.
+    std::vector<sized_any<16>> values{std::int64_t{-3}, 2.5, sample{7, {1, 2, 3, 4}}, sized_any<16>{}};
+    sized_any_gather<telemetry> out;
+    ASSERT_TRUE(out.assign(values.begin(), values.end()));
+    EXPECT_EQ(out.size(), 4 * sizeof(kmillet::sized_any_io_tag) + sizeof(std::int64_t) + sizeof(double) + sizeof(sample));
+    const std::vector<std::byte> bytes = Gather(out.buffers());
+    ASSERT_EQ(bytes.size(), out.size());
+
+    std::vector<sized_any<16>> slots(4);
+    slots[3] = 1.0; // reset by the read
+    sized_any_scatter<telemetry> in;
+    const kmillet::sized_any_iovec& header = in.header(slots.size());
+    std::memcpy(header.iov_base, bytes.data(), header.iov_len);
+    ASSERT_TRUE(in.assign(slots.begin(), slots.end()));
+    EXPECT_EQ(header.iov_len + in.size(), bytes.size());
+    Scatter(bytes.data() + header.iov_len, in.buffers());
+
+    EXPECT_EQ(kmillet::any_cast<std::int64_t>(slots[0]), -3);
+    EXPECT_EQ(kmillet::any_cast<double>(slots[1]), 2.5);
+    EXPECT_EQ(kmillet::any_cast<sample&>(slots[2]).sensor, 7);
+    EXPECT_EQ(kmillet::any_cast<sample&>(slots[2]).readings[3], 4);
+    EXPECT_FALSE(slots[3].has_value());
+}
+
+TEST(SizedAnyIovecTest, ReusesMatchingSlots)
+{
+    std::vector<sized_any<16>> slots{sample{}};
+    const sample* before = kmillet::any_cast<sample>(&slots[0]);
+    sized_any_scatter<telemetry> in;
+    auto& header = in.header(1);
+    *static_cast<kmillet::sized_any_io_tag*>(header.iov_base) = 2;
+    ASSERT_TRUE(in.assign(slots.begin(), slots.end()));
+    EXPECT_EQ(kmillet::any_cast<sample>(&slots[0]), before);
+    ASSERT_EQ(in.buffers().size(), 1u);
+    EXPECT_EQ(in.buffers()[0].iov_base, before);
+}
+
+TEST(SizedAnyIovecTest, RejectsUnlistedTypesAndInvalidTags)
+{
+    std::vector<sized_any<16>> values{std::int64_t{1}, 1.5f};
+    sized_any_gather<telemetry> out;
+    EXPECT_FALSE(out.assign(values.begin(), values.end()));
+    EXPECT_TRUE(out.buffers().empty());
+
+    std::vector<sized_any<16>> slots(2);
+    sized_any_scatter<telemetry> in;
+    auto& header = in.header(2);
+    static_cast<kmillet::sized_any_io_tag*>(header.iov_base)[0] = 0;
+    static_cast<kmillet::sized_any_io_tag*>(header.iov_base)[1] = 3;
+    EXPECT_FALSE(in.assign(slots.begin(), slots.end()));
+    in.header(3);
+    EXPECT_FALSE(in.assign(slots.begin(), slots.end()));
+}
+
+#if __has_include(<unistd.h>)
+TEST(SizedAnyIovecTest, WritevReadv)
+{
+    const std::vector<sized_any<32>> values{sample{1, {0.5, 0, 0, 0}}, std::int64_t{42}};
+    sized_any_gather<telemetry> out;
+    ASSERT_TRUE(out.assign(values.begin(), values.end()));
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT_EQ(writev(fds[1], out.buffers().data(), static_cast<int>(out.buffers().size())), static_cast<ssize_t>(out.size()));
+
+    std::vector<sized_any<32>> slots(values.size());
+    sized_any_scatter<telemetry> in;
+    auto& header = in.header(slots.size());
+    ASSERT_EQ(readv(fds[0], &header, 1), static_cast<ssize_t>(header.iov_len));
+    ASSERT_TRUE(in.assign(slots.begin(), slots.end()));
+    ASSERT_EQ(readv(fds[0], in.buffers().data(), static_cast<int>(in.buffers().size())), static_cast<ssize_t>(in.size()));
+    close(fds[0]);
+    close(fds[1]);
+
+    EXPECT_EQ(kmillet::any_cast<const sample&>(slots[0]).readings[0], 0.5);
+    EXPECT_EQ(kmillet::any_cast<std::int64_t>(slots[1]), 42);
+}
+#endif
@@ -0,0 +1,246 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_map.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using kmillet::sized_any_map;
+using kmillet::sized_any;
+using kmillet::any_cast;
+
+TEST(SizedAnyMapTest, ShardCount)
+{
+    EXPECT_EQ((sized_any_map<int, 32>(5).shard_count()), 8u);
+    EXPECT_EQ((sized_any_map<int, 32>(0).shard_count()), 1u);
+}
+
+TEST(SizedAnyMapTest, InsertGetErase)
+{
+    sized_any_map<std::string, 32> map(4);
+    EXPECT_TRUE(map.insert_or_assign("a", 42));
+    EXPECT_TRUE(map.insert_or_assign("b", std::string("text")));
+    EXPECT_FALSE(map.insert_or_assign("a", 43));
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.get<int>("a"), 43);
+    EXPECT_EQ(map.get<std::string>("b"), "text");
+    EXPECT_FALSE(map.get<int>("b").has_value());
+    EXPECT_FALSE(map.get<int>("c").has_value());
+    EXPECT_TRUE(map.erase("a"));
+    EXPECT_FALSE(map.erase("a"));
+    EXPECT_FALSE(map.contains("a"));
+    EXPECT_TRUE(map.contains("b"));
+}
+
+TEST(SizedAnyMapTest, Update)
+{
+    sized_any_map<int, 32> map;
+    map.insert_or_assign(1, 10);
+    EXPECT_TRUE(map.update<int>(1, [](int& value) { value *= 2; }));
+    EXPECT_FALSE(map.update<double>(1, [](double&) { FAIL(); }));
+    EXPECT_FALSE(map.update<int>(2, [](int&) { FAIL(); }));
+    EXPECT_EQ(map.get<int>(1), 20);
+}
+
+namespace
+{
+    struct counted
+    {
+        static inline int copies = 0;
+        counted() = default;
+        counted(const counted&) noexcept { ++copies; }
+    };
+}
+
+TEST(SizedAnyMapTest, WritesDoNotCopyValues)
+{
+    sized_any_map<int, 32> map(1);
+    for (int key = 0; key < 16; ++key) map.insert_or_assign(key, counted{});
+    const int copies = counted::copies;
+    map.insert_or_assign(16, 16); // grows the table
+    map.erase(3);
+    map.insert_or_assign(4, 4);
+    EXPECT_EQ(counted::copies, copies);
+    EXPECT_TRUE(map.update<counted>(5, [](counted&) {}));
+    EXPECT_EQ(counted::copies, copies + 1); // only the updated value is copied
+}
+
+namespace
+{
+    struct counted_key
+    {
+        static inline int copies = 0;
+        explicit counted_key(int id) : id(id) {}
+        counted_key(const counted_key& other) noexcept : id(other.id) { ++copies; }
+        bool operator==(const counted_key&) const = default;
+        int id;
+    };
+    struct counted_key_hash
+    {
+        std::size_t operator()(const counted_key& key) const noexcept { return static_cast<std::size_t>(key.id); }
+    };
+}
+
+TEST(SizedAnyMapTest, WritesCopyOnlyTheirOwnKey)
+{
+    sized_any_map<counted_key, 32, kmillet::default_dispatch, counted_key_hash> map(1);
+    for (int id = 0; id < 16; ++id) map.insert_or_assign(counted_key(id), id);
+    EXPECT_EQ(counted_key::copies, 16);
+    map.insert_or_assign(counted_key(16), 16); // grows the table
+    map.erase(counted_key(3));
+    map.insert_or_assign(counted_key(3), 3);   // reuses the erased bucket
+    EXPECT_EQ(counted_key::copies, 18);
+    EXPECT_EQ(map.size(), 17u);
+}
+
+TEST(SizedAnyMapTest, Visit)
+{
+    sized_any_map<int, 32> map;
+    map.insert_or_assign(1, 1.5);
+    bool visited = false;
+    EXPECT_TRUE(map.visit(1, [&visited](const sized_any<32>& value) { visited = any_cast<double>(value) == 1.5; }));
+    EXPECT_TRUE(visited);
+    EXPECT_FALSE(map.visit(2, [](const sized_any<32>&) { FAIL(); }));
+}
+
+TEST(SizedAnyMapTest, ConcurrentUpdates)
+{
+    constexpr int threads = 4;
+    constexpr int keys = 64;
+    constexpr int rounds = 1000;
+    sized_any_map<int, 32> map(8);
+    for (int key = 0; key < keys; ++key) map.insert_or_assign(key, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&map]
+        {
+            for (int i = 0; i < rounds; ++i)
+            {
+                map.update<int>(i % keys, [](int& value) { ++value; });
+                (void)map.get<int>((i * 7) % keys);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    int total = 0;
+    for (int key = 0; key < keys; ++key) total += *map.get<int>(key);
+    EXPECT_EQ(total, threads * rounds);
+}
+
+TEST(SizedAnyMapTest, GrowAndEraseKeepProbesIntact)
+{
+    sized_any_map<int, 32> map(2);
+    std::map<int, int> expected;
+    for (int i = 0; i < 2000; ++i)
+    {
+        const int key = (i * 37) % 500;
+        if (i % 3 == 2)
+        {
+            EXPECT_EQ(map.erase(key), expected.erase(key) > 0);
+        }
+        else
+        {
+            EXPECT_EQ(map.insert_or_assign(key, i), expected.insert_or_assign(key, i).second);
+        }
+    }
+    EXPECT_EQ(map.size(), expected.size());
+    for (int key = 0; key < 500; ++key)
+    {
+        auto it = expected.find(key);
+        EXPECT_EQ(map.get<int>(key), it == expected.end() ? std::nullopt : std::optional<int>(it->second));
+    }
+}
+
+TEST(SizedAnyMapTest, VisitOutlivesErase)
+{
+    sized_any_map<int, 32> map;
+    map.insert_or_assign(1, std::string("kept alive by the reader"));
+    EXPECT_TRUE(map.visit(1, [&map](const sized_any<32>& value) {
+        EXPECT_TRUE(map.erase(1)); // readers hold no lock, so the map may be changed during a visit
+        EXPECT_EQ(any_cast<const std::string&>(value), "kept alive by the reader");
+    }));
+    EXPECT_FALSE(map.contains(1));
+}
+
+TEST(SizedAnyMapTest, ThrowingHash)
+{
+    struct throwing_hash
+    {
+        std::size_t operator()(int key) const
+        {
+            if (key < 0) throw std::invalid_argument("negative key");
+            return static_cast<std::size_t>(key);
+        }
+    };
+    sized_any_map<int, 32, kmillet::default_dispatch, throwing_hash> map;
+    map.insert_or_assign(1, 1);
+    EXPECT_THROW(map.insert_or_assign(-1, 1), std::invalid_argument);
+    EXPECT_THROW((void)map.get<int>(-1), std::invalid_argument);
+    EXPECT_EQ(map.get<int>(1), 1);
+    EXPECT_EQ(map.size(), 1u);
+}
+
+TEST(SizedAnyMapTest, ReadersDuringWrites)
+{
+    constexpr int keys = 32;
+    sized_any_map<int, 32> map(4);
+    for (int key = 0; key < keys; ++key) map.insert_or_assign(key, std::string(16, 'a'));
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    std::atomic<int> torn = 0;
+    for (int t = 0; t < 3; ++t)
+    {
+        readers.emplace_back([&] {
+            for (int i = 0; !done.load(std::memory_order_relaxed); ++i)
+            {
+                std::optional<std::string> value = map.get<std::string>(i % keys);
+                if (!value || value->size() != 16 || value->find_first_not_of(value->front()) != std::string::npos) torn.fetch_add(1);
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i)
+    {
+        map.insert_or_assign(i % keys, std::string(16, static_cast<char>('a' + i % 26)));
+        map.update<std::string>((i * 5) % keys, [](std::string& value) { value.assign(16, 'z'); });
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+    EXPECT_EQ(torn.load(), 0);
+}
+
+TEST(SizedAnyMapTest, ReadersDuringErase)
+{
+    // Erased buckets stay on the probe sequences of the keys after them, so those keys are found throughout.
+    constexpr int kept = 32;
+    sized_any_map<int, 32> map(1);
+    for (int key = 0; key < kept; ++key) map.insert_or_assign(key, key);
+    std::atomic<bool> done = false;
+    std::atomic<int> missed = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t)
+    {
+        readers.emplace_back([&] {
+            for (int i = 0; !done.load(std::memory_order_relaxed); ++i)
+            {
+                if (map.get<int>(i % kept) != i % kept) missed.fetch_add(1);
+            }
+        });
+    }
+    for (int i = 0; i < 5000; ++i)
+    {
+        map.insert_or_assign(kept + i % 64, i);
+        map.erase(kept + (i * 7) % 64);
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+    EXPECT_EQ(missed.load(), 0);
+    for (int key = 0; key < kept; ++key) EXPECT_EQ(map.get<int>(key), key);
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_recycler.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using kmillet::sized_any;
+using kmillet::sized_any_recycler;
+
+namespace
+{
+    using block = std::array<char, 64>;   // too large for the buffers below, so always on the heap
+    using other = std::array<char, 128>;
+}
+
+TEST(SizedAnyRecyclerTest, ReturnsInBatches)
+{
+    sized_any_recycler<16> recycler(64, 2);
+    sized_any_recycler<16>::sender returns(recycler);
+    returns.release(recycler.make<block>());
+    EXPECT_EQ(recycler.collect(), 0u); // still buffered by the sender
+    returns.release(recycler.make<block>());
+    EXPECT_EQ(recycler.collect(), 2u);
+    EXPECT_EQ(recycler.pooled(), 2u);
+
+    // The emptied batch is handed back to the sender for the next values.
+    returns.release(recycler.make<block>());
+    returns.release(recycler.make<block>());
+    EXPECT_EQ(recycler.collect(), 2u);
+    EXPECT_EQ(recycler.pooled(), 2u);
+}
+
+TEST(SizedAnyRecyclerTest, ReusesHeapStorage)
+{
+    sized_any_recycler<16> recycler;
+    sized_any<16> value = recycler.make<block>();
+    const void* storage = kmillet::any_cast<block>(&value);
+    {
+        sized_any_recycler<16>::sender returns(recycler);
+        returns.release(std::move(value));
+        returns.release(sized_any<16>(1)); // in-place, so not worth pooling
+        returns.release(sized_any<16>());  // empty, so ignored
+    }
+    EXPECT_EQ(recycler.collect(), 2u);
+    EXPECT_EQ(recycler.pooled(), 1u);
+
+    sized_any<16> mismatched = recycler.make<other>();
+    EXPECT_EQ(recycler.pooled(), 1u);
+    sized_any<16> reused = recycler.make<block>(block{'x'});
+    EXPECT_EQ(recycler.pooled(), 0u);
+    EXPECT_EQ(kmillet::any_cast<block>(&reused), storage);
+    EXPECT_EQ(kmillet::any_cast<block&>(reused)[0], 'x');
+}
+
+TEST(SizedAnyRecyclerTest, PoolIsBounded)
+{
+    sized_any_recycler<16> recycler(3);
+    {
+        sized_any_recycler<16>::sender returns(recycler);
+        for (int i = 0; i < 10; ++i) returns.release(sized_any<16>(std::in_place_type<block>));
+    }
+    EXPECT_EQ(recycler.collect(), 10u);
+    EXPECT_EQ(recycler.pooled(), 3u);
+    recycler.trim();
+    EXPECT_EQ(recycler.pooled(), 0u);
+}
+
+TEST(SizedAnyRecyclerTest, ConcurrentSenders)
+{
+    sized_any_recycler<16> recycler(1000, 8);
+    std::atomic<bool> done = false;
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < 4; ++t)
+    {
+        consumers.emplace_back([&] {
+            sized_any_recycler<16>::sender returns(recycler);
+            for (int i = 0; i < 100; ++i) returns.release(sized_any<16>(std::string(100, 'a')));
+        });
+    }
+    // Collecting while the senders run hands batches back to them concurrently.
+    std::size_t taken = 0;
+    std::thread owner([&] {
+        while (!done.load()) taken += recycler.collect();
+    });
+    for (auto& consumer : consumers) consumer.join();
+    done = true;
+    owner.join();
+    taken += recycler.collect();
+    EXPECT_EQ(taken, 400u);
+    EXPECT_EQ(recycler.pooled(), 400u);
+}
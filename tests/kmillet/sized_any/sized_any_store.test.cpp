@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_store.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using kmillet::sized_any_store;
+
+namespace
+{
+    using store = sized_any_store<std::string, 32>;
+
+    // Every default-constructed instance hashes differently, like a hash seeded at random.
+    struct seeded_hash
+    {
+        static inline std::size_t seeds = 0;
+        std::size_t operator()(int key) const noexcept { return static_cast<std::size_t>(key) * 2654435761u + seed; }
+        std::size_t seed = ++seeds;
+    };
+}
+
+TEST(SizedAnyStoreTest, ApplyBatch)
+{
+    store settings;
+    EXPECT_EQ(settings.load().size(), 0u);
+    store::batch changes;
+    changes.assign("timeout", 30).emplace<std::string>("host", "example.org").erase("missing");
+    EXPECT_EQ(settings.apply(std::move(changes)), 1u);
+
+    auto snapshot = settings.load();
+    EXPECT_EQ(snapshot.version(), 1u);
+    EXPECT_EQ(snapshot.size(), 2u);
+    ASSERT_NE(snapshot.get<int>("timeout"), nullptr);
+    EXPECT_EQ(*snapshot.get<int>("timeout"), 30);
+    EXPECT_EQ(snapshot.get<double>("timeout"), nullptr);
+    EXPECT_EQ(*snapshot.get<std::string>("host"), "example.org");
+    EXPECT_FALSE(snapshot.contains("missing"));
+}
+
+TEST(SizedAnyStoreTest, SnapshotsAreIsolated)
+{
+    store settings(4);
+    settings.apply(std::move(store::batch().assign("a", 1).assign("b", 2)));
+    auto before = settings.load();
+    settings.apply(std::move(store::batch().assign("a", 10).erase("b").assign("c", 3)));
+    auto after = settings.load();
+
+    EXPECT_EQ(*before.get<int>("a"), 1);
+    EXPECT_EQ(*before.get<int>("b"), 2);
+    EXPECT_FALSE(before.contains("c"));
+    EXPECT_EQ(before.size(), 2u);
+    EXPECT_EQ(*after.get<int>("a"), 10);
+    EXPECT_FALSE(after.contains("b"));
+    EXPECT_EQ(after.size(), 2u);
+}
+
+TEST(SizedAnyStoreTest, UnmodifiedValuesAreShared)
+{
+    store settings;
+    settings.apply(std::move(store::batch().assign("kept", 1).assign("changed", 2)));
+    auto before = settings.load();
+    settings.apply(std::move(store::batch().assign("changed", 3)));
+    auto after = settings.load();
+    EXPECT_EQ(before.find("kept"), after.find("kept"));
+    EXPECT_NE(before.find("changed"), after.find("changed"));
+}
+
+TEST(SizedAnyStoreTest, SnapshotsUseTheStoreHash)
+{
+    sized_any_store<int, 32, kmillet::default_dispatch, seeded_hash> numbers(16);
+    sized_any_store<int, 32, kmillet::default_dispatch, seeded_hash>::batch changes;
+    for (int key = 0; key < 64; ++key) changes.assign(key, key);
+    numbers.apply(std::move(changes));
+    auto snapshot = numbers.load();
+    for (int key = 0; key < 64; ++key)
+    {
+        ASSERT_NE(snapshot.get<int>(key), nullptr);
+        EXPECT_EQ(*snapshot.get<int>(key), key);
+    }
+}
+
+TEST(SizedAnyStoreTest, ReadersSeeWholeBatches)
+{
+    store settings;
+    settings.apply(std::move(store::batch().assign("x", 0).assign("y", 0)));
+    std::atomic<bool> done = false;
+    std::atomic<int> torn = 0;
+    std::thread reader([&] {
+        while (!done.load())
+        {
+            auto snapshot = settings.load();
+            if (*snapshot.get<int>("x") != *snapshot.get<int>("y")) ++torn;
+        }
+    });
+    for (int i = 1; i <= 1000; ++i) settings.apply(std::move(store::batch().assign("x", i).assign("y", i)));
+    done = true;
+    reader.join();
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(settings.load().version(), 1001u);
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_string.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+using kmillet::sized_any;
+using kmillet::inline_string;
+using kmillet::sized_any_string;
+using kmillet::make_sized_any_string;
+using kmillet::string_view_cast;
+using kmillet::table_dispatch;
+
+TEST(SizedAnyStringTest, InlineStringLayout)
+{
+    static_assert(sizeof(inline_string<15>) == 16);
+    static_assert(std::is_trivially_copyable_v<inline_string<15>>);
+    static_assert(kmillet::sized_any_optimized<sized_any_string<16>, 16>);
+    static_assert(kmillet::sized_any_optimized<kmillet::sized_any_string<kmillet::any::capacity()>, kmillet::any::capacity()>);
+    constexpr inline_string<7> str("abc");
+    static_assert(str.view() == "abc");
+    EXPECT_EQ(str.size(), 3u);
+    EXPECT_EQ(inline_string<7>::capacity(), 7u);
+    EXPECT_EQ(std::string_view(inline_string<7>()), "");
+}
+
+TEST(SizedAnyStringTest, ShortStringsAreInline)
+{
+    sized_any<16> a = make_sized_any_string<16>("fifteen chars!!");
+    EXPECT_EQ(a.type(), typeid(sized_any_string<16>));
+    EXPECT_EQ(string_view_cast(a), "fifteen chars!!");
+}
+
+TEST(SizedAnyStringTest, LongStringsSpill)
+{
+    sized_any<16, table_dispatch> a = make_sized_any_string<16, table_dispatch>("sixteen chars!!!");
+    EXPECT_EQ(a.type(), typeid(std::string));
+    EXPECT_EQ(string_view_cast(a), "sixteen chars!!!");
+}
+
+TEST(SizedAnyStringTest, StringViewCast)
+{
+    sized_any<32> s = std::string("string");
+    sized_any<32> v = std::string_view("view");
+    sized_any<32> i = 42;
+    sized_any<32> empty;
+    EXPECT_EQ(string_view_cast(s), "string");
+    EXPECT_EQ(string_view_cast(v), "view");
+    EXPECT_FALSE(string_view_cast(i).has_value());
+    EXPECT_FALSE(string_view_cast(empty).has_value());
+}
+
+TEST(SizedAnyStringTest, CopiesKeepTheirOwnCharacters)
+{
+    sized_any<32> a = make_sized_any_string<32>("original");
+    sized_any<32> b = a;
+    a = make_sized_any_string<32>("changed");
+    EXPECT_EQ(string_view_cast(a), "changed");
+    EXPECT_EQ(std::string(*string_view_cast(b)), "original");
+}
+
+TEST(SizedAnyStringTest, ReadsInlineStringsOfOtherSizes)
+{
+    sized_any<64> wide = make_sized_any_string<32>("hello");
+    EXPECT_EQ(wide.type(), typeid(sized_any_string<32>));
+    EXPECT_EQ(string_view_cast(wide), "hello");
+    sized_any<16, table_dispatch> narrow = make_sized_any_string<32, table_dispatch>("twenty characters...");
+    EXPECT_EQ(string_view_cast(narrow), "twenty characters...");
+    sized_any<32> largest = inline_string<255>(std::string(255, 'x'));
+    EXPECT_EQ(string_view_cast(largest)->size(), 255u);
+    sized_any<32> lookalike = std::array<char, 6>{'h', 'e', 'l', 'l', 'o', 5}; // the size of inline_string<5>, but not one
+    EXPECT_FALSE(string_view_cast(lookalike).has_value());
+}
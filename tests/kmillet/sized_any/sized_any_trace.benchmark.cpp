@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_trace.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+using kmillet::sized_any_trace_event;
+using kmillet::sized_any_trace_record;
+
+// Every type is replayed by a stand-in of the nearest larger size and alignment, which is nothrow-movable if and only if the type was,
+// so that it is stored in-place or on the heap as the recorded type would be.
+template <std::size_t Size, std::size_t Alignment, bool NothrowMovable>
+struct alignas(Alignment) StandIn
+{
+    StandIn() = default;
+    StandIn(const StandIn&) = default;
+    StandIn(StandIn&& other) noexcept(NothrowMovable) : bytes(other.bytes) {}
+
+    std::array<std::byte, Size> bytes{};
+};
+
+static constexpr std::array<std::size_t, 11> sizeClasses{8, 16, 24, 32, 48, 64, 96, 128, 256, 512, 1024};
+// Alignments below 8 are replayed as 8, which leaves the size of every size class unchanged.
+static constexpr std::array<std::size_t, 4> alignmentClasses{8, 16, 32, 64};
+static constexpr std::size_t standInCount = sizeClasses.size() * alignmentClasses.size() * 2;
+
+template <std::size_t Classes>
+static std::size_t Class(const std::array<std::size_t, Classes>& classes, std::size_t value)
+{
+    auto it = std::lower_bound(classes.begin(), classes.end(), value);
+    return it == classes.end() ? classes.size() - 1 : static_cast<std::size_t>(it - classes.begin());
+}
+
+// The index of the stand-in of the recorded type, among the `standInCount` ones.
+static std::size_t StandInIndex(const sized_any_trace_record& record)
+{
+    return (Class(sizeClasses, record.size) * alignmentClasses.size() + Class(alignmentClasses, record.alignment())) * 2 + record.is_nothrow_movable();
+}
+
+template <std::size_t I>
+using StandInAt = StandIn<sizeClasses[I / 2 / alignmentClasses.size()], alignmentClasses[I / 2 % alignmentClasses.size()], I % 2 == 1>;
+
+template <class AnyT>
+struct Ops
+{
+    template <std::size_t... I>
+    static constexpr auto MakeEmplace(std::index_sequence<I...>)
+    {
+        return std::array<void (*)(AnyT&), sizeof...(I)>{[](AnyT& a) { a.template emplace<StandInAt<I>>(); }...};
+    }
+    template <std::size_t... I>
+    static constexpr auto MakeCast(std::index_sequence<I...>)
+    {
+        return std::array<const void* (*)(const AnyT&), sizeof...(I)>{[](const AnyT& a) -> const void* { return kmillet::any_cast<StandInAt<I>>(&a); }...};
+    }
+    static constexpr auto emplace = MakeEmplace(std::make_index_sequence<standInCount>{});
+    static constexpr auto cast = MakeCast(std::make_index_sequence<standInCount>{});
+};
+
+template <class AnyT>
+static void Replay(std::span<const sized_any_trace_record> trace, std::span<AnyT> slots)
+{
+    for (const auto& record : trace)
+    {
+        AnyT& self = slots[record.self];
+        switch (record.event)
+        {
+        case sized_any_trace_event::construct:
+            Ops<AnyT>::emplace[StandInIndex(record)](self);
+            break;
+        case sized_any_trace_event::copy:
+        {
+            if (record.other == record.self) break; // self-assignment leaves the object as is
+            // Copied before `self` is destroyed, so that a copy that throws leaves `self` alive.
+            AnyT copy(slots[record.other]);
+            std::destroy_at(&self);
+            std::construct_at(&self, std::move(copy));
+            break;
+        }
+        case sized_any_trace_event::move:
+            if (record.other == record.self) break;
+            std::destroy_at(&self);
+            std::construct_at(&self, std::move(slots[record.other]));
+            break;
+        case sized_any_trace_event::swap:
+            self.swap(slots[record.other]);
+            break;
+        case sized_any_trace_event::cast:
+            benchmark::DoNotOptimize(Ops<AnyT>::cast[StandInIndex(record)](self));
+            break;
+        case sized_any_trace_event::destroy:
+            self.reset();
+            break;
+        }
+    }
+}
+
+// Stands in for a captured trace when none is given: a deterministic mix that is dominated by small types and casts,
+// with a small type whose move constructor may throw, such as a node-based container.
+static std::vector<sized_any_trace_record> SyntheticTrace()
+{
+    struct type
+    {
+        std::uint32_t size;
+        std::uint8_t flags;
+    };
+    constexpr std::uint32_t slotCount = 64;
+    constexpr std::size_t length = 10000;
+    constexpr std::uint8_t plain = sized_any_trace_record::make_flags(8, true);
+    constexpr std::array<type, 10> types{{{8, plain}, {8, plain}, {8, plain}, {8, plain}, {8, plain}, {8, plain},
+                                          {24, plain}, {24, sized_any_trace_record::make_flags(8, false)}, {48, plain}, {512, plain}}};
+    constexpr type empty{0, sized_any_trace_record::make_flags(1, true)};
+    std::array<type, slotCount> contents;
+    contents.fill(empty);
+    std::uint64_t state = 0x9E3779B97F4A7C15u;
+    auto next = [&state](std::uint32_t bound) {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        return static_cast<std::uint32_t>((state >> 33) % bound);
+    };
+    std::vector<sized_any_trace_record> trace;
+    trace.reserve(length);
+    while (trace.size() < length)
+    {
+        const std::uint32_t self = next(slotCount);
+        const std::uint32_t other = (self + 1 + next(slotCount - 1)) % slotCount;
+        const std::uint32_t roll = next(100);
+        const auto record = [&](sized_any_trace_event event, std::uint32_t with, type recorded) {
+            trace.push_back({event, self, with, recorded.size, recorded.flags});
+        };
+        if (roll < 25) record(sized_any_trace_event::construct, sized_any_trace_record::no_slot, contents[self] = types[next(types.size())]);
+        else if (roll < 35) record(sized_any_trace_event::copy, other, contents[self] = contents[other]);
+        else if (roll < 45)
+        {
+            record(sized_any_trace_event::move, other, contents[self] = contents[other]);
+            contents[other] = empty;
+        }
+        else if (roll < 50)
+        {
+            record(sized_any_trace_event::swap, other, empty);
+            std::swap(contents[self], contents[other]);
+        }
+        else if (roll < 90) record(sized_any_trace_event::cast, sized_any_trace_record::no_slot, contents[self]);
+        else if (contents[self].size != 0)
+        {
+            record(sized_any_trace_event::destroy, sized_any_trace_record::no_slot, contents[self]);
+            contents[self] = empty;
+        }
+    }
+    return trace;
+}
+
+// Counts the slots that `trace` refers to, or returns an empty optional if a record lacks a slot that its event needs, or refers
+// to a slot that no recorder could have assigned, since each record introduces at most two new slots.
+static std::optional<std::uint32_t> SlotCount(std::span<const sized_any_trace_record> trace)
+{
+    const std::uint64_t limit = 2 * static_cast<std::uint64_t>(trace.size());
+    std::uint32_t count = 0;
+    for (const auto& record : trace)
+    {
+        const bool pair = record.event == sized_any_trace_event::copy || record.event == sized_any_trace_event::move || record.event == sized_any_trace_event::swap;
+        if (record.self >= limit || (pair && record.other >= limit)) return std::nullopt;
+        count = std::max(count, record.self + 1);
+        if (pair) count = std::max(count, record.other + 1);
+    }
+    return count;
+}
+
+struct LoadedTrace
+{
+    std::vector<sized_any_trace_record> records;
+    std::uint32_t slotCount;
+};
+
+static const LoadedTrace& Trace()
+{
+    static const LoadedTrace trace = [] {
+        if (const char* path = std::getenv("KMILLET_SIZED_ANY_TRACE_FILE"))
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (auto loaded = kmillet::read_sized_any_trace(in))
+            {
+                if (auto slotCount = SlotCount(*loaded)) return LoadedTrace{*std::move(loaded), *slotCount};
+                std::cerr << "The trace in " << path << " refers to slots out of range, replaying the synthetic trace instead.\n";
+            }
+            else std::cerr << "Could not read a trace from " << path << ", replaying the synthetic trace instead.\n";
+        }
+        auto synthetic = SyntheticTrace();
+        const std::uint32_t slotCount = *SlotCount(synthetic);
+        return LoadedTrace{std::move(synthetic), slotCount};
+    }();
+    return trace;
+}
+
+template <class AnyT>
+static void BM_Any_TraceReplay(benchmark::State& state)
+{
+    const auto& [trace, slotCount] = Trace();
+    for (auto _ : state) {
+        std::vector<AnyT> slots(slotCount);
+        Replay<AnyT>(trace, slots);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * trace.size()));
+}
+
+#define REPLAY_BENCHMARKS(N) \
+BENCHMARK_TEMPLATE(BM_Any_TraceReplay, kmillet::sized_any<N, kmillet::virtual_dispatch>)->Unit(benchmark::kMicrosecond); \
+BENCHMARK_TEMPLATE(BM_Any_TraceReplay, kmillet::sized_any<N, kmillet::table_dispatch>)->Unit(benchmark::kMicrosecond)
+
+REPLAY_BENCHMARKS(16);
+REPLAY_BENCHMARKS(32);
+REPLAY_BENCHMARKS(64);
+REPLAY_BENCHMARKS(128);
+
+BENCHMARK_MAIN();
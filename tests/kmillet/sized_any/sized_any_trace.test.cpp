@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#define KMILLET_SIZED_ANY_TRACE() 1
+#include <kmillet/sized_any/sized_any_trace.hpp>
+#include <kmillet/sized_any/basic_sized_any.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using kmillet::sized_any;
+using kmillet::sized_any_trace_event;
+using kmillet::sized_any_trace_record;
+using kmillet::sized_any_trace_recorder;
+
+TEST(SizedAnyTraceTest, RecordsOperations)
+{
+    std::vector<sized_any_trace_record> trace;
+    {
+        sized_any_trace_recorder recorder;
+        sized_any<32> a = 42;
+        sized_any<32> b(a);
+        sized_any<32> c(std::move(a));
+        (void)kmillet::any_cast<int>(&b);
+        b.swap(c);
+        b.reset();
+        trace = recorder.records();
+    }
+    constexpr std::uint8_t flags = sized_any_trace_record::make_flags(alignof(int), true);
+    const std::vector<sized_any_trace_record> expected{
+        {sized_any_trace_event::construct, 0, sized_any_trace_record::no_slot, sizeof(int), flags},
+        {sized_any_trace_event::copy, 1, 0, sizeof(int), flags},
+        {sized_any_trace_event::move, 2, 0, sizeof(int), flags},
+        {sized_any_trace_event::cast, 1, sized_any_trace_record::no_slot, sizeof(int), flags},
+        {sized_any_trace_event::swap, 1, 2, 0},
+        {sized_any_trace_event::destroy, 1, sized_any_trace_record::no_slot, sizeof(int), flags},
+    };
+    EXPECT_EQ(trace, expected);
+}
+
+TEST(SizedAnyTraceTest, RecordsWhatDecidesAllocation)
+{
+    // Throwing moves put even the smallest types on the heap, so they must be told apart from nothrow-movable ones of the same size.
+    struct alignas(16) throwing
+    {
+        throwing() = default;
+        throwing(const throwing&) = default;
+        throwing(throwing&&) noexcept(false) {}
+        char c;
+    };
+    std::vector<sized_any_trace_record> trace;
+    {
+        sized_any_trace_recorder recorder;
+        sized_any<32> a = throwing{};
+        trace = recorder.records();
+    }
+    ASSERT_EQ(trace.size(), 1u);
+    EXPECT_EQ(trace[0].size, sizeof(throwing));
+    EXPECT_EQ(trace[0].alignment(), 16u);
+    EXPECT_FALSE(trace[0].is_nothrow_movable());
+}
+
+TEST(SizedAnyTraceTest, RecordsExternalStorage)
+{
+    alignas(std::max_align_t) std::byte frame[32];
+    std::vector<sized_any_trace_record> trace;
+    {
+        sized_any_trace_recorder recorder;
+        kmillet::basic_sized_any<kmillet::external_storage> slot(kmillet::external_storage(frame, sizeof(frame)));
+        slot.emplace<double>(1.5);
+        (void)kmillet::any_cast<double>(&slot);
+        slot.reset();
+        trace = recorder.records();
+    }
+    constexpr std::uint8_t flags = sized_any_trace_record::make_flags(alignof(double), true);
+    const std::vector<sized_any_trace_record> expected{
+        {sized_any_trace_event::construct, 0, sized_any_trace_record::no_slot, sizeof(double), flags},
+        {sized_any_trace_event::cast, 0, sized_any_trace_record::no_slot, sizeof(double), flags},
+        {sized_any_trace_event::destroy, 0, sized_any_trace_record::no_slot, sizeof(double), flags},
+    };
+    EXPECT_EQ(trace, expected);
+}
+
+TEST(SizedAnyTraceTest, StopsWithRecorder)
+{
+    {
+        sized_any_trace_recorder recorder;
+    }
+    sized_any_trace_recorder recorder;
+    {
+        sized_any<32> a = 1;
+    }
+    EXPECT_EQ(recorder.records().size(), 2u); // construct and destroy
+}
+
+TEST(SizedAnyTraceTest, DestroyedWhileRecording)
+{
+    std::atomic<bool> done = false;
+    std::thread traced([&done] {
+        while (!done.load()) sized_any<32> a = 1;
+    });
+    for (int i = 0; i < 200; ++i)
+    {
+        sized_any_trace_recorder recorder;
+        std::this_thread::yield();
+    }
+    done = true;
+    traced.join();
+}
+
+TEST(SizedAnyTraceTest, WriteAndRead)
+{
+    const std::vector<sized_any_trace_record> trace{
+        {sized_any_trace_event::construct, 3, sized_any_trace_record::no_slot, 100000, sized_any_trace_record::make_flags(64, false)},
+        {sized_any_trace_event::swap, 3, 7, 0},
+    };
+    std::stringstream stream;
+    EXPECT_TRUE(kmillet::write_sized_any_trace(stream, trace));
+    auto read = kmillet::read_sized_any_trace(stream);
+    ASSERT_TRUE(read.has_value());
+    EXPECT_EQ(*read, trace);
+}
+
+TEST(SizedAnyTraceTest, ReadMalformed)
+{
+    std::stringstream wrongMagic("XXXX");
+    EXPECT_FALSE(kmillet::read_sized_any_trace(wrongMagic).has_value());
+
+    std::stringstream truncated;
+    kmillet::write_sized_any_trace(truncated, std::vector<sized_any_trace_record>{{sized_any_trace_event::cast, 0}});
+    std::string bytes = truncated.str();
+    bytes.pop_back();
+    std::stringstream partial(bytes);
+    EXPECT_FALSE(kmillet::read_sized_any_trace(partial).has_value());
+
+    std::stringstream reservedFlag;
+    kmillet::write_sized_any_trace(reservedFlag, std::vector<sized_any_trace_record>{{sized_any_trace_event::cast, 0, sized_any_trace_record::no_slot, 0, 0x40}});
+    EXPECT_FALSE(kmillet::read_sized_any_trace(reservedFlag).has_value());
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_variant.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+
+using kmillet::sized_any;
+using kmillet::any_cast;
+using kmillet::from_variant;
+using kmillet::to_variant;
+using kmillet::table_dispatch;
+
+TEST(SizedAnyVariantTest, ToVariantMove)
+{
+    sized_any<32> a = std::string("hello");
+    auto v = to_variant<std::variant<int, std::string>>(std::move(a));
+    ASSERT_TRUE(v.has_value());
+    ASSERT_EQ(v->index(), 1u);
+    EXPECT_EQ(std::get<std::string>(*v), "hello");
+    EXPECT_FALSE(a.has_value());
+}
+
+TEST(SizedAnyVariantTest, ToVariantCopy)
+{
+    const sized_any<32> a = 42;
+    auto v = to_variant<std::variant<double, int>>(a);
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<int>(*v), 42);
+    EXPECT_TRUE(a.has_value());
+    EXPECT_EQ(any_cast<int>(a), 42);
+}
+
+TEST(SizedAnyVariantTest, ToVariantMismatch)
+{
+    sized_any<32> a = 1.5f;
+    auto v = to_variant<std::variant<int, double>>(std::move(a));
+    EXPECT_FALSE(v.has_value());
+    ASSERT_TRUE(a.has_value());
+    EXPECT_EQ(any_cast<float>(a), 1.5f);
+}
+
+TEST(SizedAnyVariantTest, ToVariantHeapPayload)
+{
+    sized_any<8> a = std::array<int, 16>{1, 2, 3};
+    auto v = to_variant<std::variant<int, std::array<int, 16>>>(std::move(a));
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<1>(*v)[2], 3);
+    EXPECT_FALSE(a.has_value());
+}
+
+TEST(SizedAnyVariantTest, ToVariantDuplicateAlternatives)
+{
+    sized_any<32> a = 7;
+    auto v = to_variant<std::variant<int, int>>(std::move(a));
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(v->index(), 0u);
+    EXPECT_EQ(std::get<0>(*v), 7);
+}
+
+TEST(SizedAnyVariantTest, Monostate)
+{
+    sized_any<32> a;
+    auto v = to_variant<std::variant<int, std::monostate>>(std::move(a));
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(v->index(), 1u);
+    EXPECT_FALSE(to_variant<std::variant<int>>(std::move(a)).has_value());
+    EXPECT_FALSE(from_variant<32>(std::variant<std::monostate, int>()).has_value());
+}
+
+TEST(SizedAnyVariantTest, FromVariant)
+{
+    std::variant<int, std::string> v = std::string("world");
+    sized_any<32> a = from_variant<32>(v);
+    EXPECT_EQ(any_cast<std::string>(a), "world");
+    EXPECT_EQ(std::get<std::string>(v), "world");
+    sized_any<32> b = from_variant<32>(std::move(v));
+    EXPECT_EQ(any_cast<std::string>(b), "world");
+}
+
+TEST(SizedAnyVariantTest, TableDispatch)
+{
+    auto a = from_variant<32, table_dispatch>(std::variant<int, double>(2.5));
+    auto v = to_variant<std::variant<int, double>>(std::move(a));
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<double>(*v), 2.5);
+}
+
+TEST(SizedAnyVariantTest, ManyAlternatives)
+{
+    using many = std::variant<std::monostate, char, short, int, long, float, double, std::string, int, std::array<int, 2>>;
+    sized_any<32> a = 3;
+    auto v = to_variant<many>(a);
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(v->index(), 3u);
+    sized_any<32> b = std::string("text");
+    v = to_variant<many>(std::move(b));
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<7>(*v), "text");
+    sized_any<32> c;
+    v = to_variant<many>(c);
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(v->index(), 0u);
+    sized_any<32> d = 1u;
+    EXPECT_FALSE(to_variant<many>(d).has_value());
+}
+
+template<class Variant>
+concept convertible = requires(Variant v, sized_any<32> a) {
+    to_variant<Variant>(a);
+    from_variant<32>(v);
+};
+
+TEST(SizedAnyVariantTest, MoveOnlyAlternativesAreRejected)
+{
+    static_assert(convertible<std::variant<std::monostate, int, std::string>>);
+    static_assert(!convertible<std::variant<int, std::unique_ptr<int>>>);
+}
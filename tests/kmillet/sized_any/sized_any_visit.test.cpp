@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_any_visit.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using kmillet::sized_any;
+using kmillet::type_list;
+using kmillet::overloaded;
+using kmillet::visit2;
+using kmillet::visit2_symmetric;
+using kmillet::table_dispatch;
+
+namespace
+{
+    using values = type_list<int, double, std::string>;
+
+    auto unsupported = [](const auto&, const auto&) { return std::string("fallback"); };
+}
+
+TEST(SizedAnyVisitTest, DispatchesOnBothTypes)
+{
+    auto describe = overloaded{
+        [](int x, int y) { return "int+int=" + std::to_string(x + y); },
+        [](int x, double) { return "int,double:" + std::to_string(x); },
+        [](const std::string& x, const std::string& y) { return x + y; },
+    };
+    sized_any<32> i = 1, j = 2, d = 2.5, s = std::string("ab"), t = std::string("cd");
+    EXPECT_EQ(visit2<values>(describe, unsupported, i, j), "int+int=3");
+    EXPECT_EQ(visit2<values>(describe, unsupported, i, d), "int,double:1");
+    EXPECT_EQ(visit2<values>(describe, unsupported, s, t), "abcd");
+    EXPECT_EQ(visit2<values>(describe, unsupported, s, i), "fallback");
+}
+
+TEST(SizedAnyVisitTest, FallbackForUnlistedAndEmpty)
+{
+    auto any_pair = [](const auto&, const auto&) { return std::string("visited"); };
+    sized_any<32> i = 1, f = 1.5f, empty;
+    EXPECT_EQ(visit2<values>(any_pair, unsupported, i, i), "visited");
+    EXPECT_EQ(visit2<values>(any_pair, unsupported, i, f), "fallback");
+    EXPECT_EQ(visit2<values>(any_pair, unsupported, empty, i), "fallback");
+}
+
+TEST(SizedAnyVisitTest, SymmetricFolding)
+{
+    auto combine = overloaded{
+        [](int x, const std::string& y) { return y + std::to_string(x); },
+    };
+    sized_any<32> i = 7, s = std::string("n=");
+    EXPECT_EQ(visit2_symmetric<values>(combine, unsupported, i, s), "n=7");
+    EXPECT_EQ(visit2_symmetric<values>(combine, unsupported, s, i), "n=7");
+    EXPECT_EQ(visit2<values>(combine, unsupported, s, i), "fallback");
+}
+
+TEST(SizedAnyVisitTest, MutatesAndMixesOperands)
+{
+    sized_any<8, table_dispatch> a = std::string("heap allocated");
+    const sized_any<32> b = 3;
+    visit2<values>([](auto& x, const auto& y) {
+        if constexpr (requires { x += std::string(static_cast<std::size_t>(y), '!'); }) x += std::string(static_cast<std::size_t>(y), '!');
+    }, [](auto&, auto&) {}, a, b);
+    EXPECT_EQ(kmillet::any_cast<std::string>(a), "heap allocated!!!");
+}
+
+TEST(SizedAnyVisitTest, LongTypeList)
+{
+    using many = type_list<char, short, int, long, float, double, std::string, unsigned>;
+    auto sizes = [](const auto& x, const auto& y) { return sizeof(x) + sizeof(y); };
+    auto none = [](const auto&, const auto&) { return std::size_t(0); };
+    sized_any<32> c = 'c', u = 1u, d = 1.0, s = std::string("s"), b = true;
+    EXPECT_EQ(visit2<many>(sizes, none, c, u), sizeof(char) + sizeof(unsigned));
+    EXPECT_EQ(visit2<many>(sizes, none, d, s), sizeof(double) + sizeof(std::string));
+    EXPECT_EQ(visit2<many>(sizes, none, b, c), 0u);
+}
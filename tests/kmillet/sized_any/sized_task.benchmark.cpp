@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_task.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <functional>
+#include <vector>
+
+template <std::size_t N>
+struct Capture
+{
+    Capture() : data{} { data.fill(1); }
+    std::array<char, N> data;
+};
+
+template <class T, class TaskT>
+static void BM_Task_Construct(benchmark::State& state)
+{
+    T capture;
+    for (auto _ : state) {
+        TaskT t = [capture] { benchmark::DoNotOptimize(capture); };
+        benchmark::DoNotOptimize(t);
+    }
+}
+
+template <class T, class TaskT>
+static void BM_Task_Invoke(benchmark::State& state)
+{
+    T capture;
+    TaskT t = [capture] { benchmark::DoNotOptimize(capture); };
+    for (auto _ : state) {
+        t();
+    }
+}
+
+template <class T, class TaskT>
+static void BM_Task_QueueDrain(benchmark::State& state)
+{
+    constexpr std::size_t count = 1024;
+    T capture;
+    std::vector<TaskT> queue;
+    queue.reserve(count);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) queue.emplace_back([capture] { benchmark::DoNotOptimize(capture); });
+        for (auto& task : queue) task();
+        queue.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+#define COMPARE_BENCHMARKS(BenchMark, ...) \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, std::function<void()>)->Unit(benchmark::kNanosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_task<32, kmillet::virtual_dispatch>)->Unit(benchmark::kNanosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_task<32, kmillet::table_dispatch>)->Unit(benchmark::kNanosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_task<64, kmillet::virtual_dispatch>)->Unit(benchmark::kNanosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_task<64, kmillet::table_dispatch>)->Unit(benchmark::kNanosecond)
+
+
+COMPARE_BENCHMARKS(BM_Task_Construct, Capture<8>);
+COMPARE_BENCHMARKS(BM_Task_Construct, Capture<24>);
+COMPARE_BENCHMARKS(BM_Task_Construct, Capture<48>);
+COMPARE_BENCHMARKS(BM_Task_Invoke, Capture<8>);
+COMPARE_BENCHMARKS(BM_Task_Invoke, Capture<48>);
+COMPARE_BENCHMARKS(BM_Task_QueueDrain, Capture<24>);
+
+BENCHMARK_MAIN();
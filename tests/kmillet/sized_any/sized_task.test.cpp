@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_task.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+using kmillet::sized_task;
+
+TEST(SizedTaskTest, Empty)
+{
+    sized_task<32> t;
+    EXPECT_FALSE(t);
+    EXPECT_EQ(t.capacity(), 32);
+}
+
+TEST(SizedTaskTest, Invoke)
+{
+    int counter = 0;
+    sized_task<32> t = [&counter] { ++counter; };
+    EXPECT_TRUE(t);
+    t();
+    t();
+    EXPECT_EQ(counter, 2);
+}
+
+TEST(SizedTaskTest, Move)
+{
+    int counter = 0;
+    sized_task<32> a = [&counter] { ++counter; };
+    sized_task<32> b = std::move(a);
+    EXPECT_FALSE(a);
+    b();
+    EXPECT_EQ(counter, 1);
+    a = std::move(b);
+    EXPECT_FALSE(b);
+    a();
+    EXPECT_EQ(counter, 2);
+}
+
+TEST(SizedTaskTest, Copy)
+{
+    std::string log;
+    sized_task<64> a = [&log, suffix = std::string("!")] { log += suffix; };
+    sized_task<64> b = a;
+    a();
+    b();
+    EXPECT_EQ(log, "!!");
+}
+
+TEST(SizedTaskTest, OversizedCapture)
+{
+    std::array<int, 32> values{};
+    values.fill(1);
+    int sum = 0;
+    sized_task<16> t = [values, &sum] { for (int v : values) sum += v; };
+    sized_task<16> moved = std::move(t);
+    moved();
+    EXPECT_EQ(sum, 32);
+}
+
+TEST(SizedTaskTest, Reset)
+{
+    sized_task<32> t = [] {};
+    t.reset();
+    EXPECT_FALSE(t);
+}
+
+TEST(SizedTaskTest, Queue)
+{
+    int counter = 0;
+    std::vector<sized_task<32, kmillet::table_dispatch>> tasks;
+    for (int i = 0; i < 100; ++i) tasks.emplace_back([&counter, i] { counter += i; });
+    for (auto& task : tasks) task();
+    EXPECT_EQ(counter, 4950);
+}
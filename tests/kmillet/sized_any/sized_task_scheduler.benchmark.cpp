@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_task_scheduler.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The baseline: a thread pool with a single locked queue of std::function<void()>.
+class LockedPool
+{
+public:
+    explicit LockedPool(std::size_t workers)
+    {
+        for (std::size_t i = 0; i < workers; ++i) threads.emplace_back([this] { Run(); });
+    }
+    ~LockedPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard lock(mutex);
+            queue.push_back(std::move(task));
+            ++pending;
+        }
+        ready.notify_one();
+    }
+    void wait()
+    {
+        std::unique_lock lock(mutex);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+
+private:
+    void Run()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            ready.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            std::function<void()> task = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+            if (--pending == 0) idle.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable ready, idle;
+    std::deque<std::function<void()>> queue;
+    std::size_t pending = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+template <std::size_t N>
+struct Capture
+{
+    Capture() : data{} { data.fill(1); }
+    std::array<char, N> data;
+};
+
+// A root task submits the benchmarked tasks from a worker, the way fine-grained parallel work is spawned.
+template <class T, class Pool>
+static void BM_Scheduler_Spawn(benchmark::State& state)
+{
+    constexpr std::size_t count = 4096;
+    Pool pool(static_cast<std::size_t>(state.range(0)));
+    std::atomic<std::size_t> done = 0;
+    for (auto _ : state) {
+        pool.submit([&pool, &done] {
+            T capture;
+            for (std::size_t i = 0; i < count; ++i) pool.submit([capture, &done] {
+                benchmark::DoNotOptimize(capture);
+                done.fetch_add(1, std::memory_order_relaxed);
+            });
+        });
+        pool.wait();
+    }
+    benchmark::DoNotOptimize(done.load());
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+#define COMPARE_BENCHMARKS(BenchMark, ...) \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, LockedPool)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMicrosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_task_scheduler<32, kmillet::virtual_dispatch>)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMicrosecond); \
+BENCHMARK_TEMPLATE(BenchMark, ##__VA_ARGS__, kmillet::sized_task_scheduler<32, kmillet::table_dispatch>)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMicrosecond)
+
+
+COMPARE_BENCHMARKS(BM_Scheduler_Spawn, Capture<8>);
+COMPARE_BENCHMARKS(BM_Scheduler_Spawn, Capture<24>);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <kmillet/sized_any/sized_task_scheduler.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using kmillet::sized_task_scheduler;
+
+TEST(SizedTaskSchedulerTest, RunsSubmittedTasks)
+{
+    sized_task_scheduler<32> scheduler(4);
+    EXPECT_EQ(scheduler.size(), 4u);
+    std::atomic<int> count = 0;
+    for (int i = 0; i < 10000; ++i) scheduler.submit([&count] { count.fetch_add(1, std::memory_order_relaxed); });
+    scheduler.wait();
+    EXPECT_EQ(count.load(), 10000);
+    scheduler.wait(); // nothing pending
+}
+
+TEST(SizedTaskSchedulerTest, AtLeastOneWorker)
+{
+    sized_task_scheduler<32> scheduler(0);
+    EXPECT_EQ(scheduler.size(), 1u);
+    int value = 0;
+    scheduler.submit([&value] { value = 7; });
+    scheduler.wait();
+    EXPECT_EQ(value, 7);
+}
+
+// Counts the leaves of a binary tree of tasks, each of which submits its two children from its worker.
+static void Split(sized_task_scheduler<32>& scheduler, std::atomic<int>& leaves, int depth)
+{
+    if (depth == 0)
+    {
+        leaves.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    scheduler.submit([&scheduler, &leaves, depth] { Split(scheduler, leaves, depth - 1); });
+    scheduler.submit([&scheduler, &leaves, depth] { Split(scheduler, leaves, depth - 1); });
+}
+
+TEST(SizedTaskSchedulerTest, TasksSubmitTasks)
+{
+    sized_task_scheduler<32> scheduler(4);
+    std::atomic<int> leaves = 0;
+    scheduler.submit([&] { Split(scheduler, leaves, 14); });
+    scheduler.wait();
+    EXPECT_EQ(leaves.load(), 1 << 14);
+}
+
+TEST(SizedTaskSchedulerTest, DequeGrows)
+{
+    sized_task_scheduler<32> scheduler(2);
+    std::atomic<int> count = 0;
+    scheduler.submit([&] {
+        for (int i = 0; i < 5000; ++i) scheduler.submit([&count] { count.fetch_add(1, std::memory_order_relaxed); }); // more than a ring holds
+    });
+    scheduler.wait();
+    EXPECT_EQ(count.load(), 5000);
+}
+
+TEST(SizedTaskSchedulerTest, IdleWorkersSteal)
+{
+    sized_task_scheduler<32> scheduler(4);
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    scheduler.submit([&] {
+        for (int i = 0; i < 64; ++i)
+        {
+            scheduler.submit([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::lock_guard lock(mutex);
+                ids.insert(std::this_thread::get_id());
+            });
+        }
+    });
+    scheduler.wait();
+    EXPECT_GT(ids.size(), 1u);
+}
+
+TEST(SizedTaskSchedulerTest, SubmitFromManyThreads)
+{
+    sized_task_scheduler<32> scheduler(3);
+    std::atomic<int> count = 0;
+    constexpr int threads = 4, tasks = 5000;
+    std::vector<std::thread> submitters;
+    for (int t = 0; t < threads; ++t)
+    {
+        submitters.emplace_back([&] {
+            for (int i = 0; i < tasks; ++i) scheduler.submit([&count] { count.fetch_add(1, std::memory_order_relaxed); });
+        });
+    }
+    for (auto& submitter : submitters) submitter.join();
+    scheduler.wait();
+    EXPECT_EQ(count.load(), threads * tasks);
+}
+
+TEST(SizedTaskSchedulerTest, OversizedCaptures)
+{
+    sized_task_scheduler<16> scheduler(2);
+    std::atomic<int> sum = 0;
+    std::array<int, 64> values{};
+    values.fill(1);
+    scheduler.submit([&] {
+        for (int i = 0; i < 100; ++i) scheduler.submit([&sum, values] { sum.fetch_add(values[0] + values[63], std::memory_order_relaxed); });
+    });
+    scheduler.wait();
+    EXPECT_EQ(sum.load(), 200);
+}
+
+TEST(SizedTaskSchedulerTest, OtherSchedulersUseTheirQueue)
+{
+    sized_task_scheduler<32> first(1);
+    sized_task_scheduler<32> second(1);
+    std::thread::id firstId, secondId;
+    first.submit([&] {
+        firstId = std::this_thread::get_id();
+        second.submit([&] { secondId = std::this_thread::get_id(); });
+    });
+    first.wait();
+    second.wait();
+    EXPECT_NE(firstId, secondId);
+}
+
+TEST(SizedTaskSchedulerTest, DestructorRunsPendingTasks)
+{
+    std::atomic<int> count = 0;
+    {
+        sized_task_scheduler<32> scheduler(2);
+        for (int i = 0; i < 1000; ++i) scheduler.submit([&count] { count.fetch_add(1, std::memory_order_relaxed); });
+    }
+    EXPECT_EQ(count.load(), 1000);
+}